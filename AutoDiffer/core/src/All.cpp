@@ -6,5 +6,24 @@
 /* header files */
 #include "ADNode.hpp"
 #include "ADValue.hpp"
+#include "Arena.hpp"
+#include "ArenaADValue.hpp"
 #include "AutoDiffer.hpp"
+#include "DeriveService.hpp"
+#include "Executor.hpp"
+#include "FixedADValue.hpp"
+#include "IncrementalDiffer.hpp"
+#include "InfixParser.hpp"
+#include "MappedFile.hpp"
+#include "MpmcQueue.hpp"
+#include "ParallelTape.hpp"
 #include "Parser.hpp"
+#include "PassManager.hpp"
+#include "StringView.hpp"
+#include "Tape.hpp"
+#include "TapeDerivative.hpp"
+#include "TapeFile.hpp"
+#include "TapePasses.hpp"
+#include "TaylorValue.hpp"
+#include "ThreadPool.hpp"
+#include "Workspace.hpp"
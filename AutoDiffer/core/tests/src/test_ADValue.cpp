@@ -139,3 +139,40 @@ TEST(nq_comparison_operator, double){
     EXPECT_FALSE(x5 != x6);
 }
 
+
+TEST(fused_operators, double){
+    ADValue<double> x(0.7, std::vector<double>{ 1.0, 0.5 });
+    ADValue<double> y(-1.3, std::vector<double>{ 0.0, 2.0 });
+    ADValue<double> z(2.1, std::vector<double>{ 3.0, -1.0 });
+    ADValue<double> zero(0, std::vector<double>{ 0, 0 });
+    ADValue<double> one(1, std::vector<double>{ 0, 0 });
+    ADValue<double> five(5, std::vector<double>{ 0, 0 });
+    ADValue<double> ten(10, std::vector<double>{ 0, 0 });
+    ADValue<double> minus_x = zero - x;
+
+    // Each fused op against its composition.
+    std::vector<std::pair<ADValue<double>, ADValue<double>>> cases = {
+        { x.ADfma(y, z), x.ADmul(y) + z },
+        { y.ADsquare(), y.ADmul(y) },
+        { y.ADreciprocal(), one.ADdiv(y) },
+        { y.ADipow(five), y.power(five) },
+        { x.ADexpneg(), minus_x.ADexp() },
+        { y.ADloglogistic(ten), y.ADlogistic().ADlog(ten) },
+    };
+    for (auto& c : cases) {
+        EXPECT_NEAR(c.first.val(), c.second.val(), 1e-12);
+        EXPECT_NEAR(c.first.dval(0), c.second.dval(0), 1e-12);
+        EXPECT_NEAR(c.first.dval(1), c.second.dval(1), 1e-12);
+    }
+
+    // Zero conventions follow ADdiv and power.
+    EXPECT_TRUE(isnan(zero.ADreciprocal().val()));
+    EXPECT_EQ(zero.ADipow(five).val(), 0);
+    EXPECT_EQ(zero.ADipow(five).dval(1), 0);
+
+    // The log of the logistic does not overflow.
+    ADValue<double> big(800, std::vector<double>{ 1, 0 });
+    EXPECT_EQ(big.ADloglogistic(ten).val(), 0);
+    EXPECT_NEAR(ADValue<double>(-800, 1).ADloglogistic(ten).val(),
+                -800 / log(10.), 1e-9);
+}
@@ -0,0 +1,178 @@
+/* system header files */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <math.h>
+/* googletest header files */
+#include "gtest/gtest.h"
+
+/* header files */
+#include "ADValue.hpp"
+#include "Arena.hpp"
+#include "ArenaADValue.hpp"
+#include "AutoDiffer.hpp"
+#include "PassManager.hpp"
+#include "Tape.hpp"
+#include "test_vars.h"
+
+/*
+ *
+ *
+ * Arena TESTS
+ *
+ *
+ */
+
+const std::vector<std::string> ARENA_TEST_EQS = {
+    "((x^2)+(sin(y)))",
+    "((3*x)*(exp((y/x))))",
+    "((log_2.33_(x))-(cosh(y)))",
+    "(((x*y)+(sin(x)))*((x-y)/(cos(y))))",
+    "((sqrt((x*y)))+((2*x)^3))",
+    "(5)",
+};
+
+static std::vector<std::pair<std::string, ADValue<double>>> ArenaSeeds(
+    double x, double y) {
+    return { { "y", ADValue<double>(y, { 0, 1, 0.5 }) },
+             { "x", ADValue<double>(x, { 1, 0, 0.5 }) } };
+}
+
+// Derives a tape by forward mode on ADValues, the reference.
+static ADValue<double> ForwardDerive(
+    const Tape<double>& tape,
+    const std::vector<std::pair<std::string, ADValue<double>>>& seeds) {
+    std::vector<std::string> names;
+    for (auto& seed : seeds) {
+        names.push_back(seed.first);
+    }
+    std::vector<int> index;
+    tape.ResolveVariables(names, index);
+    std::vector<ADValue<double>> slots;
+    for (int j : index) {
+        slots.push_back(seeds[j].second);
+    }
+    int width = seeds[0].second.dvals().size();
+    return tape.Forward(slots, [width](double c) {
+        return ADValue<double>(c, std::vector<double>(width, 0));
+    });
+}
+
+TEST(arena_allocate, double){
+    Arena arena(256);
+    EXPECT_EQ(arena.NumBlocks(), 0);
+    EXPECT_EQ(arena.CapacityBytes(), 0);
+    char* c = arena.Allocate<char>(3);
+    double* d = arena.Allocate<double>(4);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(d) % alignof(double), 0);
+    EXPECT_NE(static_cast<void*>(c), static_cast<void*>(d));
+    EXPECT_EQ(arena.NumAllocations(), 2);
+    EXPECT_GE(arena.BytesUsed(), 3 + 4 * sizeof(double));
+    // Larger than the rest of the first block.
+    arena.Allocate<double>(100);
+    EXPECT_EQ(arena.NumBlocks(), 2);
+    size_t peak = arena.PeakBytes();
+    size_t capacity = arena.CapacityBytes();
+    EXPECT_GE(capacity, peak);
+
+    // Reset keeps the blocks, so the same allocations fit again.
+    arena.Reset();
+    EXPECT_EQ(arena.BytesUsed(), 0);
+    EXPECT_EQ(arena.NumAllocations(), 0);
+    EXPECT_EQ(arena.Allocate<char>(3), c);
+    EXPECT_EQ(arena.Allocate<double>(4), d);
+    arena.Allocate<double>(100);
+    EXPECT_EQ(arena.NumBlocks(), 2);
+    EXPECT_EQ(arena.CapacityBytes(), capacity);
+    EXPECT_EQ(arena.PeakBytes(), peak);
+
+    // A copy does not share memory.
+    Arena copy(arena);
+    EXPECT_EQ(copy.NumBlocks(), 0);
+}
+
+TEST(arena_advalue_matches_forward, double){
+    for (const std::string& equation : ARENA_TEST_EQS) {
+        Tape<double> tape;
+        ASSERT_EQ(tape.Compile(equation).code, ReturnCode::success);
+        // Fused operations too.
+        PassManager<double>::Default().Run(tape);
+        std::vector<std::pair<std::string, ADValue<double>>> seeds =
+            ArenaSeeds(0.7, 1.3);
+        ADValue<double> expected = ForwardDerive(tape, seeds);
+
+        Arena arena;
+        std::vector<int> index;
+        tape.ResolveVariables({ "y", "x" }, index);
+        std::vector<ArenaADValue<double>> slots;
+        for (int j : index) {
+            slots.push_back(ArenaADValue<double>(seeds[j].second.val(),
+                                                 seeds[j].second.dvals(),
+                                                 arena));
+        }
+        ArenaADValue<double> actual = tape.Forward(
+            slots, [](double c) { return ArenaADValue<double>(c); });
+        EXPECT_NEAR(actual.val(), expected.val(), 1e-12) << equation;
+        std::vector<double> dvals = actual.dvals(3);
+        for (int k = 0; k < 3; ++k) {
+            EXPECT_NEAR(dvals[k], expected.dval(k), 1e-12) << equation;
+        }
+    }
+    // Constants allocate nothing.
+    Arena arena;
+    ArenaADValue<double> c = ArenaADValue<double>(2).ADsin().ADmul(
+        ArenaADValue<double>(3));
+    EXPECT_EQ(c.NumDerivatives(), 0);
+    EXPECT_EQ(c.dval(1), 0);
+    // A power of a negative base with a varying exponent.
+    ArenaADValue<double> x(-0.7, { 1, 0 }, arena);
+    ArenaADValue<double> y(1.3, { 0, 1 }, arena);
+    EXPECT_THROW(x.power(y), std::logic_error);
+    ArenaADValue<double> z = x.power(ArenaADValue<double>(2));
+    EXPECT_NEAR(z.dval(0), 2 * -0.7, 1e-12);
+    EXPECT_EQ(arena.NumAllocations(), 3);
+}
+
+TEST(derive_arena, double){
+    std::vector<std::string> equations = ARENA_TEST_EQS;
+    equations.push_back("((x+w))");
+    AutoDiffer<double> ad;
+    for (auto& seed : ArenaSeeds(0.7, 1.3)) {
+        ad.SetSeedVector(seed.first, seed.second.val(), seed.second.dvals());
+    }
+    size_t capacity = 0;
+    // Twice, the second time in the blocks of the first.
+    for (int pass = 0; pass < 2; ++pass) {
+        std::vector<std::pair<Status, ADValue<double>>> res =
+            ad.DeriveArena(equations);
+        ASSERT_EQ(res.size(), equations.size());
+        for (int i = 0; i < ARENA_TEST_EQS.size(); ++i) {
+            Tape<double> tape;
+            ASSERT_EQ(tape.Compile(equations[i]).code, ReturnCode::success);
+            ADValue<double> expected =
+                ForwardDerive(tape, ArenaSeeds(0.7, 1.3));
+            ASSERT_EQ(res[i].first.code, ReturnCode::success);
+            EXPECT_NEAR(res[i].second.val(), expected.val(), 1e-12);
+            ASSERT_EQ(res[i].second.dvals().size(), 3);
+            for (int k = 0; k < 3; ++k) {
+                EXPECT_NEAR(res[i].second.dval(k), expected.dval(k), 1e-12);
+            }
+        }
+        EXPECT_EQ(res.back().first.code, ReturnCode::parse_error);
+        EXPECT_GT(ad.GetArena().PeakBytes(), 0);
+        if (pass == 0) {
+            capacity = ad.GetArena().CapacityBytes();
+        }
+    }
+    EXPECT_EQ(ad.GetArena().CapacityBytes(), capacity);
+    EXPECT_EQ(ad.GetArena().NumBlocks(), 1);
+
+    ad.SetSeedVector("w", 1, { 1 });
+    std::vector<std::pair<Status, ADValue<double>>> res =
+        ad.DeriveArena(equations);
+    EXPECT_EQ(res[0].first.code, ReturnCode::invalid_argument);
+    EXPECT_EQ(res.back().first.code, ReturnCode::invalid_argument);
+}
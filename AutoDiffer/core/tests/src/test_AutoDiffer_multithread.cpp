@@ -5,7 +5,13 @@
 #include <utility>
 #include <vector>
 #include <math.h>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
 /* googletest header files */
 #include "gtest/gtest.h"
 
@@ -164,6 +170,66 @@ TEST(autodiffer_multithread_openmp_correctness_multiseed, double) {
     }
 }
 
+// Test async version for correctness. multi function derive.
+TEST(autodiffer_async_multifunc, double) {
+    std::future<std::vector<std::pair<Status, ADValue<double>>>> future;
+    std::mutex mutex;
+    std::vector<int> done;
+    {
+        AutoDiffer<double> ad;
+        ad.SetAsyncThreads(3);
+        ad.SetSeed("x", /*value=*/0.5, /*dval=*/1);
+        std::vector<std::string> vec_strings(/*num_eqs=*/20,
+                                             CreateStringEq(100));
+        vec_strings[7] = "(2*y)";
+        future = ad.DeriveAsync(vec_strings,
+            [&](int i, const std::pair<Status, ADValue<double>>&) {
+                std::lock_guard<std::mutex> lock(mutex);
+                done.push_back(i);
+            });
+        // The seeds were copied, the AutoDiffer can go away.
+    }
+    std::vector<std::pair<Status, ADValue<double>>> res = future.get();
+    ASSERT_EQ(res.size(), 20);
+    for (int i = 0; i < res.size(); ++i) {
+        if (i == 7) {
+            EXPECT_EQ(res[i].first.code, ReturnCode::parse_error);
+            continue;
+        }
+        EXPECT_EQ(res[i].first.code, ReturnCode::success);
+        EXPECT_NEAR(res[i].second.val(), 100 * 0.5, 0.001);
+        EXPECT_NEAR(res[i].second.dval(0), 100, 0.001);
+    }
+    // Every item was reported once before the future was ready.
+    std::sort(done.begin(), done.end());
+    ASSERT_EQ(done.size(), 20);
+    for (int i = 0; i < done.size(); ++i) {
+        EXPECT_EQ(done[i], i);
+    }
+}
+
+TEST(autodiffer_async_multiseed, double) {
+    AutoDiffer<double> ad;
+    std::string eq = CreateStringEq(100);
+    std::vector<std::vector<std::pair<std::string, ADValue<double>>>> seeds;
+    for (int i = 0; i < 50; ++i) {
+        seeds.push_back({ { "x", ADValue<double>(i, 1) } });
+    }
+    auto res = ad.DeriveAsync(eq, seeds).get();
+    ASSERT_EQ(res.size(), 50);
+    for (int i = 0; i < 50; ++i) {
+        EXPECT_EQ(res[i].first.code, ReturnCode::success);
+        EXPECT_NEAR(res[i].second.val(), 100 * i, 0.001);
+        EXPECT_NEAR(res[i].second.dval(0), 100, 0.001);
+    }
+    EXPECT_TRUE(ad.DeriveAsync(eq, {}).get().empty());
+
+    // A power of a negative base with a varying exponent throws.
+    seeds = { { { "x", ADValue<double>(-2, 1) } } };
+    auto failed = ad.DeriveAsync("(x^x)", seeds);
+    EXPECT_THROW(failed.get(), std::logic_error);
+}
+
 // Testing OpenMp version. Timing
 TEST(autodiffer_vector_in_LONG, double) {
     AutoDifferOpenMp<double> ad(/*num_threads=*/6);
@@ -206,3 +272,41 @@ TEST(autodiffer_vector_in_LONG_seeds, double) {
         stop - start); 
     std::cout << duration.count() << std::endl; 
 }
+
+TEST(autodiffer_async_reconfigure, double) {
+    AutoDiffer<double> ad;
+    ad.SetAsyncThreads(2);
+    ad.SetSeed("x", /*value=*/0.5, /*dval=*/1);
+    std::vector<std::string> vec_strings(/*num_eqs=*/4, CreateStringEq(10));
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::atomic<int> started(0);
+    auto blocked = ad.DeriveAsync(vec_strings,
+        [&](int, const std::pair<Status, ADValue<double>>&) {
+            ++started;
+            released.wait();
+        });
+    while (started.load() == 0) {
+        std::this_thread::yield();
+    }
+    // Returns while the batch is held on the old workers.
+    ad.SetAsyncThreads(1);
+    EXPECT_EQ(blocked.wait_for(std::chrono::seconds(0)),
+              std::future_status::timeout);
+
+    // Reconfiguring from a callback, i.e., on a worker, does not join it.
+    auto res = ad.DeriveAsync(vec_strings,
+        [&](int, const std::pair<Status, ADValue<double>>&) {
+            ad.SetAsyncThreads(2);
+        }).get();
+    ASSERT_EQ(res.size(), 4);
+    EXPECT_NEAR(res[3].second.val(), 10 * 0.5, 0.001);
+
+    release.set_value();
+    res = blocked.get();
+    ASSERT_EQ(res.size(), 4);
+    for (auto& r : res) {
+        EXPECT_EQ(r.first.code, ReturnCode::success);
+        EXPECT_NEAR(r.second.dval(0), 10, 0.001);
+    }
+}
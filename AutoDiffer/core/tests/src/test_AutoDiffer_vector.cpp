@@ -199,3 +199,191 @@ TEST(autodiffer_vector_3vars, double) {
     EXPECT_NEAR(res.second.dval(1), 390756.9893, 0.001);
     EXPECT_NEAR(res.second.dval(2), 260504.65959, 0.001);
 }
+
+TEST(autodiffer_vector_jvp, double) {
+    // f1 = x*y, f2 = sin(x) + y^2 at (x,y) = (2,3).
+    AutoDiffer<double> ad;
+    std::vector<std::string> equations = { "(x*y)", "((sin(x))+(y^2))" };
+    std::vector<std::pair<std::string, double>> point = {
+        std::pair<std::string, double>("x", 2.),
+        std::pair<std::string, double>("y", 3.) };
+    std::vector<double> v = { 1., -2. };
+    std::pair<Status, std::vector<double>> res = ad.JVP(equations, point, v);
+    ASSERT_EQ(res.first.code, ReturnCode::success);
+    ASSERT_EQ(res.second.size(), 2);
+    EXPECT_NEAR(res.second[0], 3. - 2. * 2., 1e-12);
+    EXPECT_NEAR(res.second[1], cos(2.) - 2. * 6., 1e-12);
+}
+
+TEST(autodiffer_vector_vjp, double) {
+    AutoDiffer<double> ad;
+    std::vector<std::string> equations = { "(x*y)", "((sin(x))+(y^2))" };
+    std::vector<std::pair<std::string, double>> point = {
+        std::pair<std::string, double>("x", 2.),
+        std::pair<std::string, double>("y", 3.) };
+    std::vector<double> w = { 0.5, 2. };
+    std::pair<Status, std::vector<double>> res = ad.VJP(equations, point, w);
+    ASSERT_EQ(res.first.code, ReturnCode::success);
+    ASSERT_EQ(res.second.size(), 2);
+    EXPECT_NEAR(res.second[0], 0.5 * 3. + 2. * cos(2.), 1e-12);
+    EXPECT_NEAR(res.second[1], 0.5 * 2. + 2. * 6., 1e-12);
+}
+
+TEST(autodiffer_vector_jvp_vjp_match_derive, double) {
+    // Both products must agree with the full Jacobian from SetSeedVector.
+    std::vector<std::string> equations = {
+        "(((cos(t))^2)*((tan(q))+4))", "((exp(q))/(logistic(t)))" };
+    AutoDiffer<double> ad;
+    ad.SetSeedVector("t", /*value=*/-1., /*dvals=*/{ 1, 0 });
+    ad.SetSeedVector("q", /*value=*/0.5, /*dvals=*/{ 0, 1 });
+    std::vector<std::pair<Status, ADValue<double>>> jac = ad.Derive(equations);
+    std::vector<std::pair<std::string, double>> point = {
+        std::pair<std::string, double>("t", -1.),
+        std::pair<std::string, double>("q", 0.5) };
+    std::vector<double> v = { 0.7, -1.3 };
+    std::vector<double> w = { 2.1, 0.4 };
+    std::vector<double> jv = ad.JVP(equations, point, v).second;
+    std::vector<double> wj = ad.VJP(equations, point, w).second;
+    for (int i = 0; i < 2; ++i) {
+        EXPECT_NEAR(jv[i], jac[i].second.dval(0) * v[0] +
+                           jac[i].second.dval(1) * v[1], 1e-9);
+        EXPECT_NEAR(wj[i], w[0] * jac[0].second.dval(i) +
+                           w[1] * jac[1].second.dval(i), 1e-9);
+    }
+}
+
+TEST(autodiffer_vector_jvp_invalid, double) {
+    AutoDiffer<double> ad;
+    std::vector<std::string> equations = { "(x*y)" };
+    std::vector<std::pair<std::string, double>> point = {
+        std::pair<std::string, double>("x", 2.) };
+    std::vector<double> v = { 1. };
+    EXPECT_EQ(ad.JVP(equations, point, v).first.message,
+              "Key not found: y");
+    v.push_back(1.);
+    EXPECT_EQ(ad.JVP(equations, point, v).first.code,
+              ReturnCode::invalid_argument);
+    EXPECT_EQ(ad.VJP(equations, point, v).first.code,
+              ReturnCode::invalid_argument);
+}
+
+TEST(autodiffer_vector_chunked, double) {
+    // 20 variables processed in chunks of 8 must match a full seed vector.
+    const int n = 20;
+    // Variables are not named x<i>, which the parser uses for intermediates.
+    std::string eq = "(v0)";
+    std::vector<std::pair<std::string, double>> point;
+    AutoDiffer<double> ad;
+    for (int i = 0; i < n; ++i) {
+        std::string name = "v" + std::to_string(i);
+        if (i > 0) {
+            eq = "((" + eq + "*(sin(" + name + ")))+" + name + ")";
+        }
+        point.push_back(std::pair<std::string, double>(name, 0.1 * (i + 1)));
+        std::vector<double> seed(n, 0);
+        seed[i] = 1;
+        ad.SetSeedVector(name, 0.1 * (i + 1), seed);
+    }
+    std::vector<std::string> equations = { eq, "(v3*v17)", "(2^v0)" };
+    std::vector<std::pair<Status, ADValue<double>>> full = ad.Derive(equations);
+    std::vector<std::pair<Status, ADValue<double>>> chunked =
+        ad.DeriveChunked<8>(equations, point);
+    ASSERT_EQ(chunked.size(), equations.size());
+    for (int e = 0; e < equations.size(); ++e) {
+        ASSERT_EQ(chunked[e].first.code, ReturnCode::success);
+        EXPECT_NEAR(chunked[e].second.val(), full[e].second.val(), 1e-12);
+        for (int i = 0; i < n; ++i) {
+            EXPECT_NEAR(chunked[e].second.dval(i), full[e].second.dval(i),
+                        1e-12);
+        }
+    }
+}
+
+TEST(autodiffer_vector_chunked_invalid, double) {
+    AutoDiffer<double> ad;
+    std::vector<std::pair<std::string, double>> point = {
+        std::pair<std::string, double>("x", 2.) };
+    std::vector<std::string> equations = { "(x*y)", "((x^2)" };
+    std::vector<std::pair<Status, ADValue<double>>> res =
+        ad.DeriveChunked(equations, point);
+    EXPECT_EQ(res[0].first.code, ReturnCode::parse_error);
+    EXPECT_EQ(res[1].first.code, ReturnCode::parse_error);
+}
+
+TEST(autodiffer_vector_evaluate, double) {
+    AutoDiffer<double> ad;
+    // Wide seeds, which a value-only evaluation never touches.
+    ad.SetSeedVector("x", 0.5, std::vector<double>(100, 1));
+    ad.SetSeedVector("y", 2.0, std::vector<double>(100, 1));
+    std::vector<std::string> equations = {
+        "(((sin(x))*(cos(y)))+((exp(x))*y))", "((x^y)/(log_2_(y)))", "(7)" };
+    std::vector<std::pair<Status, double>> values = ad.Evaluate(equations);
+    std::vector<std::pair<Status, ADValue<double>>> full = ad.Derive(equations);
+    ASSERT_EQ(values.size(), equations.size());
+    for (int e = 0; e < equations.size(); ++e) {
+        ASSERT_EQ(values[e].first.code, ReturnCode::success);
+        EXPECT_NEAR(values[e].second, full[e].second.val(), 1e-12);
+    }
+    // Evaluating again reuses the compiled tape.
+    EXPECT_NEAR(ad.Evaluate(equations[0]).second, values[0].second, 1e-15);
+}
+
+TEST(autodiffer_vector_evaluate_invalid, double) {
+    AutoDiffer<double> ad;
+    ad.SetSeed("x", 2.);
+    EXPECT_EQ(ad.Evaluate("(x*y)").first.code, ReturnCode::parse_error);
+    EXPECT_EQ(ad.Evaluate("((x^2)").first.code, ReturnCode::parse_error);
+    EXPECT_EQ(ad.Evaluate("(x*2)").second, 4.);
+}
+
+TEST(autodiffer_vector_sliced, double) {
+    // Many directions, e.g., a Jacobian times a large matrix.
+    int width = 1000;
+    std::vector<double> x_seed(width);
+    std::vector<double> y_seed(width);
+    for (int k = 0; k < width; ++k) {
+        x_seed[k] = sin(k);
+        y_seed[k] = cos(0.5 * k);
+    }
+    AutoDiffer<double> ad;
+    ad.SetSeedVector("x", /*value=*/0.7, /*dvals=*/x_seed);
+    ad.SetSeedVector("y", /*value=*/1.3, /*dvals=*/y_seed);
+    std::string equation = "(((sin(x))*(exp(y)))+((x^2)/y))";
+    // Each direction is the gradient times the seeds.
+    std::vector<std::pair<std::string, double>> point = {
+        { "x", 0.7 }, { "y", 1.3 },
+    };
+    std::pair<Status, ADValue<double>> gradient =
+        ad.DeriveChunked({ equation }, point)[0];
+    ASSERT_EQ(gradient.first.code, ReturnCode::success);
+    for (int threads : { 1, 3, 8 }) {
+        std::pair<Status, ADValue<double>> res =
+            ad.DeriveSliced(equation, threads);
+        ASSERT_EQ(res.first.code, ReturnCode::success);
+        EXPECT_NEAR(res.second.val(), gradient.second.val(), 1e-12);
+        ASSERT_EQ(res.second.dvals().size(), width);
+        for (int k = 0; k < width; ++k) {
+            EXPECT_NEAR(res.second.dval(k),
+                        gradient.second.dval(0) * x_seed[k] +
+                        gradient.second.dval(1) * y_seed[k], 1e-12);
+        }
+    }
+}
+
+TEST(autodiffer_vector_sliced_invalid, double) {
+    AutoDiffer<double> ad;
+    ad.SetSeedVector("x", /*value=*/0.7, /*dvals=*/{ 1, 0 });
+    std::pair<Status, ADValue<double>> res = ad.DeriveSliced("((x*y)+1)", 2);
+    EXPECT_EQ(res.first.code, ReturnCode::parse_error);
+    EXPECT_EQ(res.first.message, "Key not found: y");
+
+    ad.SetSeedVector("y", /*value=*/1.3, /*dvals=*/{ 0, 1, 0 });
+    res = ad.DeriveSliced("((x*y)+1)", 2);
+    EXPECT_EQ(res.first.code, ReturnCode::invalid_argument);
+
+    // A power of a negative base with a varying exponent.
+    AutoDiffer<double> negative;
+    negative.SetSeedVector("x", /*value=*/-0.7, /*dvals=*/{ 1, 0 });
+    negative.SetSeedVector("y", /*value=*/1.3, /*dvals=*/{ 0, 1 });
+    EXPECT_THROW(negative.DeriveSliced("(x^y)", 2), std::logic_error);
+}
@@ -0,0 +1,191 @@
+/* system header files */
+#include <stdlib.h>
+#include <stdio.h>
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <math.h>
+/* googletest header files */
+#include "gtest/gtest.h"
+
+/* header files */
+#include "ADValue.hpp"
+#include "AutoDiffer.hpp"
+#include "DeriveService.hpp"
+#include "MpmcQueue.hpp"
+#include "test_vars.h"
+
+/*
+ *
+ *
+ * DeriveService TESTS
+ *
+ *
+ */
+
+static std::vector<std::pair<std::string, ADValue<double>>> ServiceSeeds(
+    double x, double y) {
+    return { { "x", ADValue<double>(x, { 1, 0 }) },
+             { "y", ADValue<double>(y, { 0, 1 }) } };
+}
+
+TEST(mpmc_queue, double){
+    MpmcQueue<int> queue(5);
+    EXPECT_EQ(queue.Capacity(), 8);
+    int item = -1;
+    EXPECT_FALSE(queue.TryPop(item));
+    for (int i = 0; i < 8; ++i) {
+        EXPECT_TRUE(queue.TryPush(std::move(i)));
+    }
+    EXPECT_FALSE(queue.TryPush(8));
+    for (int i = 0; i < 8; ++i) {
+        ASSERT_TRUE(queue.TryPop(item));
+        EXPECT_EQ(item, i);
+    }
+    EXPECT_FALSE(queue.TryPop(item));
+
+    // The smallest queue has two cells.
+    MpmcQueue<int> smallest(1);
+    EXPECT_EQ(smallest.Capacity(), 2);
+    EXPECT_TRUE(smallest.TryPush(1));
+    EXPECT_TRUE(smallest.TryPush(2));
+    EXPECT_FALSE(smallest.TryPush(3));
+    EXPECT_EQ(MpmcQueue<int>(0).Capacity(), 2);
+
+    // Every item pushed by 4 producers is popped once by 4 consumers.
+    const int num_items = 20000;
+    std::atomic<long long> sum(0);
+    std::atomic<int> popped(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.push_back(std::thread([&queue, t] {
+            for (int i = t; i < num_items; i += 4) {
+                int value = i;
+                while (!queue.TryPush(std::move(value))) {
+                    std::this_thread::yield();
+                }
+            }
+        }));
+        threads.push_back(std::thread([&] {
+            int value;
+            while (popped.load() < num_items) {
+                if (queue.TryPop(value)) {
+                    sum += value;
+                    ++popped;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        }));
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(popped.load(), num_items);
+    EXPECT_EQ(sum.load(), static_cast<long long>(num_items) *
+                          (num_items - 1) / 2);
+}
+
+TEST(derive_service, double){
+    const std::string equation = "(((x*y)+(sin(x)))*((x-y)/(cos(y))))";
+    AutoDiffer<double> ad;
+    std::vector<std::vector<std::pair<std::string, ADValue<double>>>> seeds;
+    for (int i = 0; i < 64; ++i) {
+        seeds.push_back(ServiceSeeds(0.1 + 0.01 * i, 1.3 - 0.01 * i));
+    }
+    std::vector<std::pair<Status, ADValue<double>>> expected =
+        ad.DeriveCompiled(equation, seeds);
+
+    std::atomic<int> num_callbacks(0);
+    std::vector<std::vector<std::pair<Status, ADValue<double>>>> results(4);
+    {
+        DeriveService<double> service(3, 8);
+        EXPECT_EQ(service.NumThreads(), 3);
+        EXPECT_EQ(service.Capacity(), 8);
+        // More requests from 4 threads than the queue holds.
+        std::vector<std::thread> clients;
+        for (int t = 0; t < 4; ++t) {
+            clients.push_back(std::thread([&, t] {
+                std::vector<std::future<std::pair<Status, ADValue<double>>>>
+                    futures;
+                for (int i = t; i < seeds.size(); i += 4) {
+                    futures.push_back(service.Submit(equation, seeds[i],
+                        [&](const std::pair<Status, ADValue<double>>&) {
+                            ++num_callbacks;
+                        }));
+                }
+                for (auto& future : futures) {
+                    results[t].push_back(future.get());
+                }
+            }));
+        }
+        for (std::thread& client : clients) {
+            client.join();
+        }
+        std::pair<Status, ADValue<double>> res =
+            service.Submit("((x+w))", ServiceSeeds(1, 2)).get();
+        EXPECT_EQ(res.first.code, ReturnCode::parse_error);
+        // An undefined derivative completes through the callback too.
+        std::promise<Status> reported;
+        std::future<std::pair<Status, ADValue<double>>> error =
+            service.Submit("((x^y))", ServiceSeeds(-0.7, 1.3),
+                [&](const std::pair<Status, ADValue<double>>& r) {
+                    reported.set_value(r.first);
+                });
+        res = error.get();
+        EXPECT_EQ(res.first.code, ReturnCode::invalid_argument);
+        EXPECT_EQ(res.first.message, "Derivative not defined or complex.");
+        Status status = reported.get_future().get();
+        EXPECT_EQ(status.code, ReturnCode::invalid_argument);
+
+        // A throwing callback does not change the result.
+        res = service.Submit("((x*y))", ServiceSeeds(2, 3),
+            [](const std::pair<Status, ADValue<double>>&) {
+                throw std::runtime_error("callback");
+            }).get();
+        EXPECT_EQ(res.first.code, ReturnCode::success);
+        EXPECT_NEAR(res.second.val(), 6, 1e-12);
+    }
+    EXPECT_EQ(num_callbacks.load(), seeds.size());
+    for (int t = 0; t < 4; ++t) {
+        for (int k = 0; k < results[t].size(); ++k) {
+            int i = t + 4 * k;
+            ASSERT_EQ(results[t][k].first.code, ReturnCode::success);
+            EXPECT_NEAR(results[t][k].second.val(), expected[i].second.val(),
+                        1e-12);
+            EXPECT_NEAR(results[t][k].second.dval(1),
+                        expected[i].second.dval(1), 1e-12);
+        }
+    }
+}
+
+TEST(derive_service_backpressure, double){
+    EXPECT_EQ(DeriveService<double>(1, 1).Capacity(), 2);
+    DeriveService<double> service(1, 2);
+    std::promise<void> started;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    // Holds the only worker until released.
+    std::future<std::pair<Status, ADValue<double>>> first = service.Submit(
+        "((x*y))", ServiceSeeds(2, 3),
+        [&](const std::pair<Status, ADValue<double>>&) {
+            started.set_value();
+            released.wait();
+        });
+    started.get_future().wait();
+    std::future<std::pair<Status, ADValue<double>>> queued[3];
+    EXPECT_TRUE(service.TrySubmit("((x+y))", ServiceSeeds(2, 3), queued[0]));
+    EXPECT_TRUE(service.TrySubmit("((x-y))", ServiceSeeds(2, 3), queued[1]));
+    EXPECT_EQ(service.NumPending(), 2);
+    EXPECT_FALSE(service.TrySubmit("((x/y))", ServiceSeeds(2, 3),
+                                   queued[2]));
+    EXPECT_FALSE(queued[2].valid());
+    release.set_value();
+    EXPECT_NEAR(first.get().second.dval(0), 3, 1e-12);
+    EXPECT_NEAR(queued[0].get().second.val(), 5, 1e-12);
+    EXPECT_NEAR(queued[1].get().second.val(), -1, 1e-12);
+}
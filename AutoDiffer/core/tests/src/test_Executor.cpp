@@ -0,0 +1,140 @@
+/* system header files */
+#include <stdlib.h>
+#include <stdio.h>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <math.h>
+/* googletest header files */
+#include "gtest/gtest.h"
+
+/* header files */
+#include "ADValue.hpp"
+#include "AutoDiffer.hpp"
+#include "Executor.hpp"
+#include "test_vars.h"
+
+/*
+ *
+ *
+ * Executor TESTS
+ *
+ *
+ */
+
+const std::vector<ExecutorPolicy> EXECUTOR_TEST_POLICIES = {
+    ExecutorPolicy::serial, ExecutorPolicy::openmp,
+    ExecutorPolicy::thread_pool, ExecutorPolicy::work_stealing,
+};
+
+TEST(executor_runs_every_item_once, double){
+    for (ExecutorPolicy policy : EXECUTOR_TEST_POLICIES) {
+        Executor executor(policy, 4);
+        // Twice, the second time on the pool started by the first.
+        for (int pass = 0; pass < 2; ++pass) {
+            std::vector<std::atomic<int>> counts(1000);
+            ExecutorStats stats = executor.Run(counts.size(), [&](int i) {
+                // Uneven work, so workers run out at different times.
+                double x = 0;
+                for (int k = 0; k < (i % 7) * 100; ++k) {
+                    x += sin(k);
+                }
+                counts[i] += x == 12345 ? 2 : 1;
+            });
+            for (int i = 0; i < counts.size(); ++i) {
+                EXPECT_EQ(counts[i].load(), 1) << ExecutorPolicyName(policy);
+            }
+            EXPECT_EQ(stats.num_items, 1000);
+#ifndef USE_THREAD
+            if (policy == ExecutorPolicy::openmp) {
+                EXPECT_EQ(stats.policy, ExecutorPolicy::serial);
+                continue;
+            }
+#endif
+            EXPECT_EQ(stats.policy, policy);
+            EXPECT_EQ(stats.num_threads,
+                      policy == ExecutorPolicy::serial ? 1 : 4);
+        }
+    }
+    // Nothing to run in parallel.
+    Executor executor(ExecutorPolicy::work_stealing, 4);
+    int count = 0;
+    ExecutorStats stats = executor.Run(1, [&](int) { ++count; });
+    EXPECT_EQ(count, 1);
+    EXPECT_EQ(stats.policy, ExecutorPolicy::serial);
+    ExecutorStats empty = executor.Run(0, [&](int) { ++count; });
+    EXPECT_EQ(empty.num_items, 0);
+    EXPECT_EQ(count, 1);
+}
+
+TEST(executor_exception, double){
+    for (ExecutorPolicy policy : EXECUTOR_TEST_POLICIES) {
+        Executor executor(policy, 3);
+        EXPECT_THROW(executor.Run(100, [](int i) {
+            if (i == 42) {
+                throw std::runtime_error("item 42");
+            }
+        }), std::runtime_error) << ExecutorPolicyName(policy);
+        // Still usable afterwards.
+        std::atomic<int> count(0);
+        executor.Run(100, [&](int) { ++count; });
+        EXPECT_EQ(count.load(), 100);
+    }
+}
+
+TEST(executor_policy_names, double){
+    for (ExecutorPolicy policy : EXECUTOR_TEST_POLICIES) {
+        ExecutorPolicy parsed = ExecutorPolicy::serial;
+        ASSERT_EQ(ParseExecutorPolicy(ExecutorPolicyName(policy), parsed).code,
+                  ReturnCode::success);
+        EXPECT_EQ(parsed, policy);
+    }
+    ExecutorPolicy parsed = ExecutorPolicy::thread_pool;
+    Status status = ParseExecutorPolicy("fibers", parsed);
+    EXPECT_EQ(status.code, ReturnCode::invalid_argument);
+    EXPECT_EQ(status.message, "Unknown executor policy: fibers");
+    EXPECT_EQ(parsed, ExecutorPolicy::thread_pool);
+}
+
+TEST(executor_auto_differ, double){
+    std::vector<std::string> equations;
+    for (int i = 0; i < 50; ++i) {
+        equations.push_back("((x^" + std::to_string(i % 5 + 1) +
+                            ")*(sin(y)))");
+    }
+    std::vector<std::vector<std::pair<std::string, ADValue<double>>>> seeds;
+    for (int i = 0; i < 50; ++i) {
+        seeds.push_back({ { "x", ADValue<double>(0.1 * i, { 1, 0 }) },
+                          { "y", ADValue<double>(0.5, { 0, 1 }) } });
+    }
+    AutoDiffer<double> serial;
+    serial.SetSeedVector("x", 0.7, { 1, 0 });
+    serial.SetSeedVector("y", 0.5, { 0, 1 });
+    std::vector<std::pair<Status, ADValue<double>>> expected =
+        serial.Derive(equations);
+    std::vector<std::pair<Status, ADValue<double>>> expected_seeds =
+        serial.Derive(equations[3], seeds);
+    EXPECT_EQ(serial.Stats().policy, ExecutorPolicy::serial);
+
+    for (ExecutorPolicy policy : EXECUTOR_TEST_POLICIES) {
+        AutoDiffer<double> ad;
+        ad.SetExecutor(policy, 3);
+        ad.SetSeedVector("x", 0.7, { 1, 0 });
+        ad.SetSeedVector("y", 0.5, { 0, 1 });
+        std::vector<std::pair<Status, ADValue<double>>> res =
+            ad.Derive(equations);
+        EXPECT_EQ(ad.Stats().num_items, 50);
+        ASSERT_EQ(res.size(), expected.size());
+        for (int i = 0; i < res.size(); ++i) {
+            EXPECT_EQ(res[i].first.code, ReturnCode::success);
+            EXPECT_EQ(res[i].second, expected[i].second);
+        }
+        res = ad.Derive(equations[3], seeds);
+        ASSERT_EQ(res.size(), expected_seeds.size());
+        for (int i = 0; i < res.size(); ++i) {
+            EXPECT_EQ(res[i].second, expected_seeds[i].second);
+        }
+    }
+}
@@ -0,0 +1,65 @@
+/* system header files */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include <math.h>
+#include <chrono>
+/* googletest header files */
+#include "gtest/gtest.h"
+
+/* header files */
+#include "ADValue.hpp"
+#include "ADNode.hpp"
+#include "FixedADValue.hpp"
+#include "test_vars.h"
+
+/*
+ *
+ * 
+ * FixedADValue TESTS
+ * 
+ * 
+*/
+
+TEST(fixed_advalue_mul, double){
+    FixedADValue<double, 2> x(3, {{ 1, 0 }});
+    FixedADValue<double, 2> y(-2, {{ 0, 1 }});
+    FixedADValue<double, 2> res = x.ADmul(y);
+    EXPECT_EQ(res.val(), -6);
+    EXPECT_EQ(res.dval(0), -2);
+    EXPECT_EQ(res.dval(1), 3);
+}
+
+TEST(fixed_advalue_matches_advalue, double){
+    // Every operation must agree with the ADValue rules.
+    std::vector<Operation> ops = {
+        Operation::addition, Operation::subtraction,
+        Operation::multiplication, Operation::division, Operation::power,
+        Operation::sin, Operation::cos, Operation::tan, Operation::exp,
+        Operation::arcsin, Operation::arccos, Operation::arctan,
+        Operation::sinh, Operation::cosh, Operation::tanh,
+        Operation::logistic, Operation::log, Operation::sqrt };
+    for (Operation op : ops) {
+        FixedADValue<double, 2> fa(0.4, {{ 1, 0.5 }});
+        FixedADValue<double, 2> fb(2.5, {{ 0, 1 }});
+        ADValue<double> a(0.4, { 1, 0.5 });
+        ADValue<double> b(2.5, { 0, 1 });
+        FixedADValue<double, 2> fres = EvaluateOperation(op, fa, fb);
+        ADValue<double> res = EvaluateOperation(op, a, b);
+        EXPECT_NEAR(fres.val(), res.val(), 1e-12) << static_cast<int>(op);
+        EXPECT_NEAR(fres.dval(0), res.dval(0), 1e-12) << static_cast<int>(op);
+        EXPECT_NEAR(fres.dval(1), res.dval(1), 1e-12) << static_cast<int>(op);
+    }
+}
+
+TEST(fixed_advalue_negative_base, double){
+    FixedADValue<double, 1> base(-2, {{ 1 }});
+    FixedADValue<double, 1> constant(3);
+    FixedADValue<double, 1> variable(3, {{ 1 }});
+    FixedADValue<double, 1> res = base.power(constant);
+    EXPECT_EQ(res.val(), -8);
+    EXPECT_EQ(res.dval(0), 12);
+    EXPECT_THROW(base.power(variable), std::logic_error);
+}
@@ -0,0 +1,85 @@
+/* system header files */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include <math.h>
+#include <chrono>
+/* googletest header files */
+#include "gtest/gtest.h"
+
+/* header files */
+#include "ADValue.hpp"
+#include "ADNode.hpp"
+#include "AutoDiffer.hpp"
+#include "IncrementalDiffer.hpp"
+#include "test_vars.h"
+
+/*
+ *
+ * 
+ * IncrementalDiffer TESTS
+ * 
+ * 
+*/
+
+// Seeds for x and y with unit derivatives.
+std::vector<std::pair<std::string, ADValue<double>>> IncrementalSeeds(
+    double x, double y) {
+    std::vector<std::pair<std::string, ADValue<double>>> seeds = {
+        std::pair<std::string, ADValue<double>>(
+            "x", ADValue<double>(x, std::vector<double>{ 1, 0 })),
+        std::pair<std::string, ADValue<double>>(
+            "y", ADValue<double>(y, std::vector<double>{ 0, 1 })),
+    };
+    return seeds;
+}
+
+TEST(incremental_basic, double){
+    std::string eq = "(((sin(x))*(cos(x)))+((exp(x))*y))";
+    IncrementalDiffer<double> inc(eq);
+    ASSERT_EQ(inc.Init(IncrementalSeeds(0.5, 2.0)).code, ReturnCode::success);
+    EXPECT_EQ(inc.LastUpdateSize(), 9);
+
+    // Only the product with y and the final sum depend on y.
+    std::pair<Status, ADValue<double>> res = inc.UpdateSeed("y", 3.0);
+    ASSERT_EQ(res.first.code, ReturnCode::success);
+    EXPECT_EQ(inc.LastUpdateSize(), 2);
+
+    // Must match a full evaluation at the new point.
+    AutoDiffer<double> ad;
+    ad.SetSeedVector("x", 0.5, { 1, 0 });
+    ad.SetSeedVector("y", 3.0, { 0, 1 });
+    ADValue<double> expected = ad.Derive(eq).second;
+    EXPECT_EQ(res.second, expected);
+    EXPECT_EQ(inc.Run().second, expected);
+}
+
+TEST(incremental_update_both, double){
+    std::string eq = "((x^2)*(y/(x+1)))";
+    IncrementalDiffer<double> inc(eq);
+    ASSERT_EQ(inc.Init(IncrementalSeeds(1.0, 1.0)).code, ReturnCode::success);
+    inc.UpdateSeed("x", 2.0);
+    std::pair<Status, ADValue<double>> res = inc.UpdateSeed("y", -4.0);
+    ASSERT_EQ(res.first.code, ReturnCode::success);
+    // f = x^2 y / (x+1) at (2,-4).
+    EXPECT_NEAR(res.second.val(), -16. / 3., 1e-12);
+    EXPECT_NEAR(res.second.dval(0), -4. * (4. + 4.) / 9., 1e-12);
+    EXPECT_NEAR(res.second.dval(1), 4. / 3., 1e-12);
+}
+
+TEST(incremental_unused_and_unknown, double){
+    IncrementalDiffer<double> inc("(sin(x))");
+    ASSERT_EQ(inc.Init(IncrementalSeeds(1.0, 1.0)).code, ReturnCode::success);
+    EXPECT_EQ(inc.UpdateSeed("y", 5.0).first.code, ReturnCode::success);
+    EXPECT_EQ(inc.LastUpdateSize(), 0);
+    EXPECT_EQ(inc.UpdateSeed("z", 5.0).first.code, ReturnCode::parse_error);
+}
+
+TEST(incremental_invalid, double){
+    IncrementalDiffer<double> inc("(sin(q))");
+    Status status = inc.Init(IncrementalSeeds(1.0, 1.0));
+    EXPECT_EQ(status.code, ReturnCode::parse_error);
+    EXPECT_EQ(inc.Run().first.code, ReturnCode::parse_error);
+}
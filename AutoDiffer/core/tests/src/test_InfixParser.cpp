@@ -0,0 +1,267 @@
+/* system header files */
+#include <algorithm>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include <math.h>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+/* googletest header files */
+#include "gtest/gtest.h"
+
+/* header files */
+#include "ADValue.hpp"
+#include "ADNode.hpp"
+#include "AutoDiffer.hpp"
+#include "InfixParser.hpp"
+#include "MappedFile.hpp"
+#include "Parser.hpp"
+#include "PassManager.hpp"
+#include "Tape.hpp"
+#include "test_vars.h"
+
+/*
+ *
+ *
+ * InfixParser TESTS
+ *
+ *
+*/
+
+// Infix equations and their fully parenthesized equivalents.
+const std::vector<std::pair<std::string, std::string>> INFIX_TEST_EQS = {
+    { "x^2 + y^2*sin(x)", "((x^2)+((y^2)*(sin(x))))" },
+    { "(x^2 + y^2) * sin(x)", "(((x^2)+(y^2))*(sin(x)))" },
+    { "x - y - 2", "((x-y)-2)" },
+    { "x / y / 2", "((x/y)/2)" },
+    { "2^x^2", "(2^(x^2))" },
+    { "-x^2", "(-(x^2))" },
+    { "-x*y", "((-x)*y)" },
+    { "x*-y", "(x*(-y))" },
+    { "--x", "(-(-x))" },
+    { "exp(-x) + log_2_(x + 1)", "((exp(-x))+(log_2_(x+1)))" },
+    { "logistic(x)*sqrt(y) - arctan(x*y)",
+      "(((logistic(x))*(sqrt(y)))-(arctan(x*y)))" },
+    { "sinh(x)+cosh(y)+tanh(x)", "(((sinh(x))+(cosh(y)))+(tanh(x)))" },
+    { "  1.5e1 * x ", "(15*x)" },
+};
+
+// Value and derivatives of a tape at (x, y) = (0.6, 1.7).
+ADValue<double> InfixForward(const Tape<double>& tape) {
+    std::vector<ADValue<double>> slots;
+    for (const std::string& name : tape.Variables()) {
+        slots.push_back(name == "x" ?
+            ADValue<double>(0.6, std::vector<double>{ 1, 0 }) :
+            ADValue<double>(1.7, std::vector<double>{ 0, 1 }));
+    }
+    return tape.Forward(slots, [](double c) {
+        return ADValue<double>(c, std::vector<double>{ 0, 0 }); });
+}
+
+TEST(infix_matches_parenthesized, double){
+    for (auto& eq : INFIX_TEST_EQS) {
+        Tape<double> infix;
+        InfixParser<double> parser(eq.first);
+        ASSERT_EQ(parser.Compile(infix).code, ReturnCode::success) << eq.first;
+        Tape<double> parenthesized;
+        ASSERT_EQ(parenthesized.Compile(eq.second).code, ReturnCode::success)
+            << eq.second;
+        // Variables are in reading order, which may differ between the two.
+        std::vector<std::string> infix_vars = infix.Variables();
+        std::vector<std::string> parenthesized_vars = parenthesized.Variables();
+        std::sort(infix_vars.begin(), infix_vars.end());
+        std::sort(parenthesized_vars.begin(), parenthesized_vars.end());
+        EXPECT_EQ(infix_vars, parenthesized_vars) << eq.first;
+        ADValue<double> expected = InfixForward(parenthesized);
+        ADValue<double> result = InfixForward(infix);
+        EXPECT_NEAR(result.val(), expected.val(), 1e-12) << eq.first;
+        EXPECT_NEAR(result.dval(0), expected.dval(0), 1e-12) << eq.first;
+        EXPECT_NEAR(result.dval(1), expected.dval(1), 1e-12) << eq.first;
+    }
+}
+
+TEST(infix_same_tape, double){
+    // After optimization both front ends give the same instructions.
+    Tape<double> infix;
+    InfixParser<double> parser("(x^2 + y^2) * sin(x)");
+    ASSERT_EQ(parser.Compile(infix).code, ReturnCode::success);
+    // No lone values, so nothing for the passes to remove.
+    EXPECT_EQ(infix.Instructions().size(), 5);
+    Tape<double> parenthesized;
+    ASSERT_EQ(parenthesized.Compile("(((x^2)+(y^2))*(sin(x)))").code,
+              ReturnCode::success);
+    PassManager<double> passes = PassManager<double>::Default();
+    passes.Run(infix);
+    passes.Run(parenthesized);
+    EXPECT_EQ(infix.Dump(), parenthesized.Dump());
+}
+
+TEST(infix_errors, double){
+    Tape<double> tape;
+    EXPECT_EQ(InfixParser<double>("x +").Compile(tape).message,
+              "Unexpected end of input at position 3");
+    EXPECT_EQ(InfixParser<double>("(x + y").Compile(tape).message,
+              "Expected \')\' at position 6");
+    EXPECT_EQ(InfixParser<double>("x y").Compile(tape).message,
+              "Unexpected \'y\' at position 2");
+    EXPECT_EQ(InfixParser<double>("foo(x)").Compile(tape).message,
+              "Unknown function foo at position 3");
+    EXPECT_EQ(InfixParser<double>("sin x").Compile(tape).message,
+              "Expected \'(\' after sin at position 4");
+    EXPECT_EQ(InfixParser<double>("1.2.3").Compile(tape).code,
+              ReturnCode::parse_error);
+    EXPECT_EQ(InfixParser<double>("log_(x)").Compile(tape).code,
+              ReturnCode::parse_error);
+    EXPECT_EQ(InfixParser<double>("").Compile(tape).code,
+              ReturnCode::parse_error);
+}
+
+TEST(infix_autodiffer, double){
+    AutoDiffer<double> ad;
+    ad.SetSeed("x", 0.6);
+    ad.SetSyntax(Syntax::infix);
+    std::pair<Status, double> value = ad.Evaluate("x^2 + 3*x");
+    ASSERT_EQ(value.first.code, ReturnCode::success);
+    EXPECT_NEAR(value.second, 0.36 + 1.8, 1e-12);
+    std::vector<std::pair<std::string, double>> point = {
+        std::pair<std::string, double>("x", 0.6) };
+    std::pair<Status, std::vector<double>> jvp =
+        ad.JVP({ "x^2 + 3*x" }, point, { 1.0 });
+    EXPECT_NEAR(jvp.second[0], 1.2 + 3, 1e-12);
+    // The parenthesized syntax is no longer accepted by these modes.
+    EXPECT_EQ(ad.Evaluate("((x^2)+(3*x)))").first.code,
+              ReturnCode::parse_error);
+}
+
+// "((((x)+x)+x)+x)" with the given number of nested groups, as in the
+// multithreading examples. It is valid in both syntaxes.
+std::string NestedSum(int depth) {
+    std::string eq(depth, '(');
+    eq += "x)";
+    for (int i = 1; i < depth; ++i) {
+        eq += "+x)";
+    }
+    return eq;
+}
+
+TEST(infix_deep_nesting, double){
+    // Deep enough to overflow the stack of a recursive parser.
+    const int depth = 1000000;
+    std::string sum = NestedSum(depth);
+    Tape<double> tape;
+    ASSERT_EQ(InfixParser<double>(sum).Compile(tape).code, ReturnCode::success);
+    EXPECT_EQ(tape.Instructions().size(), depth - 1);
+    std::vector<double> slots = { 0.5 };
+    EXPECT_NEAR(tape.Primal(slots), 0.5 * depth, 1e-6);
+    std::vector<double> adjoints;
+    tape.Adjoint(slots, 1.0, adjoints);
+    EXPECT_NEAR(adjoints[0], depth, 1e-6);
+
+    // The passes and the parenthesized compiler are iterative as well.
+    PassManager<double>::Default().Run(tape);
+    tape.ReuseSlots();
+    slots = { 0.5 };
+    EXPECT_NEAR(tape.Primal(slots), 0.5 * depth, 1e-6);
+    Tape<double> parenthesized;
+    ASSERT_EQ(parenthesized.Compile(sum).code, ReturnCode::success);
+    slots = { 0.5 };
+    EXPECT_NEAR(parenthesized.Primal(slots), 0.5 * depth, 1e-6);
+
+    // Nested calls and a chain of unary minus.
+    std::string calls;
+    for (int i = 0; i < depth; ++i) {
+        calls += "sin(";
+    }
+    calls += "x" + std::string(depth, ')');
+    ASSERT_EQ(InfixParser<double>(calls).Compile(tape).code,
+              ReturnCode::success);
+    EXPECT_EQ(tape.Instructions().size(), depth);
+    std::string negations = std::string(depth, '-') + "x";
+    ASSERT_EQ(InfixParser<double>(negations).Compile(tape).code,
+              ReturnCode::success);
+    slots = { 0.5 };
+    EXPECT_EQ(tape.Primal(slots), 0.5);
+
+    // Unbalanced input fails cleanly.
+    std::string small_sum = NestedSum(1000);
+    EXPECT_EQ(InfixParser<double>(small_sum.substr(1)).Compile(tape).message,
+              "Unexpected \')\' at position 3997");
+    EXPECT_EQ(InfixParser<double>(small_sum.substr(0, small_sum.size() - 1))
+              .Compile(tape).message, "Expected \')\' at position 3998");
+}
+
+TEST(infix_stream, double){
+    // Long names and numbers so that tokens straddle the chunks of the
+    // stream, and a log base in every term.
+    std::string eq;
+    for (int i = 0; i < 5000; ++i) {
+        eq += (i == 0 ? "" : " + ") + std::string("variable_") +
+              std::to_string(i % 7) + " * 1.2345678e-1 * log_base_(v" +
+              std::to_string(i % 3) + ")";
+    }
+    ASSERT_GT(eq.size(), 3 * (1 << 16));
+    Tape<double> from_string;
+    InfixParser<double> string_parser(eq);
+    ASSERT_EQ(string_parser.Compile(from_string).code, ReturnCode::success);
+    EXPECT_EQ(string_parser.BytesRead(), eq.size());
+
+    std::istringstream stream(eq);
+    Tape<double> from_stream;
+    InfixParser<double> stream_parser(stream);
+    ASSERT_EQ(stream_parser.Compile(from_stream).code, ReturnCode::success);
+    EXPECT_EQ(stream_parser.BytesRead(), eq.size());
+    EXPECT_EQ(from_stream.Dump(), from_string.Dump());
+
+    Tape<double> from_buffer;
+    InfixParser<double> buffer_parser(eq.data(), eq.size());
+    ASSERT_EQ(buffer_parser.Compile(from_buffer).code, ReturnCode::success);
+    EXPECT_EQ(from_buffer.Dump(), from_string.Dump());
+
+    // Errors report the position in the whole stream.
+    std::istringstream bad(eq + " + )");
+    EXPECT_EQ(InfixParser<double>(bad).Compile(from_stream).message,
+              "Unexpected \')\' at position " + std::to_string(eq.size() + 3));
+}
+
+TEST(infix_hash_consing, double){
+    std::string eq = "sin(x)*sin(x) + sin(x)*sin(x) + (y*x + x*y)";
+    Tape<double> plain;
+    ASSERT_EQ(InfixParser<double>(eq).Compile(plain).code,
+              ReturnCode::success);
+    EXPECT_EQ(plain.Instructions().size(), 11);
+    Tape<double> consed;
+    InfixParser<double> parser(eq);
+    parser.SetHashConsing(true);
+    ASSERT_EQ(parser.Compile(consed).code, ReturnCode::success);
+    // sin, *, +, x*y, + and the final +.
+    EXPECT_EQ(consed.Instructions().size(), 6);
+    EliminateCommonSubexpressions(plain);
+    EXPECT_EQ(consed.Dump(), plain.Dump());
+}
+
+TEST(infix_file, double){
+    std::string path = "test_infix_file.txt";
+    {
+        std::ofstream file(path.c_str());
+        file << "x^2 +\n  3*sin(x)\n";
+    }
+    Tape<double> tape;
+    size_t bytes = 0;
+    ASSERT_EQ(CompileInfixFile(path, tape, &bytes).code, ReturnCode::success);
+    EXPECT_EQ(bytes, 17);
+    std::vector<double> slots = { 0.5 };
+    EXPECT_NEAR(tape.Primal(slots), 0.25 + 3 * sin(0.5), 1e-12);
+
+    MappedFile mapped;
+    ASSERT_EQ(mapped.Open(path).code, ReturnCode::success);
+    EXPECT_EQ(std::string(mapped.data(), mapped.size()),
+              "x^2 +\n  3*sin(x)\n");
+    remove(path.c_str());
+
+    EXPECT_EQ(CompileInfixFile("no_such_file.txt", tape).code,
+              ReturnCode::invalid_argument);
+}
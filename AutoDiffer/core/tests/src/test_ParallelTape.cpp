@@ -0,0 +1,147 @@
+/* system header files */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <math.h>
+/* googletest header files */
+#include "gtest/gtest.h"
+
+/* header files */
+#include "ADValue.hpp"
+#include "AutoDiffer.hpp"
+#include "InfixParser.hpp"
+#include "ParallelTape.hpp"
+#include "PassManager.hpp"
+#include "Tape.hpp"
+#include "test_vars.h"
+
+/*
+ *
+ *
+ * ParallelTape TESTS
+ *
+ *
+ */
+
+// A sum of many independent terms, so the first levels are wide.
+static std::string WideEquation(int terms) {
+    std::string equation = "x*y";
+    for (int k = 1; k < terms; ++k) {
+        std::string c = std::to_string(k);
+        equation += " + sin(x*" + c + ")*exp(y/" + c + ") + x^" + c;
+    }
+    return equation;
+}
+
+static Tape<double> CompileWide(int terms) {
+    Tape<double> tape;
+    InfixParser<double>(WideEquation(terms)).Compile(tape);
+    PassManager<double>::Default().Run(tape);
+    return tape;
+}
+
+TEST(parallel_tape_levels, double){
+    Tape<double> tape;
+    ASSERT_EQ(tape.Compile("(((x*y)+(sin(x)))*((x-y)/(cos(y))))").code,
+              ReturnCode::success);
+    PassManager<double>::Default().Run(tape);
+    ParallelTape<double> parallel(tape, 1);
+    // sin(x), x-y and cos(y) first, then the fused x*y + sin(x) and the
+    // division, then the product.
+    EXPECT_EQ(parallel.NumLevels(), 3);
+    EXPECT_EQ(parallel.NumStages(), 3);
+    EXPECT_EQ(parallel.NumParallelStages(), 2);
+    ASSERT_EQ(parallel.View().NumInstructions(), 6);
+    EXPECT_EQ(parallel.View().Instructions()[5].op,
+              Operation::multiplication);
+
+    // With the default grain every level is too cheap to split.
+    ParallelTape<double> serial(tape);
+    EXPECT_EQ(serial.NumStages(), 1);
+    EXPECT_EQ(serial.NumParallelStages(), 0);
+
+    tape.ReuseSlots();
+    EXPECT_THROW(ParallelTape<double> reused(tape), std::logic_error);
+}
+
+TEST(parallel_tape_matches_serial, double){
+    Tape<double> tape = CompileWide(200);
+    std::vector<double> slots = { 0.3, 1.7 };
+    double expected = tape.Primal(slots);
+    std::vector<ADValue<double>> values = {
+        ADValue<double>(0.3, { 1, 0 }), ADValue<double>(1.7, { 0, 1 }),
+    };
+    auto constant = [](double c) { return ADValue<double>(c, { 0, 0 }); };
+    std::vector<ADValue<double>> serial_values = values;
+    ADValue<double> expected_ad = tape.Forward(serial_values, constant);
+
+    for (int grain : { 1, 16, kParallelChunkCost }) {
+        ParallelTape<double> parallel(tape, grain);
+        if (grain == 16) {
+            EXPECT_GT(parallel.NumParallelStages(), 0);
+        }
+        for (int threads : { 1, 2, 4 }) {
+            // The same operations on the same values, so exactly equal.
+            std::vector<double> parallel_slots = { 0.3, 1.7 };
+            EXPECT_EQ(parallel.Primal(parallel_slots, threads), expected);
+            std::vector<ADValue<double>> parallel_values = values;
+            ADValue<double> actual =
+                parallel.Forward(parallel_values, constant, threads);
+            EXPECT_EQ(actual.val(), expected_ad.val());
+            EXPECT_EQ(actual.dval(0), expected_ad.dval(0));
+            EXPECT_EQ(actual.dval(1), expected_ad.dval(1));
+        }
+    }
+}
+
+TEST(parallel_tape_exception, double){
+    // The power of a negative base with a varying exponent throws, on
+    // whichever thread evaluates it.
+    Tape<double> tape;
+    ASSERT_EQ(InfixParser<double>(WideEquation(100) + " + (0 - x)^y")
+                  .Compile(tape).code, ReturnCode::success);
+    ParallelTape<double> parallel(tape, 4);
+    ASSERT_GT(parallel.NumParallelStages(), 0);
+    std::vector<ADValue<double>> values = {
+        ADValue<double>(0.3, { 1, 0 }), ADValue<double>(1.7, { 0, 1 }),
+    };
+    auto constant = [](double c) { return ADValue<double>(c, { 0, 0 }); };
+    for (int threads : { 1, 4 }) {
+        std::vector<ADValue<double>> slots = values;
+        EXPECT_THROW(parallel.Forward(slots, constant, threads),
+                     std::logic_error);
+    }
+}
+
+TEST(derive_parallel, double){
+    std::vector<std::pair<std::string, double>> point = {
+        { "z", 0.5 }, { "y", 1.7 }, { "x", 0.3 },
+    };
+    AutoDiffer<double> ad;
+    ad.SetSyntax(Syntax::infix);
+    std::vector<std::string> equations = {
+        WideEquation(300), "x + y", "x + w",
+    };
+    std::vector<std::pair<Status,ADValue<double>>> expected =
+        ad.DeriveChunked(equations, point);
+    // Twice, the second time from the cache.
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int i = 0; i < 2; ++i) {
+            std::pair<Status,ADValue<double>> actual =
+                ad.DeriveParallel(equations[i], point, 4);
+            ASSERT_EQ(actual.first.code, ReturnCode::success);
+            EXPECT_NEAR(actual.second.val(), expected[i].second.val(), 1e-9);
+            for (int k = 0; k < point.size(); ++k) {
+                EXPECT_NEAR(actual.second.dval(k),
+                            expected[i].second.dval(k), 1e-9);
+            }
+        }
+    }
+    std::pair<Status,ADValue<double>> missing =
+        ad.DeriveParallel(equations[2], point, 4);
+    EXPECT_EQ(missing.first.code, ReturnCode::parse_error);
+    EXPECT_EQ(missing.first.message, "Key not found: w");
+}
@@ -249,3 +249,60 @@ TEST(parser_test_invalid_sin_no_parens, double){
     ASSERT_EQ(res.first.code, ReturnCode::parse_error);
     ASSERT_EQ(res.first.message, "Invalid argument to sin");
 }
+
+TEST(parser_test_log_and_hyperbolic, double){
+    std::string equation = "((log_2_(x))+((sinh(x))*(logistic(x))))";
+    Parser<double> parser(equation);
+
+    ADValue<double> seed_value(/*value=*/1.5, /*seed=*/1.0);
+    std::pair<std::string, ADValue<double>> seed("x", seed_value);
+    std::vector<std::pair<std::string, ADValue<double>>> seeds = { seed };
+    ASSERT_EQ(parser.Init(seeds).code, ReturnCode::success);
+    std::pair<Status,ADValue<double>> res = parser.Run();
+    ASSERT_EQ(res.first.code, ReturnCode::success);
+
+    double logistic = 1 / (1 + exp(-1.5));
+    EXPECT_NEAR(res.second.val(), log2(1.5) + sinh(1.5) * logistic, 1e-12);
+    EXPECT_NEAR(res.second.dval(0),
+                1 / (1.5 * log(2)) + cosh(1.5) * logistic +
+                sinh(1.5) * logistic * (1 - logistic), 1e-12);
+}
+
+TEST(parser_test_keyword_table, double){
+    // The hash is perfect: every keyword is found in its own slot.
+    for (const Keyword& keyword : kKeywords) {
+        const Keyword* found = LookupKeyword(keyword.name);
+        ASSERT_NE(found, nullptr) << keyword.name;
+        EXPECT_EQ(found->op, keyword.op) << keyword.name;
+    }
+    EXPECT_EQ(LookupKeyword("sine"), nullptr);
+    EXPECT_EQ(LookupKeyword("sinhx"), nullptr);
+    EXPECT_EQ(LookupKeyword("si"), nullptr);
+    EXPECT_EQ(LookupKeyword("x0"), nullptr);
+
+    // Prefixes, the longest one wins.
+    EXPECT_EQ(MatchKeyword("sinhx0")->op, Operation::sinh);
+    EXPECT_EQ(MatchKeyword("sinx0")->op, Operation::sin);
+    EXPECT_EQ(MatchKeyword("logisticx0")->op, Operation::logistic);
+    EXPECT_EQ(MatchKeyword("log_2_x0")->op, Operation::log);
+    EXPECT_EQ(MatchKeyword("arctanx0")->op, Operation::arctan);
+    EXPECT_EQ(MatchKeyword("x0sin"), nullptr);
+}
+
+TEST(parser_test_string_view, double){
+    std::string equation = "(sinhx0)";
+    StringView group = StringView(equation).substr(1, 6);
+    EXPECT_EQ(group, "sinhx0");
+    EXPECT_EQ(group.data(), equation.data() + 1);
+    EXPECT_EQ(group.substr(4), "x0");
+    EXPECT_EQ(group.substr(4, 100), "x0");
+    EXPECT_TRUE(group.substr(6).empty());
+    EXPECT_THROW(group.substr(7), std::out_of_range);
+    EXPECT_EQ(group.find('x'), 4);
+    EXPECT_EQ(group.find('('), StringView::npos);
+    EXPECT_EQ(StringView("x0^2").find_first_of("+^-/*"), 2);
+    EXPECT_TRUE(group.starts_with("sin"));
+    EXPECT_FALSE(group.starts_with("cos"));
+    EXPECT_NE(group, "sinh");
+    EXPECT_EQ(group.ToString(), "sinhx0");
+}
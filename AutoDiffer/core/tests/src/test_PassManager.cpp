@@ -0,0 +1,101 @@
+/* system header files */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include <math.h>
+#include <chrono>
+/* googletest header files */
+#include "gtest/gtest.h"
+
+/* header files */
+#include "ADValue.hpp"
+#include "ADNode.hpp"
+#include "AutoDiffer.hpp"
+#include "Parser.hpp"
+#include "PassManager.hpp"
+#include "Tape.hpp"
+#include "test_vars.h"
+
+/*
+ *
+ *
+ * PassManager TESTS
+ *
+ *
+*/
+
+const std::string PASS_MANAGER_EQ =
+    "(((((x*1)^2)+(sin(x)))+(sin(x)))*((2^3)+y))";
+
+TEST(pass_manager_default, double){
+    Tape<double> tape;
+    ASSERT_EQ(tape.Compile(PASS_MANAGER_EQ).code, ReturnCode::success);
+    std::vector<double> slots = { 0.4, 1.5 };
+    double expected = tape.Primal(slots);
+    int ops_before = tape.Instructions().size();
+
+    PassManager<double> passes = PassManager<double>::Default();
+    std::vector<std::string> names = {
+        "fold", "strength_reduce", "cse", "fuse", "dce" };
+    EXPECT_EQ(passes.Passes(), names);
+    passes.Run(tape);
+    ASSERT_EQ(passes.Stats().size(), 5);
+    EXPECT_EQ(passes.Stats()[0].ops_before, ops_before);
+    for (int i = 1; i < passes.Stats().size(); ++i) {
+        EXPECT_EQ(passes.Stats()[i].ops_before, passes.Stats()[i - 1].ops_after);
+        EXPECT_GE(passes.Stats()[i].seconds, 0);
+        EXPECT_TRUE(passes.Stats()[i].dump.empty());
+    }
+    EXPECT_LT(passes.Stats().back().ops_after, ops_before);
+    slots = { 0.4, 1.5 };
+    EXPECT_NEAR(tape.Primal(slots), expected, 1e-12);
+}
+
+TEST(pass_manager_order_and_disable, double){
+    Tape<double> tape;
+    ASSERT_EQ(tape.Compile(PASS_MANAGER_EQ).code, ReturnCode::success);
+    std::vector<double> slots = { 0.4, 1.5 };
+    double expected = tape.Primal(slots);
+
+    PassManager<double> passes;
+    EXPECT_EQ(passes.AddPass("dce").code, ReturnCode::success);
+    EXPECT_EQ(passes.AddPass("cse").code, ReturnCode::success);
+    EXPECT_EQ(passes.AddPass("liveness").code, ReturnCode::success);
+    EXPECT_EQ(passes.AddPass("inline").code, ReturnCode::invalid_argument);
+    EXPECT_EQ(passes.SetEnabled("dce", false).code, ReturnCode::success);
+    EXPECT_EQ(passes.SetEnabled("fold", false).code,
+              ReturnCode::invalid_argument);
+    passes.SetDump(true);
+    passes.Run(tape);
+    ASSERT_EQ(passes.Stats().size(), 2);
+    EXPECT_EQ(passes.Stats()[0].name, "cse");
+    EXPECT_EQ(passes.Stats()[1].name, "liveness");
+    EXPECT_EQ(passes.Stats()[1].dump, tape.Dump());
+    EXPECT_TRUE(tape.ReusesSlots());
+    EXPECT_LT(passes.Stats()[1].slots_after, tape.NumValues());
+    slots = { 0.4, 1.5 };
+    EXPECT_NEAR(tape.Primal(slots), expected, 1e-12);
+}
+
+TEST(pass_manager_custom_pass, double){
+    Tape<double> tape;
+    ASSERT_EQ(tape.Compile("((x+0)+0)").code, ReturnCode::success);
+    PassManager<double> passes;
+    int calls = 0;
+    passes.AddPass("count", [&calls](Tape<double>&) { ++calls; });
+    passes.AddPass("fold");
+    passes.Run(tape);
+    EXPECT_EQ(calls, 1);
+    EXPECT_EQ(passes.Stats()[1].ops_after, 0);
+}
+
+TEST(pass_manager_autodiffer, double){
+    AutoDiffer<double> ad;
+    ad.SetSeed("x", 0.4);
+    ad.SetSeed("y", 1.5);
+    double optimized = ad.Evaluate(PASS_MANAGER_EQ).second;
+    ad.SetPassManager(PassManager<double>());
+    EXPECT_NEAR(ad.Evaluate(PASS_MANAGER_EQ).second, optimized, 1e-12);
+}
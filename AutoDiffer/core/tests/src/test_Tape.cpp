@@ -0,0 +1,199 @@
+/* system header files */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include <math.h>
+#include <chrono>
+/* googletest header files */
+#include "gtest/gtest.h"
+
+/* header files */
+#include "ADValue.hpp"
+#include "ADNode.hpp"
+#include "AutoDiffer.hpp"
+#include "Parser.hpp"
+#include "Tape.hpp"
+#include "test_vars.h"
+
+/*
+ *
+ *
+ * Tape TESTS
+ *
+ *
+*/
+
+// Equations covering every operation, in the parser syntax.
+const std::vector<std::string> TAPE_TEST_EQS = {
+    "((x+5)^3)",
+    "((((x+5)^3)+((x+2)^4))^2)",
+    "(-x)",
+    "((sin((2*x)/3))/(x^2))",
+    "(2^((sin((2*x)/3))/(x^2)))",
+    "(x^x)",
+    "((arcsin(x))+((arccos(x))*(arctan(x))))",
+    "(((sinh(x))-(cosh(x)))/(tanh(x)))",
+    "((logistic(x^2))+(log_2.33_(x^2)))",
+    "((sqrt(x))*((tan(exp(sin(cos(x)))))+x))",
+    "(x)",
+    "(5)",
+};
+
+// Evaluates an equation with the parser at x = value, seed 1.
+ADValue<double> ParserResult(const std::string& equation, double value) {
+    Parser<double> parser(equation);
+    std::vector<std::pair<std::string, ADValue<double>>> seeds = {
+        std::pair<std::string, ADValue<double>>("x", ADValue<double>(value, 1))
+    };
+    parser.Init(seeds);
+    return parser.Run().second;
+}
+
+TEST(tape_test_compile_basic, double){
+    Tape<double> tape;
+    ASSERT_EQ(tape.Compile("((x+5)^3)").code, ReturnCode::success);
+    ASSERT_EQ(tape.Variables().size(), 1);
+    EXPECT_EQ(tape.Variables()[0], "x");
+    EXPECT_EQ(tape.Constants().size(), 2);
+    EXPECT_EQ(tape.Instructions().size(), 2);
+    EXPECT_EQ(tape.NumSlots(), 5);
+    EXPECT_EQ(tape.Output(), 4);
+}
+
+TEST(tape_test_compile_dedup, double){
+    // Each variable and constant gets a single slot.
+    Tape<double> tape;
+    ASSERT_EQ(tape.Compile("(((x*y)+(y*2))+(x*2))").code, ReturnCode::success);
+    EXPECT_EQ(tape.Variables().size(), 2);
+    EXPECT_EQ(tape.Constants().size(), 1);
+    EXPECT_EQ(tape.Instructions().size(), 5);
+}
+
+TEST(tape_test_forward_matches_parser, double){
+    for (const std::string& eq : TAPE_TEST_EQS) {
+        Tape<double> tape;
+        ASSERT_EQ(tape.Compile(eq).code, ReturnCode::success) << eq;
+        std::vector<ADValue<double>> slots;
+        if (!tape.Variables().empty()) {
+            slots.push_back(ADValue<double>(0.3, 1));
+        }
+        ADValue<double> result = tape.Forward(
+            slots, [](double c) { return ADValue<double>(c, 0); });
+        ADValue<double> expected = ParserResult(eq, 0.3);
+        EXPECT_NEAR(result.val(), expected.val(), 1e-12) << eq;
+        EXPECT_NEAR(result.dval(0), expected.dval(0), 1e-9) << eq;
+    }
+}
+
+TEST(tape_test_primal_and_adjoint_match_parser, double){
+    for (const std::string& eq : TAPE_TEST_EQS) {
+        Tape<double> tape;
+        ASSERT_EQ(tape.Compile(eq).code, ReturnCode::success) << eq;
+        std::vector<double> slots;
+        if (!tape.Variables().empty()) {
+            slots.push_back(0.3);
+        }
+        double value = tape.Primal(slots);
+        std::vector<double> adjoints;
+        tape.Adjoint(slots, 1, adjoints);
+        ADValue<double> expected = ParserResult(eq, 0.3);
+        EXPECT_NEAR(value, expected.val(), 1e-12) << eq;
+        if (!tape.Variables().empty()) {
+            EXPECT_NEAR(adjoints[0], expected.dval(0), 1e-9) << eq;
+        }
+    }
+}
+
+TEST(tape_test_adjoint_gradient, double){
+    // f(x,y) = x*y + sin(x), grad = (y + cos(x), x).
+    Tape<double> tape;
+    ASSERT_EQ(tape.Compile("((x*y)+(sin(x)))").code, ReturnCode::success);
+    std::vector<double> slots = { 1.0, 2.0 };
+    EXPECT_NEAR(tape.Primal(slots), 2 + sin(1.0), 1e-12);
+    std::vector<double> adjoints;
+    tape.Adjoint(slots, 1.0, adjoints);
+    EXPECT_NEAR(adjoints[0], 2 + cos(1.0), 1e-12);
+    EXPECT_NEAR(adjoints[1], 1.0, 1e-12);
+}
+
+TEST(tape_test_adjoint_negative_base, double){
+    Tape<double> tape;
+    ASSERT_EQ(tape.Compile("((x-3)^x)").code, ReturnCode::success);
+    std::vector<double> slots = { 1.0 };
+    tape.Primal(slots);
+    std::vector<double> adjoints;
+    EXPECT_THROW(tape.Adjoint(slots, 1.0, adjoints), std::logic_error);
+}
+
+TEST(tape_test_resolve_variables, double){
+    Tape<double> tape;
+    ASSERT_EQ(tape.Compile("((y*x)+y)").code, ReturnCode::success);
+    std::vector<int> index;
+    std::vector<std::string> names = { "x", "y" };
+    ASSERT_EQ(tape.ResolveVariables(names, index).code, ReturnCode::success);
+    EXPECT_EQ(index[0], 1);
+    EXPECT_EQ(index[1], 0);
+    names = { "x" };
+    Status status = tape.ResolveVariables(names, index);
+    EXPECT_EQ(status.code, ReturnCode::parse_error);
+    EXPECT_EQ(status.message, "Key not found: y");
+}
+
+TEST(tape_test_compile_errors, double){
+    Tape<double> tape;
+    EXPECT_EQ(tape.Compile("((x^1.4)+3.7").message,
+              "Unbalanced parentheses -- too many \'(\'");
+    EXPECT_EQ(tape.Compile("((x^1.4)+3.7))").message,
+              "Unbalanced parentheses -- too many \')\'");
+    EXPECT_EQ(tape.Compile("x").message, "No parentheses found.");
+    EXPECT_EQ(tape.Compile("((x-)+3.7)").message,
+              "Binary operation requires LHS and RHS");
+    EXPECT_EQ(tape.Compile("((+x)+3.7)").code, ReturnCode::parse_error);
+    EXPECT_EQ(tape.Compile("(ln(x+3.7))").code, ReturnCode::parse_error);
+    EXPECT_EQ(tape.Compile("(log(x+3.7))").message, "Invalid argument to log");
+    EXPECT_EQ(tape.Compile("(function(x+3.7))").code, ReturnCode::parse_error);
+    EXPECT_EQ(tape.Compile("(sin2)").message, "Invalid argument to sin");
+    EXPECT_EQ(tape.Compile("(x)+(y)").code, ReturnCode::parse_error);
+    EXPECT_EQ(tape.Compile("(#0)").code, ReturnCode::parse_error);
+}
+
+TEST(tape_test_reuse_slots_chain, double){
+    // A chain of 100 unary ops needs a single slot for its results.
+    std::string eq = "(x)";
+    for (int i = 0; i < 100; ++i) {
+        eq = "(sin" + eq + ")";
+    }
+    Tape<double> tape;
+    ASSERT_EQ(tape.Compile(eq).code, ReturnCode::success);
+    std::vector<double> slots = { 0.7 };
+    double expected = tape.Primal(slots);
+    EXPECT_EQ(tape.NumSlots(), tape.NumValues());
+    tape.ReuseSlots();
+    EXPECT_TRUE(tape.ReusesSlots());
+    EXPECT_EQ(tape.NumValues(), 103);
+    EXPECT_EQ(tape.NumSlots(), 3);
+    slots = { 0.7 };
+    EXPECT_EQ(tape.Primal(slots), expected);
+    std::vector<double> adjoints;
+    EXPECT_THROW(tape.Adjoint(slots, 1.0, adjoints), std::logic_error);
+}
+
+TEST(tape_test_reuse_slots_matches, double){
+    for (const std::string& eq : TAPE_TEST_EQS) {
+        Tape<double> tape;
+        ASSERT_EQ(tape.Compile(eq).code, ReturnCode::success) << eq;
+        tape.ReuseSlots();
+        EXPECT_LE(tape.NumSlots(), tape.NumValues()) << eq;
+        std::vector<ADValue<double>> slots;
+        if (!tape.Variables().empty()) {
+            slots.push_back(ADValue<double>(0.3, 1));
+        }
+        ADValue<double> result = tape.Forward(
+            slots, [](double c) { return ADValue<double>(c, 0); });
+        ADValue<double> expected = ParserResult(eq, 0.3);
+        EXPECT_NEAR(result.val(), expected.val(), 1e-12) << eq;
+        EXPECT_NEAR(result.dval(0), expected.dval(0), 1e-9) << eq;
+    }
+}
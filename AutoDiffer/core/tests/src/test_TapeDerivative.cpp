@@ -0,0 +1,206 @@
+/* system header files */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include <math.h>
+/* googletest header files */
+#include "gtest/gtest.h"
+
+/* header files */
+#include "ADValue.hpp"
+#include "AutoDiffer.hpp"
+#include "InfixParser.hpp"
+#include "PassManager.hpp"
+#include "Tape.hpp"
+#include "TapeDerivative.hpp"
+#include "TapePasses.hpp"
+#include "test_vars.h"
+
+/*
+ *
+ *
+ * TapeDerivative TESTS
+ *
+ *
+ */
+
+// Every operation, in infix syntax.
+const std::vector<std::string> DERIVATIVE_TEST_EQS = {
+    "x*y + x/y - y^x",
+    "x^3 + 1/x + x*x",
+    "sin(x)*cos(y) + tan(x*y)",
+    "arcsin(x/4) + arccos(y/4) + arctan(x*y)",
+    "sinh(x) - cosh(y) + tanh(x*y)",
+    "logistic(x*y) + log_2.5_(x + y) + log_3_(logistic(x))",
+    "sqrt(x*y) + exp(x - y) + exp(-x*y)",
+    "x*y*(x + 3) + sin(sin(sin(x)))",
+    "x + 2",
+    "7",
+};
+
+// Partials of a tape by forward mode, in the order of its variables.
+static std::vector<double> ForwardPartials(const Tape<double>& tape,
+                                           const std::vector<double>& point) {
+    int n = tape.Variables().size();
+    std::vector<ADValue<double>> slots;
+    for (int i = 0; i < n; ++i) {
+        std::vector<double> seed(n, 0);
+        seed[i] = 1;
+        slots.push_back(ADValue<double>(point[i], seed));
+    }
+    ADValue<double> result = tape.Forward(slots, [n](double c) {
+        return ADValue<double>(c, std::vector<double>(n, 0));
+    });
+    std::vector<double> partials;
+    for (int i = 0; i < n; ++i) {
+        partials.push_back(result.dval(i));
+    }
+    return partials;
+}
+
+TEST(derivative_matches_forward, double){
+    std::vector<double> point = { 0.7, 1.3 };
+    for (const std::string& equation : DERIVATIVE_TEST_EQS) {
+        Tape<double> tape;
+        ASSERT_EQ(InfixParser<double>(equation).Compile(tape).code,
+                  ReturnCode::success);
+        // Once as parsed and once with the fused ops.
+        for (int fused = 0; fused < 2; ++fused) {
+            if (fused) {
+                PassManager<double>::Default().Run(tape);
+            }
+            std::vector<double> expected = ForwardPartials(tape, point);
+            std::vector<Tape<double>> partials;
+            GradientTapes(tape, partials);
+            ASSERT_EQ(partials.size(), tape.Variables().size());
+            for (int i = 0; i < partials.size(); ++i) {
+                EXPECT_EQ(partials[i].Variables(), tape.Variables());
+                std::vector<double> slots(
+                    point.begin(), point.begin() + tape.Variables().size());
+                EXPECT_NEAR(partials[i].Primal(slots), expected[i], 1e-9)
+                    << equation << " d/d" << tape.Variables()[i];
+            }
+        }
+    }
+}
+
+TEST(derivative_simplified, double){
+    Tape<double> tape;
+    ASSERT_EQ(tape.Compile("((x^2)*(sin(y)))").code, ReturnCode::success);
+    Tape<double> dx;
+    DifferentiateTape(tape, 0, dx);
+    // 2*x^1 is folded to 2*x, and the primal product is dead.
+    EXPECT_EQ(dx.Instructions().size(), 3);
+    std::vector<double> slots = { 1.5, 2.0 };
+    EXPECT_NEAR(dx.Primal(slots), 3 * sin(2.0), 1e-12);
+}
+
+TEST(derivative_second_order, double){
+    Tape<double> tape;
+    ASSERT_EQ(InfixParser<double>("x^3 * sin(x)").Compile(tape).code,
+              ReturnCode::success);
+    Tape<double> dx;
+    Tape<double> dxx;
+    DifferentiateTape(tape, 0, dx);
+    DifferentiateTape(dx, 0, dxx);
+    double x = 0.8;
+    std::vector<double> slots = { x };
+    double expected = 6 * x * sin(x) + 6 * x * x * cos(x) -
+                      x * x * x * sin(x);
+    EXPECT_NEAR(dxx.Primal(slots), expected, 1e-12);
+}
+
+TEST(derivative_to_infix, double){
+    std::vector<double> point = { 0.7, 1.3 };
+    for (const std::string& equation : DERIVATIVE_TEST_EQS) {
+        Tape<double> tape;
+        ASSERT_EQ(InfixParser<double>(equation).Compile(tape).code,
+                  ReturnCode::success);
+        PassManager<double>::Default().Run(tape);
+        std::vector<Tape<double>> partials;
+        GradientTapes(tape, partials);
+        partials.push_back(tape);
+        for (const Tape<double>& partial : partials) {
+            std::string text = partial.ToInfix();
+            Tape<double> parsed;
+            ASSERT_EQ(InfixParser<double>(text).Compile(parsed).code,
+                      ReturnCode::success) << text;
+            std::vector<std::string> names = { "x", "y" };
+            std::vector<int> index;
+            ASSERT_EQ(parsed.ResolveVariables(names, index).code,
+                      ReturnCode::success);
+            std::vector<double> slots(
+                point.begin(), point.begin() + partial.Variables().size());
+            std::vector<double> parsed_slots;
+            for (int j : index) {
+                parsed_slots.push_back(point[j]);
+            }
+            EXPECT_NEAR(parsed.Primal(parsed_slots), partial.Primal(slots),
+                        1e-12) << text;
+        }
+    }
+    Tape<double> tape;
+    ASSERT_EQ(InfixParser<double>("x - 2.5").Compile(tape).code,
+              ReturnCode::success);
+    EXPECT_EQ(tape.ToInfix(), "(x-2.5)");
+}
+
+TEST(derive_symbolic, double){
+    std::vector<std::pair<std::string, double>> point = {
+        { "z", 0.5 }, { "x", 0.7 }, { "y", 1.3 },
+    };
+    AutoDiffer<double> ad;
+    ad.SetSyntax(Syntax::infix);
+    std::vector<std::string> equations = DERIVATIVE_TEST_EQS;
+    equations.push_back("x + w");
+    std::vector<std::pair<Status,ADValue<double>>> expected =
+        ad.DeriveChunked(equations, point);
+    // Twice, the second time from the cache.
+    for (int pass = 0; pass < 2; ++pass) {
+        std::vector<std::pair<Status,ADValue<double>>> actual =
+            ad.DeriveSymbolic(equations, point);
+        ASSERT_EQ(actual.size(), equations.size());
+        for (int i = 0; i < DERIVATIVE_TEST_EQS.size(); ++i) {
+            ASSERT_EQ(actual[i].first.code, ReturnCode::success);
+            EXPECT_NEAR(actual[i].second.val(), expected[i].second.val(),
+                        1e-12);
+            for (int k = 0; k < point.size(); ++k) {
+                EXPECT_NEAR(actual[i].second.dval(k),
+                            expected[i].second.dval(k), 1e-9)
+                    << equations[i] << " d/d" << point[k].first;
+            }
+        }
+        EXPECT_EQ(actual.back().first.code, ReturnCode::parse_error);
+        EXPECT_EQ(actual.back().first.message, "Key not found: w");
+    }
+}
+
+TEST(derive_symbolic_zero_base, double){
+    // Like ADValue::power, every partial of a power is 0 for a zero base.
+    std::vector<std::pair<std::string, double>> point = {
+        { "x", 0 }, { "y", 2.5 },
+    };
+    AutoDiffer<double> ad;
+    ad.SetSyntax(Syntax::infix);
+    std::vector<std::string> equations = { "x^y", "x^y + x*y", "(x^y)^2" };
+    std::vector<std::pair<Status,ADValue<double>>> expected =
+        ad.DeriveChunked(equations, point);
+    std::vector<std::pair<Status,ADValue<double>>> actual =
+        ad.DeriveSymbolic(equations, point);
+    ASSERT_EQ(actual.size(), equations.size());
+    for (int i = 0; i < equations.size(); ++i) {
+        ASSERT_EQ(actual[i].first.code, ReturnCode::success);
+        EXPECT_EQ(actual[i].second.val(), expected[i].second.val());
+        for (int k = 0; k < point.size(); ++k) {
+            EXPECT_FALSE(isnan(actual[i].second.dval(k)))
+                << equations[i] << " d/d" << point[k].first;
+            EXPECT_EQ(actual[i].second.dval(k), expected[i].second.dval(k))
+                << equations[i] << " d/d" << point[k].first;
+        }
+    }
+    EXPECT_EQ(actual[0].second.dval(0), 0);
+    EXPECT_EQ(actual[0].second.dval(1), 0);
+    EXPECT_EQ(actual[1].second.dval(0), 2.5);
+}
@@ -0,0 +1,273 @@
+/* system header files */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include <math.h>
+#include <cstdio>
+#include <fstream>
+/* googletest header files */
+#include "gtest/gtest.h"
+
+/* header files */
+#include "ADValue.hpp"
+#include "AutoDiffer.hpp"
+#include "PassManager.hpp"
+#include "Tape.hpp"
+#include "TapeFile.hpp"
+#include "test_vars.h"
+
+/*
+ *
+ *
+ * TapeFile TESTS
+ *
+ *
+ */
+
+const std::vector<std::string> TAPE_FILE_TEST_EQS = {
+    "((x^2)+(sin(y)))",
+    "((3*x)*(exp((y/x))))",
+    "((log_2.33_(x))-(cosh(y)))",
+    "(5)",
+};
+
+// Writes raw bytes to a file, for corrupt files.
+static void WriteBytes(const std::string& path, const std::string& bytes) {
+    std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+    file.write(bytes.data(), bytes.size());
+}
+
+// Reads a whole file.
+static std::string ReadBytes(const std::string& path) {
+    std::ifstream file(path.c_str(), std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file),
+                       std::istreambuf_iterator<char>());
+}
+
+TEST(tape_file_round_trip, double){
+    std::string path = "test_tape_file.bin";
+    std::vector<Tape<double>> tapes(TAPE_FILE_TEST_EQS.size());
+    std::vector<std::pair<std::string, const Tape<double>*>> entries;
+    for (int i = 0; i < TAPE_FILE_TEST_EQS.size(); ++i) {
+        ASSERT_EQ(tapes[i].Compile(TAPE_FILE_TEST_EQS[i]).code,
+                  ReturnCode::success);
+        PassManager<double>::Default().Run(tapes[i]);
+        entries.emplace_back(TAPE_FILE_TEST_EQS[i], &tapes[i]);
+    }
+    ASSERT_EQ(SaveTapes(path, entries).code, ReturnCode::success);
+
+    TapeFile<double> file;
+    ASSERT_EQ(file.Open(path).code, ReturnCode::success);
+    ASSERT_EQ(file.NumTapes(), TAPE_FILE_TEST_EQS.size());
+    std::vector<std::string> names = { "y", "x" };
+    for (int i = 0; i < TAPE_FILE_TEST_EQS.size(); ++i) {
+        const Tape<double>& tape = tapes[i];
+        const MappedTape<double>* mapped = file.Find(TAPE_FILE_TEST_EQS[i]);
+        ASSERT_NE(mapped, nullptr);
+        EXPECT_EQ(mapped->Key(), TAPE_FILE_TEST_EQS[i]);
+        ASSERT_EQ(mapped->NumVariables(), tape.Variables().size());
+        for (int j = 0; j < tape.Variables().size(); ++j) {
+            EXPECT_EQ(mapped->Variable(j), tape.Variables()[j]);
+        }
+        std::vector<int> index;
+        std::vector<int> mapped_index;
+        ASSERT_EQ(tape.ResolveVariables(names, index).code,
+                  ReturnCode::success);
+        ASSERT_EQ(mapped->ResolveVariables(names, mapped_index).code,
+                  ReturnCode::success);
+        EXPECT_EQ(index, mapped_index);
+
+        // The mapped tape evaluates to exactly the same values.
+        std::vector<double> slots(tape.Variables().size(), 1.25);
+        std::vector<double> mapped_slots = slots;
+        EXPECT_EQ(mapped->View().Primal(mapped_slots), tape.Primal(slots));
+        std::vector<double> adjoints;
+        std::vector<double> mapped_adjoints;
+        tape.Adjoint(slots, 1, adjoints);
+        mapped->View().Adjoint(mapped_slots, 1, mapped_adjoints);
+        EXPECT_EQ(mapped_adjoints, adjoints);
+
+        std::vector<ADValue<double>> values(tape.Variables().size(),
+                                            ADValue<double>(1.25, 1.0));
+        auto constant = [](double c) { return ADValue<double>(c, 0.0); };
+        ADValue<double> expected = tape.Forward(values, constant);
+        ADValue<double> actual = mapped->View().Forward(values, constant);
+        EXPECT_EQ(actual.val(), expected.val());
+        EXPECT_EQ(actual.dval(0), expected.dval(0));
+
+        Tape<double> copy;
+        mapped->CopyTo(copy);
+        EXPECT_EQ(copy.Dump(), tape.Dump());
+    }
+    EXPECT_EQ(file.Find("((x^3)+(sin(y)))"), nullptr);
+    EXPECT_EQ(file.Find(""), nullptr);
+    remove(path.c_str());
+}
+
+TEST(tape_file_reused_slots, double){
+    std::string path = "test_tape_file_reused.bin";
+    Tape<double> tape;
+    ASSERT_EQ(tape.Compile("(((x*y)+(sin(x)))*((x-y)/(cos(y))))").code,
+              ReturnCode::success);
+    tape.ReuseSlots();
+    std::vector<std::pair<std::string, const Tape<double>*>> entries = {
+        { "f", &tape },
+    };
+    ASSERT_EQ(SaveTapes(path, entries).code, ReturnCode::success);
+
+    TapeFile<double> file;
+    ASSERT_EQ(file.Open(path).code, ReturnCode::success);
+    const MappedTape<double>* mapped = file.Find("f");
+    ASSERT_NE(mapped, nullptr);
+    EXPECT_TRUE(mapped->View().ReusesSlots());
+    EXPECT_EQ(mapped->View().NumSlots(), tape.NumSlots());
+    std::vector<double> slots = { 0.5, 1.5 };
+    std::vector<double> mapped_slots = slots;
+    EXPECT_EQ(mapped->View().Primal(mapped_slots), tape.Primal(slots));
+    std::vector<double> adjoints;
+    EXPECT_THROW(mapped->View().Adjoint(mapped_slots, 1, adjoints),
+                 std::logic_error);
+    remove(path.c_str());
+}
+
+TEST(tape_file_invalid, double){
+    std::string path = "test_tape_file_invalid.bin";
+    Tape<double> tape;
+    ASSERT_EQ(tape.Compile("((x^2)+(sin(y)))").code, ReturnCode::success);
+    std::vector<std::pair<std::string, const Tape<double>*>> entries = {
+        { "f", &tape },
+    };
+    ASSERT_EQ(SaveTapes(path, entries).code, ReturnCode::success);
+    std::string bytes = ReadBytes(path);
+
+    // Saved with double, read as float.
+    TapeFile<float> float_file;
+    Status status = float_file.Open(path);
+    EXPECT_EQ(status.code, ReturnCode::invalid_argument);
+    EXPECT_EQ(status.message,
+              "Invalid tape file: saved with values of 8 bytes");
+
+    TapeFile<double> file;
+    std::string corrupt = bytes;
+    corrupt[0] = 'X';
+    WriteBytes(path, corrupt);
+    status = file.Open(path);
+    EXPECT_EQ(status.message, "Invalid tape file: bad magic");
+    EXPECT_EQ(file.NumTapes(), 0);
+
+    corrupt = bytes;
+    corrupt[8] = 2;
+    WriteBytes(path, corrupt);
+    EXPECT_EQ(file.Open(path).message,
+              "Invalid tape file: unsupported version 2");
+
+    // Every truncation is caught before anything is read out of bounds.
+    for (int size = 0; size < bytes.size(); ++size) {
+        WriteBytes(path, bytes.substr(0, size));
+        EXPECT_EQ(file.Open(path).code, ReturnCode::invalid_argument);
+    }
+
+    // An operand past the last slot.
+    TapeFileEntry entry;
+    memcpy(&entry, &bytes[sizeof(TapeFileHeader)], sizeof(entry));
+    corrupt = bytes;
+    int bad_slot = 1000;
+    memcpy(&corrupt[entry.instructions_offset + 2 * sizeof(int)], &bad_slot,
+           sizeof(bad_slot));
+    WriteBytes(path, corrupt);
+    EXPECT_EQ(file.Open(path).message, "Invalid tape file: bad instruction");
+
+    WriteBytes(path, bytes);
+    EXPECT_EQ(file.Open(path).code, ReturnCode::success);
+    EXPECT_EQ(file.NumTapes(), 1);
+    remove(path.c_str());
+
+    EXPECT_EQ(file.Open("no_such_file.bin").code,
+              ReturnCode::invalid_argument);
+    entries.push_back(entries[0]);
+    EXPECT_EQ(SaveTapes(path, entries).message, "Repeated key: f");
+}
+
+TEST(tape_file_auto_differ, double){
+    std::string path = "test_tape_file_auto_differ.bin";
+    std::vector<std::pair<std::string, double>> point = {
+        { "x", 0.5 }, { "y", 2.0 },
+    };
+    AutoDiffer<double> compiled;
+    std::pair<Status,std::vector<double>> expected =
+        compiled.VJP(TAPE_FILE_TEST_EQS, point, { 1, 2, 3, 4 });
+    ASSERT_EQ(expected.first.code, ReturnCode::success);
+    ASSERT_EQ(compiled.SaveTapes(path).code, ReturnCode::success);
+
+    AutoDiffer<double> loaded;
+    ASSERT_EQ(loaded.LoadTapes(path).code, ReturnCode::success);
+    std::pair<Status,std::vector<double>> actual =
+        loaded.VJP(TAPE_FILE_TEST_EQS, point, { 1, 2, 3, 4 });
+    ASSERT_EQ(actual.first.code, ReturnCode::success);
+    EXPECT_EQ(actual.second, expected.second);
+
+    // Loaded tapes are used as they are, without parsing the key.
+    Tape<double> tape;
+    ASSERT_EQ(tape.Compile("((x^2)+(sin(y)))").code, ReturnCode::success);
+    std::vector<std::pair<std::string, const Tape<double>*>> entries = {
+        { "f", &tape },
+    };
+    ASSERT_EQ(SaveTapes(path, entries).code, ReturnCode::success);
+    ASSERT_EQ(loaded.LoadTapes(path).code, ReturnCode::success);
+    loaded.SetSeed("x", 0.5);
+    loaded.SetSeed("y", 2.0);
+    std::pair<Status,double> value = loaded.Evaluate("f");
+    ASSERT_EQ(value.first.code, ReturnCode::success);
+    EXPECT_NEAR(value.second, 0.25 + sin(2.0), 1e-12);
+    remove(path.c_str());
+
+    EXPECT_EQ(loaded.LoadTapes(path).code, ReturnCode::invalid_argument);
+}
+
+TEST(tape_file_forward_tapes, double){
+    std::string path = "test_tape_file_forward.bin";
+    AutoDiffer<double> compiled;
+    compiled.SetSeedVector("x", 0.5, { 1, 0 });
+    compiled.SetSeedVector("y", 2.0, { 0, 1 });
+    std::vector<std::pair<Status, ADValue<double>>> expected =
+        compiled.DeriveCompiled(TAPE_FILE_TEST_EQS);
+    ASSERT_EQ(compiled.SaveTapes(path).code, ReturnCode::success);
+    // Both caches are saved, the forward tapes under a prefixed key.
+    {
+        TapeFile<double> file;
+        ASSERT_EQ(file.Open(path).code, ReturnCode::success);
+        EXPECT_EQ(file.NumTapes(), 2 * TAPE_FILE_TEST_EQS.size());
+        const MappedTape<double>* forward =
+            file.Find(kForwardTapeKeyPrefix + TAPE_FILE_TEST_EQS[0]);
+        ASSERT_NE(forward, nullptr);
+        EXPECT_TRUE(forward->View().ReusesSlots());
+    }
+
+    AutoDiffer<double> loaded;
+    loaded.SetSeedVector("x", 0.5, { 1, 0 });
+    loaded.SetSeedVector("y", 2.0, { 0, 1 });
+    ASSERT_EQ(loaded.LoadTapes(path).code, ReturnCode::success);
+    std::vector<std::pair<Status, ADValue<double>>> actual =
+        loaded.DeriveCompiled(TAPE_FILE_TEST_EQS);
+    for (int i = 0; i < actual.size(); ++i) {
+        ASSERT_EQ(actual[i].first.code, ReturnCode::success);
+        EXPECT_EQ(actual[i].second.val(), expected[i].second.val());
+        EXPECT_EQ(actual[i].second.dvals(), expected[i].second.dvals());
+    }
+
+    // A forward tape is loaded under its equation, without the prefix.
+    Tape<double> tape;
+    ASSERT_EQ(tape.Compile("((x^2)+(sin(y)))").code, ReturnCode::success);
+    tape.ReuseSlots();
+    std::vector<std::pair<std::string, const Tape<double>*>> entries = {
+        { std::string(kForwardTapeKeyPrefix) + "f", &tape },
+    };
+    ASSERT_EQ(SaveTapes(path, entries).code, ReturnCode::success);
+    ASSERT_EQ(loaded.LoadTapes(path).code, ReturnCode::success);
+    actual = loaded.DeriveCompiled({ "f" });
+    ASSERT_EQ(actual[0].first.code, ReturnCode::success);
+    EXPECT_NEAR(actual[0].second.dval(1), cos(2.0), 1e-12);
+    remove(path.c_str());
+}
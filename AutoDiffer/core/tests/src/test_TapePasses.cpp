@@ -0,0 +1,376 @@
+/* system header files */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include <math.h>
+#include <chrono>
+/* googletest header files */
+#include "gtest/gtest.h"
+
+/* header files */
+#include "ADValue.hpp"
+#include "ADNode.hpp"
+#include "AutoDiffer.hpp"
+#include "FixedADValue.hpp"
+#include "InfixParser.hpp"
+#include "Parser.hpp"
+#include "PassManager.hpp"
+#include "Tape.hpp"
+#include "TapeFile.hpp"
+#include "TapePasses.hpp"
+#include "TaylorValue.hpp"
+#include "test_vars.h"
+
+/*
+ *
+ *
+ * TapePasses TESTS
+ *
+ *
+*/
+
+// Value and derivative of a single variable tape at x = value, seed 1.
+ADValue<double> ForwardAt(const Tape<double>& tape, double value) {
+    std::vector<ADValue<double>> slots;
+    if (!tape.Variables().empty()) {
+        slots.push_back(ADValue<double>(value, 1));
+    }
+    return tape.Forward(slots, [](double c) { return ADValue<double>(c, 0); });
+}
+
+const std::vector<std::string> PASSES_TEST_EQS = {
+    "((x*1)+((2^3)*x))",
+    "((((x+0)^2)+((0+x)^3))-((x-0)/1))",
+    "((x^5)*(x^1))",
+    "((sin(x))+(log_2_(8)))",
+    "(((3*4)+x)^(1+1))",
+    "((x^2.5)+(x^(-2)))",
+    "((x^2)*(1/0))",
+    "(5)",
+    "((2*3)+1)",
+};
+
+TEST(tape_passes_preserve_results, double){
+    for (const std::string& eq : PASSES_TEST_EQS) {
+        Tape<double> tape;
+        ASSERT_EQ(tape.Compile(eq).code, ReturnCode::success) << eq;
+        Tape<double> optimized = tape;
+        OptimizeStats stats = OptimizeTape(optimized);
+        EXPECT_EQ(stats.ops_before, tape.Instructions().size()) << eq;
+        EXPECT_EQ(stats.ops_after, optimized.Instructions().size()) << eq;
+        for (double x : { -1.5, 0.7, 2.0 }) {
+            ADValue<double> expected = ForwardAt(tape, x);
+            ADValue<double> result = ForwardAt(optimized, x);
+            if (isnan(expected.val())) {
+                EXPECT_TRUE(isnan(result.val())) << eq;
+                continue;
+            }
+            EXPECT_NEAR(result.val(), expected.val(), 1e-9) << eq;
+            EXPECT_NEAR(result.dval(0), expected.dval(0), 1e-9) << eq;
+        }
+    }
+}
+
+TEST(tape_passes_fold_constants, double){
+    Tape<double> tape;
+    ASSERT_EQ(tape.Compile("(((2^3)*x)+((1+1)*(4-4)))").code,
+              ReturnCode::success);
+    FoldConstants(tape);
+    // Only (8*x) + 0 is left, and the addition of 0 is forwarded.
+    ASSERT_EQ(tape.Instructions().size(), 1);
+    EXPECT_EQ(tape.Instructions()[0].op, Operation::multiplication);
+    ASSERT_EQ(tape.Constants().size(), 1);
+    EXPECT_EQ(tape.Constants()[0], 8);
+
+    ASSERT_EQ(tape.Compile("((2*3)+1)").code, ReturnCode::success);
+    FoldConstants(tape);
+    EXPECT_TRUE(tape.Instructions().empty());
+    std::vector<double> slots;
+    EXPECT_EQ(tape.Primal(slots), 7);
+
+    // Division by zero is not folded.
+    ASSERT_EQ(tape.Compile("(1/0)").code, ReturnCode::success);
+    FoldConstants(tape);
+    EXPECT_EQ(tape.Instructions().size(), 1);
+}
+
+TEST(tape_passes_identities, double){
+    Tape<double> tape;
+    ASSERT_EQ(tape.Compile("(((((x*1)+0)-0)/1)^1)").code, ReturnCode::success);
+    OptimizeStats stats = OptimizeTape(tape);
+    EXPECT_EQ(stats.ops_after, 0);
+    EXPECT_EQ(tape.Output(), 0);
+    EXPECT_EQ(ForwardAt(tape, 3.0).dval(0), 1);
+}
+
+TEST(tape_passes_strength_reduce, double){
+    Tape<double> tape;
+    ASSERT_EQ(tape.Compile("(x^2)").code, ReturnCode::success);
+    OptimizeTape(tape);
+    ASSERT_EQ(tape.Instructions().size(), 1);
+    EXPECT_EQ(tape.Instructions()[0].op, Operation::multiplication);
+    EXPECT_EQ(tape.Instructions()[0].lhs, 0);
+    EXPECT_EQ(tape.Instructions()[0].rhs, 0);
+    // The exponent constant is no longer needed.
+    EXPECT_TRUE(tape.Constants().empty());
+
+    // x^13 = x^8 * x^4 * x, three squarings and two products.
+    ASSERT_EQ(tape.Compile("(x^13)").code, ReturnCode::success);
+    OptimizeTape(tape);
+    EXPECT_EQ(tape.Instructions().size(), 5);
+    ADValue<double> result = ForwardAt(tape, 1.1);
+    EXPECT_NEAR(result.val(), pow(1.1, 13), 1e-12);
+    EXPECT_NEAR(result.dval(0), 13 * pow(1.1, 12), 1e-12);
+
+    // Non integer and large exponents are kept.
+    ASSERT_EQ(tape.Compile("((x^2.5)+(x^17))").code, ReturnCode::success);
+    StrengthReduce(tape);
+    EXPECT_EQ(tape.Instructions()[0].op, Operation::power);
+    EXPECT_EQ(tape.Instructions()[1].op, Operation::power);
+}
+
+TEST(tape_passes_dead_code, double){
+    Tape<double> tape;
+    ASSERT_EQ(tape.Compile("((x*0)+(y^1))").code, ReturnCode::success);
+    // y^1 is forwarded to y, leaving the power without readers.
+    FoldConstants(tape);
+    EliminateDeadCode(tape);
+    EXPECT_EQ(tape.Instructions().size(), 2);
+    // Unused variables keep their slots.
+    EXPECT_EQ(tape.Variables().size(), 2);
+    std::vector<double> slots = { 2.0, 3.0 };
+    EXPECT_EQ(tape.Primal(slots), 3.0);
+}
+
+TEST(tape_passes_cse, double){
+    Tape<double> tape;
+    ASSERT_EQ(tape.Compile("(((sin(x))*(sin(x)))+((x*y)+(y*x)))").code,
+              ReturnCode::success);
+    std::vector<double> slots = { 0.4, 1.5 };
+    double expected = tape.Primal(slots);
+    EliminateCommonSubexpressions(tape);
+    EliminateDeadCode(tape);
+    // x+0, sin, sin*sin, x*y, sum of products and the final sum.
+    EXPECT_EQ(tape.Instructions().size(), 6);
+    slots = { 0.4, 1.5 };
+    EXPECT_EQ(tape.Primal(slots), expected);
+}
+
+TEST(tape_passes_dump, double){
+    Tape<double> tape;
+    ASSERT_EQ(tape.Compile("((x*y)+2)").code, ReturnCode::success);
+    EXPECT_EQ(tape.Dump(),
+              "s0 = variable x\n"
+              "s1 = variable y\n"
+              "s2 = constant 2\n"
+              "s3 = multiplication s0 s1\n"
+              "s4 = addition s3 s2\n"
+              "output s4\n");
+}
+
+// Ops of the instructions of a tape, in order.
+std::vector<Operation> TapeOps(const Tape<double>& tape) {
+    std::vector<Operation> ops;
+    for (const Instruction& ins : tape.Instructions()) {
+        ops.push_back(ins.op);
+    }
+    return ops;
+}
+
+TEST(tape_passes_fuse_patterns, double){
+    const std::vector<std::pair<std::string, Operation>> cases = {
+        { "((x*y)+3)", Operation::fma },
+        { "(3+(x*y))", Operation::fma },
+        { "(x*x)", Operation::square },
+        { "(1/x)", Operation::reciprocal },
+        { "(x^20)", Operation::ipow },
+        { "(x^(-3))", Operation::ipow },
+        { "(exp(-x))", Operation::expneg },
+        { "(log_10_(logistic(x)))", Operation::loglogistic },
+    };
+    for (auto& c : cases) {
+        Tape<double> tape;
+        ASSERT_EQ(tape.Compile(c.first).code, ReturnCode::success) << c.first;
+        PassManager<double>::Default().Run(tape);
+        EXPECT_EQ(TapeOps(tape), std::vector<Operation>{ c.second }) << c.first;
+    }
+
+    // A product with a second reader is not absorbed.
+    Tape<double> tape;
+    ASSERT_EQ(tape.Compile("(((x*y)+3)*(x*y))").code, ReturnCode::success);
+    EliminateCommonSubexpressions(tape);
+    FuseOperations(tape);
+    std::vector<Operation> ops = {
+        Operation::multiplication, Operation::addition,
+        Operation::multiplication };
+    EXPECT_EQ(TapeOps(tape), ops);
+}
+
+TEST(tape_passes_fuse_preserves_results, double){
+    const std::vector<std::string> eqs = {
+        "(((x*y)+(x*x))+(1/y))",
+        "((exp(-x))*(log_2_(logistic(y))))",
+        "(((x^20)+(y^(-3)))+((x*y)+(x*y)))",
+    };
+    for (const std::string& eq : eqs) {
+        Tape<double> tape;
+        ASSERT_EQ(tape.Compile(eq).code, ReturnCode::success) << eq;
+        Tape<double> fused = tape;
+        FuseOperations(fused);
+        EXPECT_LT(fused.Instructions().size(), tape.Instructions().size());
+
+        // Forward with ADValue.
+        std::vector<ADValue<double>> slots = {
+            ADValue<double>(0.9, std::vector<double>{ 1, 0 }),
+            ADValue<double>(-1.2, std::vector<double>{ 0, 1 }) };
+        std::vector<ADValue<double>> fused_slots = slots;
+        auto constant = [](double c) {
+            return ADValue<double>(c, std::vector<double>{ 0, 0 }); };
+        ADValue<double> expected = tape.Forward(slots, constant);
+        ADValue<double> result = fused.Forward(fused_slots, constant);
+        EXPECT_NEAR(result.val(), expected.val(), 1e-9) << eq;
+        EXPECT_NEAR(result.dval(0), expected.dval(0), 1e-9) << eq;
+        EXPECT_NEAR(result.dval(1), expected.dval(1), 1e-9) << eq;
+
+        // Reverse sweep.
+        std::vector<double> values = { 0.9, -1.2 };
+        fused.Primal(values);
+        std::vector<double> adjoints;
+        fused.Adjoint(values, 1.0, adjoints);
+        EXPECT_NEAR(adjoints[0], expected.dval(0), 1e-9) << eq;
+        EXPECT_NEAR(adjoints[1], expected.dval(1), 1e-9) << eq;
+
+        // Chunked and Taylor value types.
+        std::vector<FixedADValue<double, 2>> fixed = {
+            FixedADValue<double, 2>(0.9, {{ 1, 0 }}),
+            FixedADValue<double, 2>(-1.2, {{ 0, 1 }}) };
+        FixedADValue<double, 2> fixed_result = fused.Forward(
+            fixed, [](double c) { return FixedADValue<double, 2>(c); });
+        EXPECT_NEAR(fixed_result.dval(1), expected.dval(1), 1e-9) << eq;
+        std::vector<TaylorValue<double, 1>> taylor = {
+            TaylorValue<double, 1>(0.9, 1), TaylorValue<double, 1>(-1.2, 0) };
+        TaylorValue<double, 1> taylor_result = fused.Forward(
+            taylor, [](double c) { return TaylorValue<double, 1>(c); });
+        EXPECT_NEAR(taylor_result.derivative(1), expected.dval(0), 1e-9) << eq;
+    }
+}
+
+TEST(tape_passes_canonicalize, double){
+    // Duplicates in disguise: operand order, variable order, parentheses,
+    // spelling of constants and whitespace.
+    const std::vector<std::string> eqs = {
+        "(x + y) * (2 * sin(x))",
+        "(sin(x) * 2.0) * (y + x)",
+        "((((y + x))) * ((sin(x)) * 2))",
+        "(x+y)*(2*sin(x))",
+    };
+    std::vector<Tape<double>> tapes(eqs.size());
+    for (int i = 0; i < eqs.size(); ++i) {
+        ASSERT_EQ(InfixParser<double>(eqs[i]).Compile(tapes[i]).code,
+                  ReturnCode::success) << eqs[i];
+        Hash128 hash = HashTape(tapes[i]);
+        Canonicalize(tapes[i]);
+        // The hash does not depend on the layout of the tape.
+        EXPECT_EQ(HashTape(tapes[i]), hash) << eqs[i];
+        EXPECT_EQ(tapes[i].Dump(), tapes[0].Dump()) << eqs[i];
+        EXPECT_EQ(HashTape(tapes[i]), HashTape(tapes[0])) << eqs[i];
+    }
+    std::vector<std::string> variables = { "x", "y" };
+    EXPECT_EQ(tapes[0].Variables(), variables);
+
+    // Different expressions, including non-commutative operand swaps.
+    const std::vector<std::string> others = {
+        "(x - y) * (2 * sin(x))",
+        "(y - x) * (2 * sin(x))",
+        "(x + y) * (2 * sin(y))",
+        "(x + y) * (3 * sin(x))",
+        "(x + y) / (2 * sin(x))",
+        "(x + z) * (2 * sin(x))",
+    };
+    std::vector<Hash128> hashes = { HashTape(tapes[0]) };
+    for (const std::string& eq : others) {
+        Tape<double> tape;
+        ASSERT_EQ(InfixParser<double>(eq).Compile(tape).code,
+                  ReturnCode::success) << eq;
+        Hash128 hash = HashTape(tape);
+        for (const Hash128& other : hashes) {
+            EXPECT_NE(hash, other) << eq;
+        }
+        hashes.push_back(hash);
+    }
+
+    // -0 and 0 are the same constant, and merged subexpressions are shared.
+    Tape<double> zero;
+    Tape<double> negative_zero;
+    ASSERT_EQ(InfixParser<double>("x*0 + sin(x)").Compile(zero).code,
+              ReturnCode::success);
+    ASSERT_EQ(InfixParser<double>("sin(x) + x*(-0.0*1)").Compile(
+        negative_zero).code, ReturnCode::success);
+    FoldConstants(negative_zero);
+    Canonicalize(zero);
+    Canonicalize(negative_zero);
+    EXPECT_EQ(negative_zero.Dump(), zero.Dump());
+    EXPECT_EQ(negative_zero.Constants()[0], 0);
+    EXPECT_FALSE(signbit(negative_zero.Constants()[0]));
+
+    // Values and derivatives are unchanged.
+    Tape<double> tape;
+    ASSERT_EQ(tape.Compile("(((y*x)+(sin(x)))*((x+y)*(sin(x))))").code,
+              ReturnCode::success);
+    Tape<double> canonical = tape;
+    Canonicalize(canonical);
+    EXPECT_LT(canonical.Instructions().size(), tape.Instructions().size());
+    std::vector<std::string> names = { "x", "y" };
+    std::vector<double> point = { 0.4, -1.7 };
+    for (const Tape<double>* t : { &tape, &canonical }) {
+        std::vector<int> index;
+        ASSERT_EQ(t->ResolveVariables(names, index).code, ReturnCode::success);
+        std::vector<double> slots;
+        for (int j : index) {
+            slots.push_back(point[j]);
+        }
+        EXPECT_NEAR(t->Primal(slots), (-0.68 + sin(0.4)) * (-1.3 * sin(0.4)),
+                    1e-12);
+    }
+}
+
+TEST(tape_passes_canonical_cache, double){
+    std::string path = "test_canonical_cache.bin";
+    AutoDiffer<double> ad;
+    ad.SetSyntax(Syntax::infix);
+    std::vector<std::string> eqs = {
+        "x*y + sin(x)",
+        "sin(x) + y*x",
+        "(y * x) + (sin(x))",
+        "x*y - sin(x)",
+    };
+    std::vector<std::pair<std::string, double>> point = {
+        { "x", 0.3 }, { "y", 1.1 },
+    };
+    std::vector<std::pair<Status,ADValue<double>>> results =
+        ad.DeriveChunked(eqs, point);
+    std::vector<std::pair<Status,ADValue<double>>> symbolic =
+        ad.DeriveSymbolic(eqs, point);
+    for (int i = 0; i < eqs.size(); ++i) {
+        ASSERT_EQ(results[i].first.code, ReturnCode::success);
+        ASSERT_EQ(symbolic[i].first.code, ReturnCode::success);
+        double sign = i == 3 ? -1 : 1;
+        EXPECT_NEAR(results[i].second.val(), 0.33 + sign * sin(0.3), 1e-12);
+        EXPECT_NEAR(results[i].second.dval(0), 1.1 + sign * cos(0.3), 1e-12);
+        EXPECT_NEAR(symbolic[i].second.dval(0), 1.1 + sign * cos(0.3), 1e-12);
+        EXPECT_NEAR(results[i].second.dval(1), 0.3, 1e-12);
+    }
+    // The first three equations share one cached tape, and one forward tape
+    // with slot reuse for DeriveChunked.
+    ASSERT_EQ(ad.SaveTapes(path).code, ReturnCode::success);
+    TapeFile<double> file;
+    ASSERT_EQ(file.Open(path).code, ReturnCode::success);
+    EXPECT_EQ(file.NumTapes(), 4);
+    EXPECT_NE(file.Find(eqs[0]), nullptr);
+    EXPECT_EQ(file.Find(eqs[1]), nullptr);
+    EXPECT_NE(file.Find(kForwardTapeKeyPrefix + eqs[0]), nullptr);
+    EXPECT_EQ(file.Find(kForwardTapeKeyPrefix + eqs[1]), nullptr);
+    remove(path.c_str());
+}
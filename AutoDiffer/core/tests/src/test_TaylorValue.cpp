@@ -0,0 +1,126 @@
+/* system header files */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include <math.h>
+#include <chrono>
+/* googletest header files */
+#include "gtest/gtest.h"
+
+/* header files */
+#include "ADValue.hpp"
+#include "ADNode.hpp"
+#include "AutoDiffer.hpp"
+#include "TaylorValue.hpp"
+#include "test_vars.h"
+
+/*
+ *
+ * 
+ * TaylorValue TESTS
+ * 
+ * 
+*/
+
+TEST(taylor_polynomial, double){
+    // x^3 at x = 2: 8, 12, 12, 6, 0.
+    TaylorValue<double, 4> x(2, 1);
+    TaylorValue<double, 4> three(3);
+    TaylorValue<double, 4> res = x.power(three);
+    EXPECT_NEAR(res.derivative(0), 8, 1e-12);
+    EXPECT_NEAR(res.derivative(1), 12, 1e-12);
+    EXPECT_NEAR(res.derivative(2), 12, 1e-12);
+    EXPECT_NEAR(res.derivative(3), 6, 1e-12);
+    EXPECT_NEAR(res.derivative(4), 0, 1e-12);
+}
+
+TEST(taylor_reciprocal, double){
+    // 1/(1-x) at x = 0.5: j! / 0.5^(j+1).
+    TaylorValue<double, 6> x(0.5, 1);
+    TaylorValue<double, 6> one(1);
+    TaylorValue<double, 6> res = one.ADdiv(one - x);
+    double factorial = 1;
+    for (int j = 0; j <= 6; ++j) {
+        factorial *= j > 0 ? j : 1;
+        EXPECT_NEAR(res.derivative(j), factorial / pow(0.5, j + 1), 1e-6);
+    }
+}
+
+TEST(taylor_exp_sin_cos, double){
+    TaylorValue<double, 8> x(0.3, 1);
+    TaylorValue<double, 8> e = x.ADexp();
+    TaylorValue<double, 8> s = x.ADsin();
+    TaylorValue<double, 8> c = x.ADcos();
+    double sin_cycle[4] = { sin(0.3), cos(0.3), -sin(0.3), -cos(0.3) };
+    for (int j = 0; j <= 8; ++j) {
+        EXPECT_NEAR(e.derivative(j), exp(0.3), 1e-9);
+        EXPECT_NEAR(s.derivative(j), sin_cycle[j % 4], 1e-9);
+        EXPECT_NEAR(c.derivative(j), sin_cycle[(j + 1) % 4], 1e-9);
+    }
+}
+
+TEST(taylor_identities, double){
+    // Each of these compositions is the identity (or a constant), which checks
+    // all orders of every rule against its inverse.
+    TaylorValue<double, 8> x(0.3, 1);
+    TaylorValue<double, 8> one(1);
+    TaylorValue<double, 8> two(2);
+    TaylorValue<double, 8> e(exp(1.0));
+    std::vector<TaylorValue<double, 8>> identities = {
+        x.ADarctan().ADtan(),
+        x.ADtan().ADarctan(),
+        x.ADsin().ADarcsin(),
+        x.ADcos().ADarccos(),
+        x.ADexp().ADlog(e),
+        x.ADsqrt().ADmul(x.ADsqrt()),
+        x.power(two).ADsqrt(),
+        x.ADtanh().ADmul(x.ADcosh()).ADdiv(x.ADsinh()).ADmul(x),
+        // log(1/logistic(x)) = log(1 + exp(-x)).
+        one.ADdiv(x.ADlogistic()).ADlog(e) -
+            (one + (TaylorValue<double, 8>(0) - x).ADexp()).ADlog(e) + x,
+        x.power(x).ADlog(e).ADdiv(x.ADlog(e)),
+    };
+    for (int k = 0; k < identities.size(); ++k) {
+        EXPECT_NEAR(identities[k].val(), 0.3, 1e-9) << k;
+        EXPECT_NEAR(identities[k].derivative(1), 1, 1e-9) << k;
+        for (int j = 2; j <= 8; ++j) {
+            EXPECT_NEAR(identities[k].derivative(j), 0, 1e-6) << k << "," << j;
+        }
+    }
+}
+
+TEST(taylor_autodiffer_directional, double){
+    // f(x,y) = x*y along (1,1) from (1,2): (1+t)(2+t) = 2 + 3t + t^2.
+    AutoDiffer<double> ad;
+    std::vector<std::pair<std::string, double>> point = {
+        std::pair<std::string, double>("x", 1.),
+        std::pair<std::string, double>("y", 2.) };
+    std::vector<double> v = { 1., 1. };
+    std::pair<Status, std::vector<double>> res =
+        ad.DeriveTaylor<3>("(x*y)", point, v);
+    ASSERT_EQ(res.first.code, ReturnCode::success);
+    ASSERT_EQ(res.second.size(), 4);
+    EXPECT_NEAR(res.second[0], 2, 1e-12);
+    EXPECT_NEAR(res.second[1], 3, 1e-12);
+    EXPECT_NEAR(res.second[2], 2, 1e-12);
+    EXPECT_NEAR(res.second[3], 0, 1e-12);
+}
+
+TEST(taylor_autodiffer_matches_first_order, double){
+    // The first derivative must agree with ADValue for a mix of every op.
+    std::string eq = "((((logistic(x))+(log_2.33_(x^2)))*(tanh(x)))/"
+                     "((sqrt(x))+((arcsin(x))-(2^(cosh(x))))))";
+    AutoDiffer<double> ad;
+    ad.SetSeed("x", 0.4, 1);
+    ADValue<double> expected = ad.Derive(eq).second;
+    std::vector<std::pair<std::string, double>> point = {
+        std::pair<std::string, double>("x", 0.4) };
+    std::vector<double> v = { 1. };
+    std::pair<Status, std::vector<double>> res =
+        ad.DeriveTaylor<5>(eq, point, v);
+    ASSERT_EQ(res.first.code, ReturnCode::success);
+    EXPECT_NEAR(res.second[0], expected.val(), 1e-12);
+    EXPECT_NEAR(res.second[1], expected.dval(0), 1e-9);
+}
@@ -0,0 +1,331 @@
+/* system header files */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <math.h>
+/* googletest header files */
+#include "gtest/gtest.h"
+
+/* header files */
+#include "ADValue.hpp"
+#include "AutoDiffer.hpp"
+#include "Executor.hpp"
+#include "PassManager.hpp"
+#include "Tape.hpp"
+#include "Workspace.hpp"
+#include "test_vars.h"
+
+/*
+ *
+ *
+ * Workspace TESTS
+ *
+ *
+ */
+
+const std::vector<std::string> WORKSPACE_TEST_EQS = {
+    "((x^2)+(sin(y)))",
+    "((3*x)*(exp((y/x))))",
+    "((log_2.33_(x))-(cosh(y)))",
+    "(((x*y)+(sin(x)))*((x-y)/(cos(y))))",
+    "((sqrt((x*y)))+((2*x)^3))",
+    "(5)",
+};
+
+static std::vector<std::pair<std::string, ADValue<double>>> WorkspaceSeeds(
+    double x, double y) {
+    return { { "y", ADValue<double>(y, { 0, 1, 0.5 }) },
+             { "x", ADValue<double>(x, { 1, 0, 0.5 }) } };
+}
+
+// Derives a tape by forward mode on ADValues, the reference.
+static ADValue<double> ForwardDerive(
+    const Tape<double>& tape,
+    const std::vector<std::pair<std::string, ADValue<double>>>& seeds) {
+    std::vector<std::string> names;
+    for (auto& seed : seeds) {
+        names.push_back(seed.first);
+    }
+    std::vector<int> index;
+    tape.ResolveVariables(names, index);
+    std::vector<ADValue<double>> slots;
+    for (int j : index) {
+        slots.push_back(seeds[j].second);
+    }
+    int width = seeds[0].second.dvals().size();
+    return tape.Forward(slots, [width](double c) {
+        return ADValue<double>(c, std::vector<double>(width, 0));
+    });
+}
+
+TEST(workspace_matches_forward, double){
+    Workspace<double> workspace;
+    std::vector<std::pair<std::string, ADValue<double>>> seeds =
+        WorkspaceSeeds(0.7, 1.3);
+    for (const std::string& equation : WORKSPACE_TEST_EQS) {
+        Tape<double> tape;
+        ASSERT_EQ(tape.Compile(equation).code, ReturnCode::success);
+        // As parsed, optimized, and optimized with slot reuse.
+        for (int variant = 0; variant < 3; ++variant) {
+            if (variant == 1) {
+                PassManager<double>::Default().Run(tape);
+            } else if (variant == 2) {
+                tape.ReuseSlots();
+            }
+            ADValue<double> expected = ForwardDerive(tape, seeds);
+            std::pair<Status, ADValue<double>> actual =
+                workspace.Derive(tape, seeds);
+            ASSERT_EQ(actual.first.code, ReturnCode::success);
+            EXPECT_NEAR(actual.second.val(), expected.val(), 1e-12);
+            ASSERT_EQ(actual.second.dvals().size(), 3);
+            for (int k = 0; k < 3; ++k) {
+                EXPECT_NEAR(actual.second.dval(k), expected.dval(k), 1e-12)
+                    << equation;
+            }
+        }
+    }
+}
+
+TEST(workspace_reused, double){
+    Tape<double> large;
+    ASSERT_EQ(large.Compile(WORKSPACE_TEST_EQS[3]).code, ReturnCode::success);
+    Tape<double> small;
+    ASSERT_EQ(small.Compile(WORKSPACE_TEST_EQS[0]).code, ReturnCode::success);
+    Workspace<double> workspace;
+    EXPECT_EQ(workspace.NumGrowths(), 0);
+    workspace.Derive(large, WorkspaceSeeds(0.7, 1.3));
+    EXPECT_EQ(workspace.NumGrowths(), 1);
+    size_t bytes = workspace.CapacityBytes();
+    EXPECT_GE(bytes, large.NumSlots() * 4 * sizeof(double));
+    // Smaller items and later items of the same size fit.
+    for (int i = 0; i < 10; ++i) {
+        workspace.Derive(small, WorkspaceSeeds(0.1 * i, 1.3));
+        workspace.Derive(large, WorkspaceSeeds(0.1 * i, 1.3));
+    }
+    EXPECT_EQ(workspace.NumGrowths(), 1);
+    EXPECT_EQ(workspace.CapacityBytes(), bytes);
+}
+
+TEST(workspace_invalid, double){
+    Tape<double> tape;
+    ASSERT_EQ(tape.Compile("((x^y)+z)").code, ReturnCode::success);
+    Workspace<double> workspace;
+    std::pair<Status, ADValue<double>> res =
+        workspace.Derive(tape, WorkspaceSeeds(0.7, 1.3));
+    EXPECT_EQ(res.first.code, ReturnCode::parse_error);
+    EXPECT_EQ(res.first.message, "Key not found: z");
+
+    std::vector<std::pair<std::string, ADValue<double>>> seeds =
+        WorkspaceSeeds(0.7, 1.3);
+    seeds.push_back({ "z", ADValue<double>(1, 0) });
+    res = workspace.Derive(tape, seeds);
+    EXPECT_EQ(res.first.code, ReturnCode::invalid_argument);
+
+    // A power of a negative base with a varying exponent.
+    seeds = WorkspaceSeeds(-0.7, 1.3);
+    seeds.push_back({ "z", ADValue<double>(1, { 0, 0, 0 }) });
+    EXPECT_THROW(workspace.Derive(tape, seeds), std::logic_error);
+    // With a constant exponent it is defined.
+    seeds[0].second = ADValue<double>(2, { 0, 0, 0 });
+    res = workspace.Derive(tape, seeds);
+    ASSERT_EQ(res.first.code, ReturnCode::success);
+    EXPECT_NEAR(res.second.dval(0), 2 * -0.7, 1e-12);
+}
+
+TEST(derive_compiled, double){
+    std::vector<std::string> equations = WORKSPACE_TEST_EQS;
+    equations.push_back("((x+w))");
+    std::vector<std::vector<std::pair<std::string, ADValue<double>>>> seeds;
+    for (int i = 0; i < 40; ++i) {
+        seeds.push_back(WorkspaceSeeds(0.1 + 0.05 * i, 1.3));
+    }
+    std::vector<Tape<double>> tapes(WORKSPACE_TEST_EQS.size());
+    for (int i = 0; i < tapes.size(); ++i) {
+        ASSERT_EQ(tapes[i].Compile(equations[i]).code, ReturnCode::success);
+    }
+    for (ExecutorPolicy policy : { ExecutorPolicy::serial,
+                                   ExecutorPolicy::work_stealing }) {
+        AutoDiffer<double> ad;
+        ad.SetExecutor(policy, 3);
+        for (auto& seed : WorkspaceSeeds(0.7, 1.3)) {
+            ad.SetSeedVector(seed.first, seed.second.val(),
+                             seed.second.dvals());
+        }
+        // Twice, the second time with the tapes and workspaces kept.
+        for (int pass = 0; pass < 2; ++pass) {
+            std::vector<std::pair<Status, ADValue<double>>> res =
+                ad.DeriveCompiled(equations);
+            ASSERT_EQ(res.size(), equations.size());
+            for (int i = 0; i < tapes.size(); ++i) {
+                ADValue<double> expected =
+                    ForwardDerive(tapes[i], WorkspaceSeeds(0.7, 1.3));
+                ASSERT_EQ(res[i].first.code, ReturnCode::success);
+                EXPECT_NEAR(res[i].second.val(), expected.val(), 1e-12);
+                for (int k = 0; k < 3; ++k) {
+                    EXPECT_NEAR(res[i].second.dval(k), expected.dval(k),
+                                1e-12);
+                }
+            }
+            EXPECT_EQ(res.back().first.code, ReturnCode::parse_error);
+        }
+        std::vector<std::pair<Status, ADValue<double>>> res =
+            ad.DeriveCompiled(equations[1], seeds);
+        EXPECT_EQ(ad.Stats().num_items, seeds.size());
+        ASSERT_EQ(res.size(), seeds.size());
+        for (int i = 0; i < res.size(); ++i) {
+            ADValue<double> expected = ForwardDerive(tapes[1], seeds[i]);
+            ASSERT_EQ(res[i].first.code, ReturnCode::success);
+            EXPECT_NEAR(res[i].second.val(), expected.val(), 1e-12);
+            EXPECT_NEAR(res[i].second.dval(2), expected.dval(2), 1e-12);
+        }
+        res = ad.DeriveCompiled("((x+)", seeds);
+        EXPECT_EQ(res[0].first.code, ReturnCode::parse_error);
+    }
+}
+
+TEST(derive_dense, double){
+    std::vector<std::string> equations = WORKSPACE_TEST_EQS;
+    equations.push_back("((x+w))");
+    int rows = equations.size();
+    std::vector<Tape<double>> tapes(WORKSPACE_TEST_EQS.size());
+    for (int i = 0; i < tapes.size(); ++i) {
+        ASSERT_EQ(tapes[i].Compile(equations[i]).code, ReturnCode::success);
+    }
+    AutoDiffer<double> ad;
+    ad.SetExecutor(ExecutorPolicy::thread_pool, 3);
+    for (auto& seed : WorkspaceSeeds(0.7, 1.3)) {
+        ad.SetSeedVector(seed.first, seed.second.val(), seed.second.dvals());
+    }
+    for (MatrixLayout layout : { MatrixLayout::row_major,
+                                 MatrixLayout::column_major }) {
+        std::vector<double> values(rows, -1);
+        std::vector<double> jacobian(rows * 3, -1);
+        std::vector<ReturnCode> codes(rows);
+        std::vector<std::pair<int, Status>> errors;
+        Status status = ad.DeriveDense(equations, values.data(),
+                                       jacobian.data(), codes.data(),
+                                       layout, &errors);
+        ASSERT_EQ(status.code, ReturnCode::success);
+        for (int i = 0; i < tapes.size(); ++i) {
+            ADValue<double> expected =
+                ForwardDerive(tapes[i], WorkspaceSeeds(0.7, 1.3));
+            EXPECT_EQ(codes[i], ReturnCode::success);
+            EXPECT_NEAR(values[i], expected.val(), 1e-12);
+            for (int k = 0; k < 3; ++k) {
+                double actual = layout == MatrixLayout::row_major ?
+                    jacobian[i * 3 + k] : jacobian[k * rows + i];
+                EXPECT_NEAR(actual, expected.dval(k), 1e-12);
+            }
+        }
+        // The failed row is zero, and its message is out of line.
+        EXPECT_EQ(codes.back(), ReturnCode::parse_error);
+        EXPECT_EQ(values.back(), 0);
+        EXPECT_EQ(jacobian[layout == MatrixLayout::row_major ?
+                           rows * 3 - 1 : 3 * rows - 1], 0);
+        ASSERT_EQ(errors.size(), 1);
+        EXPECT_EQ(errors[0].first, rows - 1);
+        EXPECT_EQ(errors[0].second.message, "Key not found: w");
+    }
+
+    std::vector<std::vector<std::pair<std::string, ADValue<double>>>> seeds;
+    for (int i = 0; i < 20; ++i) {
+        seeds.push_back(WorkspaceSeeds(0.1 + 0.05 * i, 1.3));
+    }
+    seeds[7][0].second = ADValue<double>(1.3, { 0, 1 });
+    seeds[7][1].second = ADValue<double>(0.7, { 1, 0 });
+    std::vector<double> values(seeds.size());
+    std::vector<double> jacobian(seeds.size() * 3);
+    std::vector<ReturnCode> codes(seeds.size());
+    ad.DeriveDense(equations[1], seeds, values.data(), jacobian.data(),
+                   codes.data(), MatrixLayout::column_major);
+    for (int i = 0; i < seeds.size(); ++i) {
+        if (i == 7) {
+            EXPECT_EQ(codes[i], ReturnCode::invalid_argument);
+            continue;
+        }
+        ADValue<double> expected = ForwardDerive(tapes[1], seeds[i]);
+        EXPECT_EQ(codes[i], ReturnCode::success);
+        EXPECT_NEAR(values[i], expected.val(), 1e-12);
+        EXPECT_NEAR(jacobian[2 * seeds.size() + i], expected.dval(2), 1e-12);
+    }
+
+    ad.SetSeedVector("w", 1, { 1 });
+    EXPECT_EQ(ad.DeriveDense(equations, values.data(), jacobian.data(),
+                             codes.data()).code,
+              ReturnCode::invalid_argument);
+}
+
+TEST(derive_dense_undefined_row, double){
+    // A power of a negative base with a varying exponent fails its row only.
+    std::vector<std::string> equations = { "((x^x))", "((x*2))", "((x+1))" };
+    for (ExecutorPolicy policy : { ExecutorPolicy::serial,
+                                   ExecutorPolicy::thread_pool }) {
+        AutoDiffer<double> ad;
+        ad.SetExecutor(policy, 2);
+        ad.SetSeed("x", -2, 1);
+        std::vector<double> values(3, -1);
+        std::vector<double> jacobian(3, -1);
+        std::vector<ReturnCode> codes(3, ReturnCode::parse_error);
+        std::vector<std::pair<int, Status>> errors;
+        Status status = ad.DeriveDense(equations, values.data(),
+                                       jacobian.data(), codes.data(),
+                                       MatrixLayout::row_major, &errors);
+        ASSERT_EQ(status.code, ReturnCode::success);
+        EXPECT_EQ(codes[0], ReturnCode::invalid_argument);
+        EXPECT_EQ(values[0], 0);
+        EXPECT_EQ(jacobian[0], 0);
+        EXPECT_EQ(codes[1], ReturnCode::success);
+        EXPECT_NEAR(values[1], -4, 1e-12);
+        EXPECT_NEAR(jacobian[1], 2, 1e-12);
+        EXPECT_EQ(codes[2], ReturnCode::success);
+        EXPECT_NEAR(values[2], -1, 1e-12);
+        EXPECT_NEAR(jacobian[2], 1, 1e-12);
+        ASSERT_EQ(errors.size(), 1);
+        EXPECT_EQ(errors[0].first, 0);
+        EXPECT_EQ(errors[0].second.message,
+                  "Derivative not defined or complex.");
+    }
+}
+
+TEST(derive_dense_points, double){
+    const std::string equation = WORKSPACE_TEST_EQS[3];
+    Tape<double> tape;
+    ASSERT_EQ(tape.Compile(equation).code, ReturnCode::success);
+    // Columns x, y and an unused z.
+    int num_points = 50;
+    std::vector<double> points;
+    for (int i = 0; i < num_points; ++i) {
+        points.push_back(0.1 + 0.02 * i);
+        points.push_back(1.3 - 0.01 * i);
+        points.push_back(7);
+    }
+    AutoDiffer<double> ad;
+    ad.SetExecutor(ExecutorPolicy::work_stealing, 4);
+    std::vector<double> values(num_points);
+    std::vector<double> jacobian(num_points * 3, -1);
+    std::vector<ReturnCode> codes(num_points);
+    Status status = ad.DeriveDense(equation, { "x", "y", "z" },
+                                   points.data(), num_points, values.data(),
+                                   jacobian.data(), codes.data());
+    ASSERT_EQ(status.code, ReturnCode::success);
+    for (int i = 0; i < num_points; ++i) {
+        std::vector<std::pair<std::string, ADValue<double>>> seeds = {
+            { "x", ADValue<double>(points[i * 3], { 1, 0, 0 }) },
+            { "y", ADValue<double>(points[i * 3 + 1], { 0, 1, 0 }) },
+        };
+        ADValue<double> expected = ForwardDerive(tape, seeds);
+        EXPECT_EQ(codes[i], ReturnCode::success);
+        EXPECT_NEAR(values[i], expected.val(), 1e-12);
+        EXPECT_NEAR(jacobian[i * 3], expected.dval(0), 1e-12);
+        EXPECT_NEAR(jacobian[i * 3 + 1], expected.dval(1), 1e-12);
+        EXPECT_EQ(jacobian[i * 3 + 2], 0);
+    }
+
+    status = ad.DeriveDense(equation, { "x" }, points.data(), num_points,
+                            values.data(), jacobian.data(), codes.data());
+    EXPECT_EQ(status.code, ReturnCode::parse_error);
+    EXPECT_EQ(status.message, "Key not found: y");
+}
@@ -36,8 +36,272 @@ enum class Operation {
   logistic = 16,
   log = 17,
   sqrt = 18,
+  // Fused ops. They are never produced by the parser, only by the fusion pass
+  // of a compiled tape (see FuseOperations in TapePasses.hpp).
+  // (a*b)+c, with the addend c as third operand.
+  fma = 19,
+  // (x*x).
+  square = 20,
+  // (1/x).
+  reciprocal = 21,
+  // (x^n) for a constant integer n held by the auxilary value.
+  ipow = 22,
+  // (exp(0-x)).
+  expneg = 23,
+  // (log_b(logistic(x))), with the base b as auxilary value.
+  loglogistic = 24,
 };
 
+/**
+ * Applies an operation to one (unary) or two (binary) values. Any value type
+ * that provides the ADValue operator interface (operator+, operator-, ADmul,
+ * ADdiv, power, ADsin, ...) can be evaluated this way, which lets the compiled
+ * tape and ADNode share a single dispatch. For unary ops aux is ignored.
+ *
+ * @param op: the op to apply.
+ * @param self: the main value of the operation.
+ * @param aux: the auxilary value of the operation.
+ * @param third: the addend of fma. Ignored by every other op.
+ * @returns : a value with the result of the operation being executed.
+ */
+template <class V>
+V EvaluateOperation(Operation op, V& self, V& aux, V& third) {
+    switch(op) {
+      case Operation::addition : {
+        return self + aux;
+      }
+
+      case Operation::multiplication : {
+        return self.ADmul(aux);
+      }
+
+      case Operation::division : {
+        return self.ADdiv(aux);
+      }
+
+      case Operation::power : {
+        return self.power(aux);
+      }
+
+      case Operation::subtraction : {
+
+        return self - aux; 
+      }
+
+      case Operation::sin : {
+        return self.ADsin(); 
+      }
+
+      case Operation::cos : {
+        return self.ADcos(); 
+      }
+
+      case Operation::tan : {
+        return self.ADtan(); 
+      }
+
+      case Operation::exp : {
+        return self.ADexp();
+      }
+
+      case Operation::arcsin : {
+        return self.ADarcsin();
+      }
+
+      case Operation::arccos : {
+        return self.ADarccos();
+      }
+
+      case Operation::arctan : {
+        return self.ADarctan();
+      }
+
+      case Operation::sinh : {
+        return self.ADsinh();
+      }
+
+      case Operation::cosh : {
+        return self.ADcosh();
+      }
+
+      case Operation::tanh : {
+        return self.ADtanh();
+      }
+
+      case Operation::logistic : {
+        return self.ADlogistic();
+      }
+
+      case Operation::log : {
+        return self.ADlog(aux);
+      }
+
+      case Operation::sqrt : {
+        return self.ADsqrt();
+      }
+
+      case Operation::fma : {
+        return self.ADfma(aux, third);
+      }
+
+      case Operation::square : {
+        return self.ADsquare();
+      }
+
+      case Operation::reciprocal : {
+        return self.ADreciprocal();
+      }
+
+      case Operation::ipow : {
+        return self.ADipow(aux);
+      }
+
+      case Operation::expneg : {
+        return self.ADexpneg();
+      }
+
+      case Operation::loglogistic : {
+        return self.ADloglogistic(aux);
+      }
+    }
+    // Unreachable for valid ops.
+    return V();
+}
+
+/**
+ * Applies a unary or binary operation. See the overload above.
+ *
+ * @param op: the op to apply, anything but fma.
+ * @param self: the main value of the operation.
+ * @param aux: the auxilary value of the operation.
+ * @returns : a value with the result of the operation being executed.
+ */
+template <class V>
+V EvaluateOperation(Operation op, V& self, V& aux) {
+    return EvaluateOperation(op, self, aux, aux);
+}
+
+/**
+ * Value of an operation on plain values. Follows the same conventions as the
+ * ADValue operators (e.g., division by zero gives NAN, and 0^y gives 0).
+ *
+ * @param op: the op to apply.
+ * @param a: the main value.
+ * @param b: the auxilary value. Ignored by unary ops.
+ * @param c: the addend of fma. Ignored by every other op.
+ * @returns: the result of the operation.
+ */
+template <class T>
+T PrimalOperation(Operation op, T a, T b, T c = 0) {
+    switch(op) {
+      case Operation::addition : return a + b;
+      case Operation::subtraction : return a - b;
+      case Operation::multiplication : return a * b;
+      case Operation::division : return b == 0 ? NAN : a / b;
+      case Operation::power : return a == 0 ? 0 : pow(a, b);
+      case Operation::sin : return sin(a);
+      case Operation::cos : return cos(a);
+      case Operation::tan : return tan(a);
+      case Operation::exp : return exp(a);
+      case Operation::arcsin : return asin(a);
+      case Operation::arccos : return acos(a);
+      case Operation::arctan : return atan(a);
+      case Operation::sinh : return sinh(a);
+      case Operation::cosh : return cosh(a);
+      case Operation::tanh : return tanh(a);
+      case Operation::logistic : return exp(a) / (1 + exp(a));
+      case Operation::log : return log(a) / log(b);
+      case Operation::sqrt : return sqrt(a);
+      case Operation::fma : return a * b + c;
+      case Operation::square : return a * a;
+      case Operation::reciprocal : return a == 0 ? NAN : 1 / a;
+      case Operation::ipow : return a == 0 ? 0 : pow(a, b);
+      case Operation::expneg : return exp(-a);
+      case Operation::loglogistic : return LogLogistic(a) / log(b);
+    }
+    return 0;
+}
+
+/**
+ * Local partial derivatives of an operation, using the same rules as the
+ * ADValue operators. Like ADValue::ADlog, the base of a log is treated as a
+ * constant, and so is the exponent of ipow. The partial of fma w.r.t. its
+ * addend is always 1 and is not returned.
+ *
+ * @param op: the op to apply.
+ * @param a: the main value.
+ * @param b: the auxilary value. Ignored by unary ops.
+ * @param value: the result of PrimalOperation(op, a, b).
+ * @param da: set to the partial w.r.t. a.
+ * @param db: set to the partial w.r.t. b (0 for unary ops).
+ * @returns: false if the partial w.r.t. b is not defined (negative base of a
+ * power), true otherwise.
+ */
+template <class T>
+bool PartialOperation(Operation op, T a, T b, T value, T& da, T& db) {
+    db = 0;
+    switch(op) {
+      case Operation::addition : {
+        da = 1;
+        db = 1;
+        break;
+      }
+      case Operation::subtraction : {
+        da = 1;
+        db = -1;
+        break;
+      }
+      case Operation::multiplication : {
+        da = b;
+        db = a;
+        break;
+      }
+      case Operation::division : {
+        da = b / pow(b, 2);
+        db = -a / pow(b, 2);
+        break;
+      }
+      case Operation::power : {
+        if (a == 0) {
+            da = 0;
+        } else if (a > 0) {
+            // Generalized chain rule.
+            da = value * b / a;
+            db = value * log(a);
+        } else {
+            // Power rule, the exponent must be a constant.
+            da = b * pow(a, b - 1);
+            return false;
+        }
+        break;
+      }
+      case Operation::sin : da = cos(a); break;
+      case Operation::cos : da = -sin(a); break;
+      case Operation::tan : da = 1 / pow(cos(a), 2); break;
+      case Operation::exp : da = exp(a); break;
+      case Operation::arcsin : da = 1 / sqrt(1 - pow(a, 2)); break;
+      case Operation::arccos : da = -1 / sqrt(1 - pow(a, 2)); break;
+      case Operation::arctan : da = 1 / (1 + pow(a, 2)); break;
+      case Operation::sinh : da = cosh(a); break;
+      case Operation::cosh : da = sinh(a); break;
+      case Operation::tanh : da = 1 / pow(cosh(a), 2); break;
+      case Operation::logistic : da = exp(a) / pow(1 + exp(a), 2); break;
+      case Operation::log : da = 1 / (a * log(b)); break;
+      case Operation::sqrt : da = 0.5 * pow(a, -0.5); break;
+      case Operation::fma : {
+        da = b;
+        db = a;
+        break;
+      }
+      case Operation::square : da = 2 * a; break;
+      case Operation::reciprocal : da = -1 / (a * a); break;
+      case Operation::ipow : da = a == 0 ? 0 : b * pow(a, b - 1); break;
+      case Operation::expneg : da = -value; break;
+      case Operation::loglogistic : da = 1 / ((1 + exp(a)) * log(b)); break;
+    }
+    return true;
+}
+
 /**
  * The ADNode class is the handler for evaluating ADValues given an operation.
  * It handles both binary and unary operations by having a self and auxilary
@@ -111,80 +375,7 @@ class ADNode {
      * @returns : an ADValue with the result of the operation being executed.
      */
     ADValue<T> Evaluate() {
-      switch(op_) {
-        case Operation::addition : {
-          return self_vertex_ + aux_vertex_;
-        }
-
-        case Operation::multiplication : {
-          return self_vertex_.ADmul(aux_vertex_);
-        }
-
-        case Operation::division : {
-          return self_vertex_.ADdiv(aux_vertex_);
-        }
-
-        case Operation::power : {
-          return self_vertex_.power(aux_vertex_);
-        }
-
-        case Operation::subtraction : {
-
-          return self_vertex_ - aux_vertex_; 
-        }
-
-        case Operation::sin : {
-          return self_vertex_.ADsin(); 
-        }
-
-        case Operation::cos : {
-          return self_vertex_.ADcos(); 
-        }
-
-        case Operation::tan : {
-          return self_vertex_.ADtan(); 
-        }
-
-        case Operation::exp : {
-          return self_vertex_.ADexp();
-        }
-
-        case Operation::arcsin : {
-          return self_vertex_.ADarcsin();
-        }
-
-        case Operation::arccos : {
-          return self_vertex_.ADarccos();
-        }
-
-        case Operation::arctan : {
-          return self_vertex_.ADarctan();
-        }
-
-        case Operation::sinh : {
-          return self_vertex_.ADsinh();
-        }
-
-        case Operation::cosh : {
-          return self_vertex_.ADcosh();
-        }
-
-        case Operation::tanh : {
-          return self_vertex_.ADtanh();
-        }
-
-        case Operation::logistic : {
-          return self_vertex_.ADlogistic();
-        }
-
-        case Operation::log : {
-          return self_vertex_.ADlog(aux_vertex_);
-        }
-
-        case Operation::sqrt : {
-          return self_vertex_.ADsqrt();
-        }
-      }
+      return EvaluateOperation(op_, self_vertex_, aux_vertex_);
     }
 };
 
@@ -14,10 +14,23 @@
 # include <math.h>
 # include <cmath>
 # include <stdio.h>
+# include <utility>
 # include <vector>
 #endif
 
 
+/**
+ * Natural log of the logistic function, log(exp(x) / (1 + exp(x))), computed
+ * without overflow as -log(1 + exp(-x)).
+ *
+ * @param: x: the argument.
+ * @returns: the log of the logistic of x.
+ */
+template <class T>
+T LogLogistic(T x) {
+    return x >= 0 ? -log1p(exp(-x)) : x - log1p(exp(x));
+}
+
 /**
  * The ADValue class represents the main AutoDiffer value objects. ADValues 
  * contain a value (accessed via .val()) and a vector of derivatives (accessed
@@ -60,9 +73,19 @@ class ADValue {
      */
     ADValue(T val,const std::vector<T>& dvals) : v(val), dvs(dvals) {};
 
+    /**
+     * Overloaded constructor for the vector case that takes over the vector
+     * of derivatives instead of copying it.
+     *
+     * @param: val: the inital value.
+     * @param: dvals: vector with the inital value of the derivatives.
+     */
+    ADValue(T val, std::vector<T>&& dvals) : v(val), dvs(std::move(dvals)) {};
+
     /* getters */
     T val() const { return v; };
     T dval(int i) const { return dvs[i]; };
+    const std::vector<T>& dvals() const { return dvs; };
 
     /**
      * Overloaded addition operator. Each derivative in the vector of derivs
@@ -197,6 +220,55 @@ class ADValue {
      */
     ADValue<T> ADsqrt();
 
+    /**
+     * Fused multiply add, (this * other) + addend, in a single pass over the
+     * derivatives.
+     *
+     * @param: other: the right hand side of the multiplication.
+     * @param: addend: the value added to the product.
+     * @returns: ADValue with the result of the fma.
+     */
+    ADValue<T> ADfma(const ADValue<T> &other, const ADValue<T> &addend);
+
+    /**
+     * Square operator, the fused form of this * this.
+     *
+     * @returns: ADValue with the result of the square.
+     */
+    ADValue<T> ADsquare();
+
+    /**
+     * Reciprocal operator, the fused form of 1 / this.
+     *
+     * @returns: ADValue with the result of the reciprocal.
+     */
+    ADValue<T> ADreciprocal();
+
+    /**
+     * Power with a constant integer exponent. Unlike power, the derivatives
+     * of the exponent are ignored, so a negative base is allowed.
+     *
+     * @param: other: the exponent.
+     * @returns: ADValue with the result of the power.
+     */
+    ADValue<T> ADipow(const ADValue<T> &other);
+
+    /**
+     * Negated exponentiation operator, the fused form of exp(0 - this).
+     *
+     * @returns: ADValue with the result of the exp.
+     */
+    ADValue<T> ADexpneg();
+
+    /**
+     * Log of the logistic, the fused form of logistic followed by log. Does
+     * not overflow for large arguments.
+     *
+     * @param: other: the base of the logarithm.
+     * @returns: ADValue with the result of the log.
+     */
+    ADValue<T> ADloglogistic(const ADValue<T> &other);
+
     /**
      * Equality comparison operator. Only returns true if value and all dvals
      * are equal.
@@ -479,4 +551,83 @@ ADValue<T> ADValue<T>::ADsqrt() {
     return ADValue<T>(new_v, new_derivs);
 }
 
+template<class T>
+ADValue<T> ADValue<T>::ADfma(const ADValue<T> &other,
+                             const ADValue<T> &addend) {
+    T new_v = v * other.val() + addend.val();
+    std::vector<T> new_derivs(dvs.size());
+    // Product rule plus the derivative of the addend.
+    for (int i = 0; i < dvs.size(); ++i) {
+        new_derivs[i] = dvs[i]*other.v + other.dvs[i]*v + addend.dvs[i];
+    }
+    return ADValue<T>(new_v, new_derivs);
+}
+
+template<class T>
+ADValue<T> ADValue<T>::ADsquare() {
+    T new_v = v * v;
+    T factor = 2 * v;
+    std::vector<T> new_derivs(dvs.size());
+    // Chain rule.
+    for (int i = 0; i < dvs.size(); ++i) {
+        new_derivs[i] = factor * dvs[i];
+    }
+    return ADValue<T>(new_v, new_derivs);
+}
+
+template<class T>
+ADValue<T> ADValue<T>::ADreciprocal() {
+    // Same convention as ADdiv for a zero denominator.
+    T new_v = v == 0 ? NAN : 1 / v;
+    T factor = -1 / (v * v);
+    std::vector<T> new_derivs(dvs.size());
+    // Chain rule.
+    for (int i = 0; i < dvs.size(); ++i) {
+        new_derivs[i] = factor * dvs[i];
+    }
+    return ADValue<T>(new_v, new_derivs);
+}
+
+template<class T>
+ADValue<T> ADValue<T>::ADipow(const ADValue<T> &other) {
+    // Same convention as power for a zero base.
+    if (v == 0) {
+        return ADValue<T>(0, std::vector<T>(dvs.size(), 0));
+    }
+    T n = other.val();
+    T new_v = pow(v, n);
+    T factor = n * pow(v, n - 1);
+    std::vector<T> new_derivs(dvs.size());
+    // Power rule.
+    for (int i = 0; i < dvs.size(); ++i) {
+        new_derivs[i] = factor * dvs[i];
+    }
+    return ADValue<T>(new_v, new_derivs);
+}
+
+template<class T>
+ADValue<T> ADValue<T>::ADexpneg() {
+    T new_v = exp(-v);
+    std::vector<T> new_derivs(dvs.size());
+    // Chain rule.
+    for (int i = 0; i < dvs.size(); ++i) {
+        new_derivs[i] = -new_v * dvs[i];
+    }
+    return ADValue<T>(new_v, new_derivs);
+}
+
+template<class T>
+ADValue<T> ADValue<T>::ADloglogistic(const ADValue<T> &other) {
+    // As in ADlog the base is treated as a constant.
+    T log_base = log(other.val());
+    T new_v = LogLogistic(v) / log_base;
+    // d/dx log(logistic(x)) = 1 - logistic(x) = 1 / (1 + exp(x)).
+    T factor = 1 / ((1 + exp(v)) * log_base);
+    std::vector<T> new_derivs(dvs.size());
+    for (int i = 0; i < dvs.size(); ++i) {
+        new_derivs[i] = factor * dvs[i];
+    }
+    return ADValue<T>(new_v, new_derivs);
+}
+
 #endif /* ADVALUE_H */
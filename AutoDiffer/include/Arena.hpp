@@ -0,0 +1,150 @@
+/**
+ * @file Arena.h
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+/* system header files */
+#ifndef DOXYGEN_IGNORE
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#endif
+
+// Default size in bytes of the first block of an Arena.
+const size_t kArenaBlockSize = 64 * 1024;
+
+/**
+ * The Arena class is a monotonic (bump) allocator. Allocating moves a pointer
+ * forward in the current block, and nothing is freed on its own: Reset
+ * releases everything at once in O(1) by rewinding to the first block. The
+ * blocks are kept, each one at least twice the size of the one before, so
+ * once an evaluation has run, running it again after Reset allocates no
+ * memory from the system. Usage counters make the cost of an evaluation
+ * visible, e.g., to size the first block.
+ *
+ * Example usage:
+ *
+ * Arena arena;
+ * double* buffer = arena.Allocate<double>(100);
+ * ...
+ * arena.Reset();  // buffer is invalid from here on
+ */
+class Arena {
+  private:
+    struct Block {
+      std::unique_ptr<char[]> data;
+      size_t size;
+    };
+
+    std::vector<Block> blocks_;
+    size_t block_size_;
+
+    // Block being filled and the bytes of it in use.
+    size_t current_ = 0;
+    size_t offset_ = 0;
+
+    // Bytes handed out since the last Reset, including alignment padding.
+    size_t used_ = 0;
+    size_t peak_ = 0;
+    size_t num_allocations_ = 0;
+
+  public:
+    /**
+     * Constructor. No memory is allocated until the first Allocate.
+     *
+     * @param block_size: the size in bytes of the first block.
+     */
+    explicit Arena(size_t block_size = kArenaBlockSize)
+        : block_size_(std::max<size_t>(block_size, 64)) {}
+
+    // A copy starts empty with the same block size, it never shares memory.
+    Arena(const Arena& other) : block_size_(other.block_size_) {}
+    Arena& operator=(const Arena& other) {
+        if (this != &other) {
+            *this = Arena(other.block_size_);
+        }
+        return *this;
+    }
+    Arena(Arena&&) = default;
+    Arena& operator=(Arena&&) = default;
+
+    /* getters */
+    // Bytes in use since the last Reset.
+    size_t BytesUsed() const { return used_; }
+    // Most bytes ever in use at once.
+    size_t PeakBytes() const { return peak_; }
+    // Bytes held from the system.
+    size_t CapacityBytes() const {
+        size_t capacity = 0;
+        for (const Block& block : blocks_) {
+            capacity += block.size;
+        }
+        return capacity;
+    }
+    int NumBlocks() const { return blocks_.size(); }
+    // Allocations since the last Reset.
+    size_t NumAllocations() const { return num_allocations_; }
+
+    /**
+     * Allocates memory that stays valid until the next Reset.
+     *
+     * @param bytes: the size.
+     * @param alignment: the alignment, a power of two.
+     * @returns: the memory, not initialized.
+     */
+    void* Allocate(size_t bytes, size_t alignment) {
+        while (true) {
+            if (current_ < blocks_.size()) {
+                Block& block = blocks_[current_];
+                uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+                uintptr_t aligned =
+                    (base + offset_ + alignment - 1) & ~(alignment - 1);
+                size_t end = aligned - base + bytes;
+                if (end <= block.size) {
+                    used_ += end - offset_;
+                    peak_ = std::max(peak_, used_);
+                    ++num_allocations_;
+                    offset_ = end;
+                    return reinterpret_cast<void*>(aligned);
+                }
+                // The rest of this block is too small, move to the next.
+                used_ += block.size - offset_;
+                ++current_;
+                offset_ = 0;
+                continue;
+            }
+            size_t size = blocks_.empty() ? block_size_ :
+                          2 * blocks_.back().size;
+            size = std::max(size, bytes + alignment);
+            blocks_.push_back(Block{std::unique_ptr<char[]>(new char[size]),
+                                    size});
+        }
+    }
+
+    /**
+     * Allocates an array that stays valid until the next Reset.
+     *
+     * @param count: the number of elements.
+     * @returns: the array, not initialized.
+     */
+    template <class U>
+    U* Allocate(size_t count) {
+        return static_cast<U*>(Allocate(count * sizeof(U), alignof(U)));
+    }
+
+    /**
+     * Releases every allocation at once, keeping the blocks for reuse.
+     */
+    void Reset() {
+        current_ = 0;
+        offset_ = 0;
+        used_ = 0;
+        num_allocations_ = 0;
+    }
+};
+
+#endif /* ARENA_H */
@@ -0,0 +1,257 @@
+/**
+ * @file ArenaADValue.h
+ */
+
+#ifndef ARENAADVALUE_H
+#define ARENAADVALUE_H
+
+/* header files */
+#include "ADNode.hpp"
+#include "Arena.hpp"
+
+/* system header files */
+#ifndef DOXYGEN_IGNORE
+# include <algorithm>
+# include <stdexcept>
+# include <vector>
+#endif
+
+
+/**
+ * The ArenaADValue class is an ADValue whose derivatives live in an Arena
+ * instead of a std::vector of their own, so an evaluation does no malloc or
+ * free per operation and all of its derivatives are released at once with
+ * Arena::Reset. It provides the same operator interface as ADValue so it can
+ * be evaluated through a compiled Tape. Constants and values computed only
+ * from constants have no derivative buffer at all.
+ *
+ * An ArenaADValue is a small handle: copies share the derivatives, which are
+ * never modified, and it must not be used after its arena is reset. All
+ * values combined by an operation must have the same number of derivatives,
+ * or none.
+ *
+ * Example usage:
+ *
+ * Arena arena;
+ * ArenaADValue<double> x(1.5, {1, 0}, arena);
+ * ArenaADValue<double> y(2.0, {0, 1}, arena);
+ * ArenaADValue<double> z = x.ADmul(y.ADsin());
+ * arena.Reset();  // x, y and z are invalid from here on
+ */
+template <class T>
+class ArenaADValue {
+  private:
+    // Value.
+    T v;
+
+    // Derivative values in the arena, null if they are all zero.
+    const T* dvs;
+    int width;
+
+    // Arena of the derivatives of results, null for constants.
+    Arena* arena;
+
+    /**
+     * Allocates the derivatives of a result.
+     *
+     * @param result: the result, given the arena and width of this or other.
+     * @param other: the other operand.
+     * @returns: the derivatives of the result, to be filled.
+     */
+    T* NewDerivatives(ArenaADValue<T>& result,
+                      const ArenaADValue<T>& other) const;
+
+    /**
+     * Applies a unary op with the chain rule, dvs[i] = f'(v) * dvs[i].
+     *
+     * @param op: the unary operation.
+     * @returns: ArenaADValue with the result of the op.
+     */
+    ArenaADValue<T> Unary(Operation op) const;
+
+    /**
+     * Applies a binary op, dvs[i] = df/da * dvs[i] + df/db * other.dvs[i].
+     *
+     * @param op: the binary operation.
+     * @param other: the right hand side (or base of a log).
+     * @returns: ArenaADValue with the result of the op.
+     */
+    ArenaADValue<T> Binary(Operation op, const ArenaADValue<T>& other) const;
+
+  public:
+    /**
+     * Default constructor. Zero value without derivatives.
+     */
+    ArenaADValue() : v(0), dvs(nullptr), width(0), arena(nullptr) {}
+
+    /**
+     * Constant constructor. All derivatives are zero.
+     *
+     * @param: val: the value.
+     */
+    explicit ArenaADValue(T val)
+        : v(val), dvs(nullptr), width(0), arena(nullptr) {}
+
+    /**
+     * Constructor for a seed, copying the derivatives into the arena.
+     *
+     * @param: val: the value.
+     * @param: dvals: the derivatives.
+     * @param: arena: the arena of the derivatives of this and every value
+     * computed from it.
+     */
+    ArenaADValue(T val, const std::vector<T>& dvals, Arena& arena)
+        : v(val), width(dvals.size()), arena(&arena) {
+        T* copy = arena.Allocate<T>(width);
+        std::copy(dvals.begin(), dvals.end(), copy);
+        dvs = copy;
+    }
+
+    /* getters */
+    T val() const { return v; };
+    T dval(int i) const { return dvs ? dvs[i] : 0; };
+    // The number of derivatives, 0 if they are all zero.
+    int NumDerivatives() const { return dvs ? width : 0; }
+
+    /**
+     * Copies the derivatives out of the arena.
+     *
+     * @param: size: the number of derivatives, missing ones are zero.
+     * @returns: the derivatives.
+     */
+    std::vector<T> dvals(int size) const {
+        std::vector<T> result(size, 0);
+        if (dvs) {
+            std::copy(dvs, dvs + std::min(size, width), result.begin());
+        }
+        return result;
+    }
+
+    /* operators, see ADValue for documentation */
+    ArenaADValue<T> operator+(const ArenaADValue<T> &other) const {
+        return Binary(Operation::addition, other);
+    }
+    ArenaADValue<T> operator-(const ArenaADValue<T> &other) const {
+        return Binary(Operation::subtraction, other);
+    }
+    ArenaADValue<T> power(const ArenaADValue<T> &other) const {
+        return Binary(Operation::power, other);
+    }
+    ArenaADValue<T> ADmul(const ArenaADValue<T> &other) const {
+        return Binary(Operation::multiplication, other);
+    }
+    ArenaADValue<T> ADdiv(const ArenaADValue<T> &other) const {
+        return Binary(Operation::division, other);
+    }
+    ArenaADValue<T> ADlog(const ArenaADValue<T> &other) const {
+        return Binary(Operation::log, other);
+    }
+    ArenaADValue<T> ADexp() const { return Unary(Operation::exp); }
+    ArenaADValue<T> ADsin() const { return Unary(Operation::sin); }
+    ArenaADValue<T> ADcos() const { return Unary(Operation::cos); }
+    ArenaADValue<T> ADtan() const { return Unary(Operation::tan); }
+    ArenaADValue<T> ADarcsin() const { return Unary(Operation::arcsin); }
+    ArenaADValue<T> ADarccos() const { return Unary(Operation::arccos); }
+    ArenaADValue<T> ADarctan() const { return Unary(Operation::arctan); }
+    ArenaADValue<T> ADsinh() const { return Unary(Operation::sinh); }
+    ArenaADValue<T> ADcosh() const { return Unary(Operation::cosh); }
+    ArenaADValue<T> ADtanh() const { return Unary(Operation::tanh); }
+    ArenaADValue<T> ADlogistic() const { return Unary(Operation::logistic); }
+    ArenaADValue<T> ADsqrt() const { return Unary(Operation::sqrt); }
+    ArenaADValue<T> ADfma(const ArenaADValue<T> &other,
+                          const ArenaADValue<T> &addend) const;
+    ArenaADValue<T> ADsquare() const { return Unary(Operation::square); }
+    ArenaADValue<T> ADreciprocal() const {
+        return Unary(Operation::reciprocal);
+    }
+    ArenaADValue<T> ADipow(const ArenaADValue<T> &other) const {
+        return Binary(Operation::ipow, other);
+    }
+    ArenaADValue<T> ADexpneg() const { return Unary(Operation::expneg); }
+    ArenaADValue<T> ADloglogistic(const ArenaADValue<T> &other) const {
+        return Binary(Operation::loglogistic, other);
+    }
+};
+
+// Implementation
+
+template <class T>
+T* ArenaADValue<T>::NewDerivatives(ArenaADValue<T>& result,
+                                   const ArenaADValue<T>& other) const {
+    const ArenaADValue<T>& source = dvs ? *this : other;
+    result.width = source.width;
+    result.arena = source.arena;
+    T* derivs = source.arena->template Allocate<T>(source.width);
+    result.dvs = derivs;
+    return derivs;
+}
+
+template <class T>
+ArenaADValue<T> ArenaADValue<T>::Unary(Operation op) const {
+    ArenaADValue<T> result(PrimalOperation(op, v, T(0)));
+    if (!dvs) {
+        return result;
+    }
+    T da, db;
+    PartialOperation(op, v, T(0), result.v, da, db);
+    // Chain rule.
+    T* derivs = NewDerivatives(result, *this);
+    for (int i = 0; i < width; ++i) {
+        derivs[i] = da * dvs[i];
+    }
+    return result;
+}
+
+template <class T>
+ArenaADValue<T> ArenaADValue<T>::Binary(
+    Operation op, const ArenaADValue<T>& other) const {
+    ArenaADValue<T> result(PrimalOperation(op, v, other.v));
+    T da, db;
+    if (!PartialOperation(op, v, other.v, result.v, da, db)) {
+        // Negative base, the exponent must be a constant.
+        for (int i = 0; i < other.NumDerivatives(); ++i) {
+            if (other.dvs[i] != 0) {
+                throw std::logic_error("Derivative not defined or complex.");
+            }
+        }
+        db = 0;
+    }
+    if (!dvs && !other.dvs) {
+        return result;
+    }
+    T* derivs = NewDerivatives(result, other);
+    if (dvs && other.dvs) {
+        for (int i = 0; i < width; ++i) {
+            derivs[i] = da * dvs[i] + db * other.dvs[i];
+        }
+    } else if (dvs) {
+        for (int i = 0; i < width; ++i) {
+            derivs[i] = da * dvs[i];
+        }
+    } else {
+        for (int i = 0; i < other.width; ++i) {
+            derivs[i] = db * other.dvs[i];
+        }
+    }
+    return result;
+}
+
+template <class T>
+ArenaADValue<T> ArenaADValue<T>::ADfma(
+    const ArenaADValue<T>& other, const ArenaADValue<T>& addend) const {
+    // One pass, so the product needs no buffer of its own.
+    ArenaADValue<T> result(v * other.v + addend.v);
+    const ArenaADValue<T>& first = dvs ? *this : other.dvs ? other : addend;
+    if (!first.dvs) {
+        return result;
+    }
+    T* derivs = NewDerivatives(result, first);
+    for (int i = 0; i < first.width; ++i) {
+        derivs[i] = (dvs ? dvs[i] * other.v : 0) +
+                    (other.dvs ? other.dvs[i] * v : 0) +
+                    (addend.dvs ? addend.dvs[i] : 0);
+    }
+    return result;
+}
+
+#endif /* ARENAADVALUE_H */
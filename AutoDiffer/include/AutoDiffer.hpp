@@ -6,17 +6,58 @@
 /* header files */
 #include "ADNode.hpp"
 #include "ADValue.hpp"
+#include "Arena.hpp"
+#include "ArenaADValue.hpp"
+#include "Executor.hpp"
+#include "FixedADValue.hpp"
+#include "InfixParser.hpp"
+#include "ParallelTape.hpp"
 #include "Parser.hpp"
+#include "PassManager.hpp"
+#include "Tape.hpp"
+#include "TapeDerivative.hpp"
+#include "TapeFile.hpp"
+#include "TaylorValue.hpp"
+#include "ThreadPool.hpp"
+#include "Workspace.hpp"
 
-#ifdef USE_THREAD
-#include <omp.h>
-#endif
 /* system header files */
 #ifndef DOXYGEN_IGNORE
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <thread>
+#include <unordered_map>
 #endif
 
+/**
+ * Callback of DeriveAsync, called with the index of an item of the batch and
+ * its result as soon as that item is done, on the worker thread that derived
+ * it. It must not throw.
+ */
+template <class T>
+using DeriveCallback =
+    std::function<void(int, const std::pair<Status,ADValue<T>>&)>;
+
+// Prefix of the keys under which SaveTapes stores the tapes with slot reuse
+// of the forward-only modes, so they do not clash with the tape of the same
+// equation.
+const char kForwardTapeKeyPrefix[] = "forward:";
+
+/**
+ * Order of the entries of a matrix in a flat buffer, as in BLAS and LAPACK.
+ */
+enum class MatrixLayout {
+  row_major,    // entry (i, k) of an m x n matrix is at i * n + k
+  column_major, // entry (i, k) of an m x n matrix is at k * m + i
+};
+
 /**
  * The AutoDiffer class is the main interface provided to the user. Once they 
  * have constructed an AutoDiffer object, they can set the seed variables with
@@ -29,6 +70,9 @@
  * 2. Vector of functions. In this case a vector of strings is passed in.
  * 3. Single function with vector of seeds. In this case the function is passed 
  *    in as a string, and AutoDiffer is run on each of the different seeds.
+ *
+ * The items of cases 2 and 3 run on the executor chosen with SetExecutor
+ * (serially by default), and Stats reports how the last batch ran.
  * 
  * Example usage: on f(x) = x^2 at x=1.5.
  * 
@@ -50,6 +94,133 @@ class AutoDiffer {
     // this is a single item vector.
     std::vector<std::pair<std::string, ADValue<T>>> seeds_;
 
+    // Optimized tapes keyed by equation, shared by every mode that evaluates a
+    // tape so an equation is compiled at most once per AutoDiffer.
+    std::unordered_map<std::string, Tape<T>> tapes_;
+
+    // Copies of tapes_ with slot reuse, for modes that only sweep forward.
+    std::unordered_map<std::string, Tape<T>> forward_tapes_;
+
+    // Equations whose tape turned out to be structurally identical to the
+    // tape of an earlier equation (e.g., "(y+x)" after "(x+y)"), mapped to
+    // that equation, which keys the caches for both.
+    std::unordered_map<std::string, std::string> aliases_;
+
+    // The equation of each tape in tapes_, keyed by the structural hash of
+    // its canonical form before optimization (see HashTape).
+    std::unordered_map<Hash128, std::string, Hash128Hasher> canonical_keys_;
+
+    // Partial derivative tapes keyed by equation, one per variable of the
+    // tape in tapes_, in the same order. They reuse slots.
+    std::unordered_map<std::string, std::vector<Tape<T>>> gradient_tapes_;
+
+    // Levelized copies of tapes_ keyed by equation, for DeriveParallel.
+    std::unordered_map<std::string, ParallelTape<T>> parallel_tapes_;
+
+    // Optimizations applied to every tape before it is cached.
+    PassManager<T> pass_manager_ = PassManager<T>::Default();
+
+    // Notation of the equations given to the tape based modes.
+    Syntax syntax_ = Syntax::parenthesized;
+
+    // Runs the items of the multiple function and multiple seed Derive.
+    Executor executor_;
+
+    // Statistics of the last multiple function or multiple seed Derive.
+    ExecutorStats stats_;
+
+    // Buffers of each worker of executor_ for DeriveCompiled, kept between
+    // calls so they only grow to the largest item.
+    std::vector<Workspace<T>> workspaces_;
+
+    // Derivatives of every operation of DeriveArena, reset at each call.
+    Arena arena_;
+
+    // Workers of DeriveAsync, started on first use. Shared by copies of the
+    // AutoDiffer and by the queued tasks, so destroying the AutoDiffer does
+    // not wait for its batches.
+    std::shared_ptr<ThreadPool> pool_;
+    int async_threads_ = std::max(1u, std::thread::hardware_concurrency());
+
+    /**
+     * Gets the key of an equation in the caches of tapes.
+     *
+     * @param: equation: A string representation of the equation.
+     * @returns: the earlier equation it is an alias of, or itself.
+     */
+    const std::string& CacheKey(const std::string& equation) const {
+        auto it = aliases_.find(equation);
+        return it == aliases_.end() ? equation : it->second;
+    }
+
+    /**
+     * Drops every cached tape.
+     */
+    void ClearTapes() {
+        tapes_.clear();
+        forward_tapes_.clear();
+        aliases_.clear();
+        canonical_keys_.clear();
+        gradient_tapes_.clear();
+        parallel_tapes_.clear();
+    }
+
+    /**
+     * Gets the compiled tape of an equation, compiling it on first use. Each
+     * tape is canonicalized (see Canonicalize) before it is optimized, and an
+     * equation whose canonical tape is structurally identical to that of an
+     * equation seen before shares its cache entries. Only tapes that compile
+     * successfully are cached.
+     *
+     * @param: equation: A string representation of the equation.
+     * @param: reuse_slots: whether the tape may reuse slots of dead values
+     * (see Tape::ReuseSlots). Such a tape only supports forward sweeps.
+     * @returns: a Status and a pointer to the tape. The pointer is null if
+     * the Status is not success.
+     */
+    std::pair<Status,const Tape<T>*> CompiledTape(const std::string& equation,
+                                                  bool reuse_slots = false);
+
+    /**
+     * Gets the partial derivative tapes of an equation (see GradientTapes),
+     * differentiating and optimizing them on first use.
+     *
+     * @param: equation: A string representation of the equation.
+     * @returns: a Status and a pointer to one tape per variable of the
+     * compiled tape. The pointer is null if the Status is not success.
+     */
+    std::pair<Status,const std::vector<Tape<T>>*> CompiledGradient(
+        const std::string& equation);
+
+    /**
+     * Runs a batch of independent items on the workers of DeriveAsync.
+     *
+     * @param: size: the number of items.
+     * @param: derive: called as derive(i) on a worker to derive item i. It
+     * must not touch the AutoDiffer, which may be gone by then.
+     * @param: callback: called after each item, may be empty.
+     * @returns: a future of the results of all items, in item order.
+     */
+    std::future<std::vector<std::pair<Status,ADValue<T>>>> SubmitBatch(
+        int size, std::function<std::pair<Status,ADValue<T>>(int)> derive,
+        DeriveCallback<T> callback);
+
+    /**
+     * Runs the rows of DeriveDense on the executor, each in the Workspace of
+     * its worker.
+     *
+     * @param: rows: the number of rows.
+     * @param: width: the number of derivatives of every row.
+     * @param: derive: called as derive(workspace, i, value, derivs, stride)
+     * to derive row i into the buffers, as Workspace::DeriveInto.
+     * @param: values, jacobian, codes, layout, errors: as DeriveDense.
+     */
+    void DenseRows(
+        int rows, int width,
+        const std::function<Status(Workspace<T>&, int, T&, T*, int)>& derive,
+        T* values, T* jacobian, ReturnCode* codes, MatrixLayout layout,
+        std::vector<std::pair<int,Status>>* errors);
+
   public:
     AutoDiffer() {}
 
@@ -83,6 +254,56 @@ class AutoDiffer {
             std::pair<std::string, ADValue<T>>(variable, seed_val));
     }
 
+    /**
+     * Sets the optimization pipeline run on every compiled tape and drops the
+     * tapes compiled so far. Use an empty PassManager for equations that are
+     * only evaluated a few times. The pipeline should not contain "liveness",
+     * since VJP needs every intermediate; slots are reused automatically for
+     * the forward-only modes.
+     *
+     * @param: pass_manager: the pipeline.
+     */
+    void SetPassManager(const PassManager<T>& pass_manager) {
+        pass_manager_ = pass_manager;
+        ClearTapes();
+    }
+
+    /**
+     * Sets the notation of the equations given to the modes that compile a
+     * tape (Evaluate, JVP, VJP, DeriveChunked and DeriveTaylor) and drops the
+     * tapes compiled so far. Derive always uses the parenthesized syntax.
+     *
+     * @param: syntax: the notation (e.g., Syntax::infix for "x^2 + sin(y)").
+     */
+    void SetSyntax(Syntax syntax) {
+        syntax_ = syntax;
+        ClearTapes();
+    }
+
+    /**
+     * Saves the tapes compiled so far to a tape file (see SaveTapes), keyed by
+     * equation. Loading the file with LoadTapes at the next start skips
+     * parsing and optimizing those equations. The tapes with slot reuse of
+     * the forward-only modes (e.g., DeriveCompiled and DeriveDense) are saved
+     * too, under the equation prefixed with kForwardTapeKeyPrefix.
+     *
+     * @param: path: the path of the file.
+     * @returns: an invalid_argument status if the file cannot be written.
+     */
+    Status SaveTapes(const std::string& path) const;
+
+    /**
+     * Adds the tapes of a tape file to the compiled tapes, as if each equation
+     * had been compiled. The tapes are copied out of the file, which is closed
+     * again. The file must have been saved with the same syntax, since the
+     * equations are not parsed; the current PassManager is not run on them.
+     *
+     * @param: path: the path of the file.
+     * @returns: an invalid_argument status if the file cannot be read or is
+     * not a valid tape file.
+     */
+    Status LoadTapes(const std::string& path);
+
     /**
      * Single function derive. For multiple functions use the overloaded derive
      * parameterized by a vector of strings.
@@ -120,10 +341,466 @@ class AutoDiffer {
     std::vector<std::pair<Status,ADValue<T>>> Derive(
         const std::string& equation, 
         std::vector<std::vector<std::pair<std::string, ADValue<T>>>> seeds); 
+
+    /**
+     * Sets how the multiple function and multiple seed Derive spread their
+     * items over threads. The policy can be picked at runtime, e.g., with
+     * ParseExecutorPolicy from a flag. The openmp policy runs serially
+     * unless the project is built with USE_THREAD, which Stats reports.
+     *
+     * @param: policy: the policy.
+     * @param: num_threads: the number of threads, 0 for one per hardware
+     * thread.
+     */
+    void SetExecutor(ExecutorPolicy policy, int num_threads = 0) {
+        executor_ = Executor(policy, num_threads);
+    }
+
+    /**
+     * Gets the statistics of the last multiple function or multiple seed
+     * Derive, including the backend that actually ran it.
+     *
+     * @returns: the statistics.
+     */
+    const ExecutorStats& Stats() const { return stats_; }
+
+    /**
+     * Sets the number of worker threads of DeriveAsync. Returns at once:
+     * batches submitted before keep running on the old workers, which exit
+     * once those batches are done. It may be called from a DeriveCallback.
+     *
+     * @param: num_threads: the number of workers, at least 1.
+     */
+    void SetAsyncThreads(int num_threads) {
+        async_threads_ = std::max(1, num_threads);
+        pool_.reset();
+    }
+
+    /**
+     * Asynchronous multiple function derive. The equations are queued on a
+     * pool of worker threads (see SetAsyncThreads) and the call returns at
+     * once, so the caller can do other work (e.g., I/O) meanwhile. The seeds
+     * are copied when the call is made, and the AutoDiffer may be changed or
+     * destroyed before the batch is done.
+     *
+     * @param: equations: A vector of the equations to derive.
+     * @param: callback: optional, called with the index and result of each
+     * equation as soon as it is done, from a worker thread, so results can be
+     * consumed before the whole batch is done.
+     * @returns: a future of the vector the multiple function Derive returns.
+     * If deriving an equation throws, the future rethrows the first such
+     * exception once every equation is done.
+     */
+    std::future<std::vector<std::pair<Status,ADValue<T>>>> DeriveAsync(
+        std::vector<std::string> equations,
+        DeriveCallback<T> callback = DeriveCallback<T>());
+
+    /**
+     * Asynchronous single function derive with multiple seed values (see the
+     * multiple function DeriveAsync).
+     *
+     * @param: equation: A string representation of the equation.
+     * @param: seeds: A vector of seeds at which to evaluate the derivative.
+     * @param: callback: optional, called as each seed is done.
+     * @returns: a future of the vector the multiple seed Derive returns.
+     */
+    std::future<std::vector<std::pair<Status,ADValue<T>>>> DeriveAsync(
+        const std::string& equation,
+        std::vector<std::vector<std::pair<std::string, ADValue<T>>>> seeds,
+        DeriveCallback<T> callback = DeriveCallback<T>());
+
+    /**
+     * Multiple function derive on compiled tapes. The equations are compiled
+     * (see SetSyntax) and cached on the calling thread, and then derived at
+     * the seeds on the executor (see SetExecutor). Each worker derives its
+     * items in a Workspace of its own, kept between calls, so after the first
+     * calls no memory is allocated per operation or per item besides the
+     * results, and the workers do not contend on the allocator.
+     *
+     * @param: equations: A vector of the equations to derive.
+     * @returns: a vector of a Status and ADValue pairs, as Derive.
+     */
+    std::vector<std::pair<Status,ADValue<T>>> DeriveCompiled(
+        const std::vector<std::string>& equations);
+
+    /**
+     * Single function derive with multiple seed values on a compiled tape
+     * (see the multiple function DeriveCompiled).
+     *
+     * @param: equation: A string representation of the equation.
+     * @param: seeds: A vector of seeds at which to evaluate the derivative.
+     * @returns: a vector of a Status and ADValue pairs, as Derive.
+     */
+    std::vector<std::pair<Status,ADValue<T>>> DeriveCompiled(
+        const std::string& equation,
+        const std::vector<std::vector<std::pair<std::string, ADValue<T>>>>&
+            seeds);
+
+    /**
+     * Multiple function derive on compiled tapes, at the seed values, with
+     * every derivative of the call taken from one arena. Each operation bumps
+     * a pointer instead of allocating a vector, constants carry no
+     * derivatives at all, and the arena is released in O(1) when the next
+     * call starts. The arena keeps its blocks, so repeated calls of the same
+     * size allocate only the results. Runs on the calling thread.
+     *
+     * @param: equations: A vector of the equations to derive.
+     * @returns: a vector of a Status and ADValue pairs, as Derive. Every
+     * ADValue has as many derivatives as the seeds.
+     */
+    std::vector<std::pair<Status,ADValue<T>>> DeriveArena(
+        const std::vector<std::string>& equations);
+
+    /**
+     * Gets the arena of DeriveArena, e.g., for its usage counters.
+     *
+     * @returns: the arena.
+     */
+    const Arena& GetArena() const { return arena_; }
+
+    /**
+     * Multiple function derive into dense caller provided buffers, so a
+     * batch costs no allocation per row and the Jacobian can be handed to
+     * BLAS as is. Row i is equations[i], derived at the seed values on the
+     * executor as DeriveCompiled. Only the rows that fail carry a message,
+     * reported out of line.
+     *
+     * @param: equations: A vector of the equations to derive, one per row.
+     * @param: values: receives the value of each row, equations.size()
+     * entries.
+     * @param: jacobian: receives the derivatives of each row, a matrix of
+     * equations.size() rows and one column per derivative of the seeds, in
+     * the given layout without padding.
+     * @param: codes: receives the ReturnCode of each row, equations.size()
+     * entries. The value and derivatives of a row that failed are zero. A
+     * row whose derivative is not defined (a power of a negative base with
+     * a varying exponent) fails with invalid_argument.
+     * @param: layout: the layout of jacobian.
+     * @param: errors: if not null, receives the row and Status of each row
+     * that failed, in row order.
+     * @returns: an invalid_argument status, with nothing written, if the
+     * seeds have different numbers of derivatives, success otherwise.
+     */
+    Status DeriveDense(const std::vector<std::string>& equations,
+                       T* values, T* jacobian, ReturnCode* codes,
+                       MatrixLayout layout = MatrixLayout::row_major,
+                       std::vector<std::pair<int,Status>>* errors = nullptr);
+
+    /**
+     * Single function derive with multiple seed values into dense caller
+     * provided buffers (see the multiple function DeriveDense). Row i is the
+     * equation at seeds[i].
+     *
+     * @param: equation: A string representation of the equation.
+     * @param: seeds: A vector of seeds, one per row. The Jacobian has a
+     * column per derivative of seeds[0]; a row with another number of
+     * derivatives fails with invalid_argument.
+     * @param: values, jacobian, codes, layout, errors: as the multiple
+     * function DeriveDense, with seeds.size() rows.
+     * @returns: success.
+     */
+    Status DeriveDense(
+        const std::string& equation,
+        const std::vector<std::vector<std::pair<std::string, ADValue<T>>>>&
+            seeds,
+        T* values, T* jacobian, ReturnCode* codes,
+        MatrixLayout layout = MatrixLayout::row_major,
+        std::vector<std::pair<int,Status>>* errors = nullptr);
+
+    /**
+     * Single function derive at many points into dense caller provided
+     * buffers (see the multiple function DeriveDense), for sweeps where
+     * building a seed vector per point would cost more than deriving it. The
+     * variables are named once, each point is a row of a dense matrix, and
+     * the seeds are implicit unit vectors, so row i of the Jacobian is the
+     * gradient at point i. Nothing is copied or allocated per point.
+     *
+     * @param: equation: A string representation of the equation.
+     * @param: variables: the names of the variables, in the order of the
+     * columns of points and of the Jacobian.
+     * @param: points: a num_points x variables.size() row-major matrix with
+     * the value of each variable at each point.
+     * @param: num_points: the number of points, and of rows.
+     * @param: values, jacobian, codes, layout, errors: as the multiple
+     * function DeriveDense, with num_points rows and variables.size()
+     * columns.
+     * @returns: a parse_error status, with nothing written, if the equation
+     * does not compile or uses a variable not in variables, success
+     * otherwise.
+     */
+    Status DeriveDense(
+        const std::string& equation, const std::vector<std::string>& variables,
+        const T* points, int num_points,
+        T* values, T* jacobian, ReturnCode* codes,
+        MatrixLayout layout = MatrixLayout::row_major,
+        std::vector<std::pair<int,Status>>* errors = nullptr);
+
+    /**
+     * Value-only evaluation at the seed values. Runs the compiled tape on
+     * plain T registers, so no derivative is computed or allocated no matter
+     * how wide the seed vectors are. Useful for line searches and residual
+     * checks that only need the function value.
+     *
+     * @param: equation: the equation to evaluate (e.g., "(exp(x))").
+     * @returns: a Status and value pair. If the Status is not success, then
+     * the value is zero.
+     */
+    std::pair<Status,T> Evaluate(const std::string& equation);
+
+    /**
+     * Value-only evaluation of multiple functions at the seed values.
+     *
+     * @param: equations: A vector of the equations to evaluate.
+     * @returns: a vector of a Status and value pairs, one per equation. If
+     * the Status is not success for an equation, then its value is zero.
+     */
+    std::vector<std::pair<Status,T>> Evaluate(
+        const std::vector<std::string>& equations);
+
+    /**
+     * Jacobian-vector product. Computes J*v for the Jacobian J of the
+     * equations at a point without forming J. A single directional tangent is
+     * seeded, so each operation carries one derivative instead of one per
+     * variable. The seeds set with SetSeed/SetSeedVector are not used.
+     * 
+     * @param: equations: A vector of the m equations to derive.
+     * @param: point: the n variables (name and value) to evaluate at.
+     * @param: v: the direction, with one entry per variable of point.
+     * @returns: a Status and the dense m-vector J*v. If the Status is not
+     * success, the vector should not be used.
+     */
+    std::pair<Status,std::vector<T>> JVP(
+        const std::vector<std::string>& equations,
+        const std::vector<std::pair<std::string, T>>& point,
+        const std::vector<T>& v);
+
+    /**
+     * Vector-Jacobian product. Computes w^T*J for the Jacobian J of the
+     * equations at a point with one reverse sweep per equation. The seeds set
+     * with SetSeed/SetSeedVector are not used.
+     * 
+     * @param: equations: A vector of the m equations to derive.
+     * @param: point: the n variables (name and value) to evaluate at.
+     * @param: w: the weights, with one entry per equation.
+     * @returns: a Status and the dense n-vector w^T*J, ordered as point. If
+     * the Status is not success, the vector should not be used.
+     */
+    std::pair<Status,std::vector<T>> VJP(
+        const std::vector<std::string>& equations,
+        const std::vector<std::pair<std::string, T>>& point,
+        const std::vector<T>& w);
+
+    /**
+     * Chunked forward mode. Derives each equation with respect to every
+     * variable of point, like a SetSeedVector run with unit seeds, but
+     * processes the seed directions N at a time with FixedADValue. Each
+     * equation is compiled once and the same tape is reused for every chunk,
+     * so the working set is O(ops * N) instead of O(ops * n).
+     * 
+     * @param: equations: A vector of the equations to derive.
+     * @param: point: the n variables (name and value) to evaluate at.
+     * @returns: a vector of a Status and ADValue pairs. Each ADValue holds the
+     * value and the n partials in the order of point. As with Derive, it is
+     * up to the caller to check each Status before using the ADValue.
+     */
+    template <int N = 8>
+    std::vector<std::pair<Status,ADValue<T>>> DeriveChunked(
+        const std::vector<std::string>& equations,
+        const std::vector<std::pair<std::string, T>>& point);
+
+    /**
+     * Gradients by symbolic differentiation. The first call on an equation
+     * builds a tape for each partial derivative (see DifferentiateTape), runs
+     * the PassManager on it and caches it. Every call then evaluates those
+     * tapes on plain values only, with no derivative propagation, which is
+     * fastest for hot equations of few variables. The cost of a call grows
+     * with the number of variables of the equation, as in forward mode.
+     *
+     * @param: equations: A vector of the equations to derive.
+     * @param: point: the n variables (name and value) to evaluate at.
+     * @returns: a vector of a Status and ADValue pairs. Each ADValue holds the
+     * value and the n partials in the order of point. As with Derive, it is
+     * up to the caller to check each Status before using the ADValue.
+     */
+    std::vector<std::pair<Status,ADValue<T>>> DeriveSymbolic(
+        const std::vector<std::string>& equations,
+        const std::vector<std::pair<std::string, T>>& point);
+
+    /**
+     * Higher-order directional derivatives. Evaluates the equation on
+     * TaylorValues to get the first K derivatives of t -> f(point + t*v) at
+     * t = 0 in a single pass, at O(K^2) cost per operation.
+     * 
+     * @param: equation: A string representation of the equation.
+     * @param: point: the n variables (name and value) to evaluate at.
+     * @param: v: the direction, with one entry per variable of point.
+     * @returns: a Status and a vector of K+1 entries, where entry j is the
+     * j-th directional derivative (entry 0 is the value). If the Status is
+     * not success, the vector should not be used.
+     */
+    template <int K>
+    std::pair<Status,std::vector<T>> DeriveTaylor(
+        const std::string& equation,
+        const std::vector<std::pair<std::string, T>>& point,
+        const std::vector<T>& v);
+
+    /**
+     * Gradient of a single, very large equation, with its evaluation split
+     * between threads (see ParallelTape): independent parts of the
+     * expression, e.g., the terms of a long sum, are evaluated concurrently.
+     * The gradient is propagated forward with one derivative per variable of
+     * point. Equations with few operations gain nothing from it and run on
+     * the calling thread only.
+     *
+     * @param: equation: A string representation of the equation.
+     * @param: point: the n variables (name and value) to evaluate at.
+     * @param: num_threads: the most threads to use, including the caller.
+     * @returns: a Status and an ADValue with the value and the n partials in
+     * the order of point. If the Status is not success, the ADValue should
+     * not be used.
+     */
+    std::pair<Status,ADValue<T>> DeriveParallel(
+        const std::string& equation,
+        const std::vector<std::pair<std::string, T>>& point,
+        int num_threads);
+
+    /**
+     * Derive for very wide seed vectors (see SetSeedVector), with the
+     * derivative directions split between threads. The seeds are read as in
+     * Derive, but the equation is compiled to a tape (see SetSyntax). Each
+     * thread evaluates the tape once on its own contiguous slice of the
+     * directions in a Workspace of its own, repeating the cheap primal
+     * computation, and writes the output partials of its slice directly into
+     * its part of the result, so no thread waits for another and nothing is
+     * gathered afterwards. All seeds must have the same number of
+     * derivatives.
+     *
+     * @param: equation: A string representation of the equation.
+     * @param: num_threads: the most threads to use, including the caller. No
+     * more threads are used than there are directions.
+     * @returns: a Status and an ADValue with the value and one derivative per
+     * direction of the seeds. If the Status is not success, the ADValue
+     * should not be used.
+     */
+    std::pair<Status,ADValue<T>> DeriveSliced(const std::string& equation,
+                                              int num_threads);
 };
 
 
 /* Implementation AutoDiffer (single Threaded) */
+template <class T>
+std::pair<Status,const Tape<T>*> AutoDiffer<T>::CompiledTape(
+    const std::string& equation, bool reuse_slots) {
+    std::unordered_map<std::string, Tape<T>>& cache =
+        reuse_slots ? forward_tapes_ : tapes_;
+    auto it = cache.find(CacheKey(equation));
+    if (it != cache.end()) {
+        return std::pair<Status,const Tape<T>*>(Status(), &it->second);
+    }
+    Tape<T> tape;
+    Status status;
+    if (reuse_slots) {
+        // Start from the shared tape rather than compiling again.
+        std::pair<Status,const Tape<T>*> compiled = CompiledTape(equation);
+        status = compiled.first;
+        if (status.code == ReturnCode::success) {
+            it = cache.find(CacheKey(equation));
+            if (it != cache.end()) {
+                return std::pair<Status,const Tape<T>*>(status, &it->second);
+            }
+            tape = *compiled.second;
+            tape.ReuseSlots();
+        }
+    } else {
+        if (syntax_ == Syntax::infix) {
+            status = InfixParser<T>(equation).Compile(tape);
+        } else {
+            status = tape.Compile(equation);
+        }
+        if (status.code == ReturnCode::success) {
+            Canonicalize(tape);
+            Hash128 hash = HashTape(tape);
+            auto canonical = canonical_keys_.find(hash);
+            if (canonical != canonical_keys_.end()) {
+                // A duplicate in disguise, share the tape compiled before.
+                aliases_[equation] = canonical->second;
+                return CompiledTape(equation);
+            }
+            canonical_keys_[hash] = equation;
+            pass_manager_.Run(tape);
+        }
+    }
+    if (status.code != ReturnCode::success) {
+        return std::pair<Status,const Tape<T>*>(status, nullptr);
+    }
+    // Elements of an unordered_map are not moved by a rehash, so the pointer
+    // stays valid while the AutoDiffer lives.
+    it = cache.emplace(CacheKey(equation), std::move(tape)).first;
+    return std::pair<Status,const Tape<T>*>(status, &it->second);
+}
+
+template <class T>
+std::pair<Status,const std::vector<Tape<T>>*> AutoDiffer<T>::CompiledGradient(
+    const std::string& equation) {
+    std::pair<Status,const Tape<T>*> compiled = CompiledTape(equation);
+    if (compiled.first.code != ReturnCode::success) {
+        return std::pair<Status,const std::vector<Tape<T>>*>(compiled.first,
+                                                             nullptr);
+    }
+    auto it = gradient_tapes_.find(CacheKey(equation));
+    if (it != gradient_tapes_.end()) {
+        return std::pair<Status,const std::vector<Tape<T>>*>(Status(),
+                                                             &it->second);
+    }
+    std::vector<Tape<T>> partials;
+    GradientTapes(*compiled.second, partials);
+    for (Tape<T>& partial : partials) {
+        pass_manager_.Run(partial);
+        partial.ReuseSlots();
+    }
+    it = gradient_tapes_.emplace(CacheKey(equation),
+                                 std::move(partials)).first;
+    return std::pair<Status,const std::vector<Tape<T>>*>(Status(),
+                                                         &it->second);
+}
+
+template <class T>
+Status AutoDiffer<T>::SaveTapes(const std::string& path) const {
+    std::vector<std::pair<std::string, const Tape<T>*>> tapes;
+    for (const auto& entry : tapes_) {
+        tapes.emplace_back(entry.first, &entry.second);
+    }
+    for (const auto& entry : forward_tapes_) {
+        tapes.emplace_back(kForwardTapeKeyPrefix + entry.first,
+                           &entry.second);
+    }
+    return ::SaveTapes<T>(path, tapes);
+}
+
+template <class T>
+Status AutoDiffer<T>::LoadTapes(const std::string& path) {
+    TapeFile<T> file;
+    Status status = file.Open(path);
+    if (status.code != ReturnCode::success) {
+        return status;
+    }
+    for (int i = 0; i < file.NumTapes(); ++i) {
+        const MappedTape<T>& mapped = file.Get(i);
+        // Tapes with slot reuse can only serve the forward-only modes.
+        std::string key = mapped.Key().ToString();
+        if (!mapped.View().ReusesSlots()) {
+            mapped.CopyTo(tapes_[key]);
+            continue;
+        }
+        size_t prefix = sizeof(kForwardTapeKeyPrefix) - 1;
+        if (key.compare(0, prefix, kForwardTapeKeyPrefix) == 0) {
+            key.erase(0, prefix);
+        }
+        mapped.CopyTo(forward_tapes_[key]);
+    }
+    return status;
+}
+
 template <class T>
 std::pair<Status,ADValue<T>> AutoDiffer<T>::Derive(const std::string& equation) {
     // Create a parser with the equation and initialize it.
@@ -139,8 +816,8 @@ template <class T>
 std::vector<std::pair<Status,ADValue<T>>> AutoDiffer<T>::Derive(
     std::vector<std::string> equations) {
     // Initialize a return value vector with same size as number of eqs.
-    std::vector<std::pair<Status,ADValue<T>>> return_values(equations.size()); 
-    for (int i = 0; i < equations.size(); i++) {
+    std::vector<std::pair<Status,ADValue<T>>> return_values(equations.size());
+    stats_ = executor_.Run(equations.size(), [&](int i) {
         // Create a parser for each equation.
         Parser<T> parser(equations[i]);
         Status status = parser.Init(seeds_);
@@ -150,7 +827,7 @@ std::vector<std::pair<Status,ADValue<T>>> AutoDiffer<T>::Derive(
         } else {
             return_values[i] = parser.Run();
         }
-    }
+    });
     return return_values; 
 } 
 
@@ -160,8 +837,8 @@ std::vector<std::pair<Status,ADValue<T>>> AutoDiffer<T>::Derive(
     const std::string& equation, 
     std::vector<std::vector<std::pair<std::string, ADValue<T>>>> seeds) {
     // Initialize a return value vector with same size as number of seeds.
-    std::vector<std::pair<Status,ADValue<T>>> return_values(seeds.size()); 
-    for (int i = 0; i < seeds.size(); i++) {
+    std::vector<std::pair<Status,ADValue<T>>> return_values(seeds.size());
+    stats_ = executor_.Run(seeds.size(), [&](int i) {
         Parser<T> parser(equation);
         // Initialized each parser with the same equation and the i^th seed vec.
         Status status = parser.Init(seeds[i]);
@@ -171,182 +848,780 @@ std::vector<std::pair<Status,ADValue<T>>> AutoDiffer<T>::Derive(
         } else {
             return_values[i] = parser.Run();
         }
-    }
+    });
     return return_values; 
 }
 
 
-/**
- * The AutoDifferOpenMp class inherits from the AutoDiffer class and provides
- * some the multiple function and multiple seed versions of the Derive function
- * from the AutoDiffer, but with OpenMp versions of each Derive call.
- * In order to use this class, the entire project has to be compiled with the 
- * "--thread" flag. So run`bash config.sh --thread` at the top level directory 
- * if you have not already.
- */
 template <class T>
-class AutoDifferOpenMp : public AutoDiffer<T> {
-  private:
-    // How many threads to run with openmp.
-    int num_threads_;
+std::pair<Status,T> AutoDiffer<T>::Evaluate(const std::string& equation) {
+    std::pair<Status,const Tape<T>*> compiled = CompiledTape(equation, true);
+    if (compiled.first.code != ReturnCode::success) {
+        return std::pair<Status,T>(compiled.first, 0);
+    }
+    std::vector<std::string> names;
+    for (auto& seed : seeds_) {
+        names.push_back(seed.first);
+    }
+    std::vector<int> index;
+    Status status = compiled.second->ResolveVariables(names, index);
+    if (status.code != ReturnCode::success) {
+        return std::pair<Status,T>(status, 0);
+    }
+    // Only the values of the seeds are used, never their derivatives.
+    std::vector<T> slots;
+    for (int j : index) {
+        slots.push_back(seeds_[j].second.val());
+    }
+    return std::pair<Status,T>(status, compiled.second->Primal(slots));
+}
 
-  public:
-    // Constructor initializes the number of threads to be used.
-    AutoDifferOpenMp(int num_threads) : num_threads_(num_threads) {}
+template <class T>
+std::vector<std::pair<Status,T>> AutoDiffer<T>::Evaluate(
+    const std::vector<std::string>& equations) {
+    std::vector<std::pair<Status,T>> return_values;
+    for (const std::string& equation : equations) {
+        return_values.push_back(Evaluate(equation));
+    }
+    return return_values;
+}
 
-    // Same as the multiple equation derive of AutoDiffer, but with openmp 
-    // multithreading.
-    std::vector<std::pair<Status,ADValue<T>>> DeriveOpenMp(
-        std::vector<std::string> equation);
-    
-    // Same as the multiple seed derive of the AutoDiffer, but with openmp
-    // multithreading.
-    std::vector<std::pair<Status,ADValue<T>>> DeriveOpenMp(
-        const std::string& equation, 
-        std::vector<std::vector<std::pair<std::string, ADValue<T>>>> seeds); 
-};
 
+template <class T>
+std::pair<Status,std::vector<T>> AutoDiffer<T>::JVP(
+    const std::vector<std::string>& equations,
+    const std::vector<std::pair<std::string, T>>& point,
+    const std::vector<T>& v) {
+    Status status;
+    std::vector<T> products(equations.size(), 0);
+    if (v.size() != point.size()) {
+        status.code = ReturnCode::invalid_argument;
+        status.message = "Direction size does not match number of variables";
+        return std::pair<Status,std::vector<T>>(status, products);
+    }
+    std::vector<std::string> names;
+    for (auto& variable : point) {
+        names.push_back(variable.first);
+    }
+    for (int i = 0; i < equations.size(); i++) {
+        std::pair<Status,const Tape<T>*> compiled =
+            CompiledTape(equations[i], true);
+        status = compiled.first;
+        std::vector<int> index;
+        if (status.code == ReturnCode::success) {
+            status = compiled.second->ResolveVariables(names, index);
+        }
+        if (status.code != ReturnCode::success) {
+            return std::pair<Status,std::vector<T>>(status, products);
+        }
+        const Tape<T>& tape = *compiled.second;
+        // Seed each variable with its component of the direction.
+        std::vector<ADValue<T>> slots;
+        for (int j : index) {
+            slots.push_back(ADValue<T>(point[j].second, v[j]));
+        }
+        ADValue<T> result = tape.Forward(
+            slots, [](T c) { return ADValue<T>(c, 0); });
+        products[i] = result.dval(0);
+    }
+    return std::pair<Status,std::vector<T>>(status, products);
+}
 
 template <class T>
-std::vector<std::pair<Status,ADValue<T>>> AutoDifferOpenMp<T>::DeriveOpenMp(
-    std::vector<std::string> equations) {
-    #ifdef USE_THREAD
-        // Set the number of theads.
-        omp_set_num_threads(num_threads_);
-    #endif
-    std::vector<std::pair<Status,ADValue<T>>> return_values(equations.size()); 
-    #pragma omp parallel for
-    for (int i = 0; i < equations.size(); i++) { 
-        #ifdef USE_THREAD
-            // Uncomment this line to verify if OpenMP is working
-            // Should print out a number more than 1 
-            // std::cout << "*** num_threads:" <<omp_get_num_threads()<< std::endl;
-        #endif
-        Parser<T> parser(equations[i]);
-        Status status = parser.Init(this->seeds_);
+std::pair<Status,std::vector<T>> AutoDiffer<T>::VJP(
+    const std::vector<std::string>& equations,
+    const std::vector<std::pair<std::string, T>>& point,
+    const std::vector<T>& w) {
+    Status status;
+    std::vector<T> products(point.size(), 0);
+    if (w.size() != equations.size()) {
+        status.code = ReturnCode::invalid_argument;
+        status.message = "Weight size does not match number of equations";
+        return std::pair<Status,std::vector<T>>(status, products);
+    }
+    std::vector<std::string> names;
+    for (auto& variable : point) {
+        names.push_back(variable.first);
+    }
+    std::vector<T> slots;
+    std::vector<T> adjoints;
+    for (int i = 0; i < equations.size(); i++) {
+        std::pair<Status,const Tape<T>*> compiled = CompiledTape(equations[i]);
+        status = compiled.first;
+        std::vector<int> index;
+        if (status.code == ReturnCode::success) {
+            status = compiled.second->ResolveVariables(names, index);
+        }
+        if (status.code != ReturnCode::success) {
+            return std::pair<Status,std::vector<T>>(status, products);
+        }
+        const Tape<T>& tape = *compiled.second;
+        // Forward for the values, then one reverse sweep seeded with w[i].
+        slots.clear();
+        for (int j : index) {
+            slots.push_back(point[j].second);
+        }
+        tape.Primal(slots);
+        tape.Adjoint(slots, w[i], adjoints);
+        for (int j = 0; j < index.size(); j++) {
+            products[index[j]] += adjoints[j];
+        }
+    }
+    return std::pair<Status,std::vector<T>>(status, products);
+}
+
+
+template <class T>
+template <int N>
+std::vector<std::pair<Status,ADValue<T>>> AutoDiffer<T>::DeriveChunked(
+    const std::vector<std::string>& equations,
+    const std::vector<std::pair<std::string, T>>& point) {
+    std::vector<std::pair<Status,ADValue<T>>> return_values(equations.size());
+    std::vector<std::string> names;
+    for (auto& variable : point) {
+        names.push_back(variable.first);
+    }
+    int n = point.size();
+    // Register file reused by every chunk of every equation.
+    std::vector<FixedADValue<T, N>> slots;
+    for (int i = 0; i < equations.size(); i++) {
+        std::pair<Status,const Tape<T>*> compiled =
+            CompiledTape(equations[i], true);
+        Status status = compiled.first;
+        std::vector<int> index;
+        if (status.code == ReturnCode::success) {
+            status = compiled.second->ResolveVariables(names, index);
+        }
         if (status.code != ReturnCode::success) {
             return_values[i] = std::pair<Status, ADValue<T>>(
                 status, ADValue<T>(0,0));
-        } else {
-            return_values[i] = parser.Run();
+            continue;
+        }
+        const Tape<T>& tape = *compiled.second;
+        T value = 0;
+        std::vector<T> derivs(n, 0);
+        // Always run at least one chunk to get the value.
+        for (int start = 0; start == 0 || start < n; start += N) {
+            // Seed the variables that fall into this chunk of directions.
+            bool used = false;
+            slots.clear();
+            for (int j : index) {
+                FixedADValue<T, N> seed(point[j].second);
+                if (j >= start && j < start + N) {
+                    seed.set_dval(j - start, 1);
+                    used = true;
+                }
+                slots.push_back(seed);
+            }
+            // The partials of a chunk without any variable of the tape are 0.
+            if (!used && start > 0) {
+                continue;
+            }
+            FixedADValue<T, N> result = tape.Forward(
+                slots, [](T c) { return FixedADValue<T, N>(c); });
+            value = result.val();
+            for (int k = start; k < n && k < start + N; ++k) {
+                derivs[k] = result.dval(k - start);
+            }
         }
+        return_values[i] = std::pair<Status, ADValue<T>>(
+            status, ADValue<T>(value, derivs));
     }
-    return return_values; 
-} 
+    return return_values;
+}
+
 
 template <class T>
-std::vector<std::pair<Status,ADValue<T>>> AutoDifferOpenMp<T>::DeriveOpenMp(
-    const std::string& equation, 
-    std::vector<std::vector<std::pair<std::string, ADValue<T>>>> seeds) {
-    #ifdef USE_THREAD
-        // Set the number of theads.
-        omp_set_num_threads(num_threads_);
-    #endif
-    std::vector<std::pair<Status,ADValue<T>>> return_values(seeds.size()); 
-    #pragma omp parallel for
-    for (int i = 0; i < seeds.size(); i++) {
-        #ifdef USE_THREAD
-            // Uncomment this line to verify if OpenMP is working
-            // Should print out a number more than 1 
-            // std::cout << "*** num_threads:" <<omp_get_num_threads()<< std::endl;
-        #endif
-        Parser<T> parser(equation);
-        Status status = parser.Init(seeds[i]);
+std::vector<std::pair<Status,ADValue<T>>> AutoDiffer<T>::DeriveSymbolic(
+    const std::vector<std::string>& equations,
+    const std::vector<std::pair<std::string, T>>& point) {
+    std::vector<std::pair<Status,ADValue<T>>> return_values(equations.size());
+    std::vector<std::string> names;
+    for (auto& variable : point) {
+        names.push_back(variable.first);
+    }
+    // Values of the variables of the current tape, and its slots.
+    std::vector<T> values;
+    std::vector<T> slots;
+    for (int i = 0; i < equations.size(); i++) {
+        std::pair<Status,const Tape<T>*> compiled =
+            CompiledTape(equations[i], true);
+        Status status = compiled.first;
+        std::pair<Status,const std::vector<Tape<T>>*> gradient;
+        if (status.code == ReturnCode::success) {
+            gradient = CompiledGradient(equations[i]);
+            status = gradient.first;
+        }
+        std::vector<int> index;
+        if (status.code == ReturnCode::success) {
+            status = compiled.second->ResolveVariables(names, index);
+        }
         if (status.code != ReturnCode::success) {
             return_values[i] = std::pair<Status, ADValue<T>>(
                 status, ADValue<T>(0,0));
-        } else {
-            return_values[i] = parser.Run();
+            continue;
         }
+        values.clear();
+        for (int j : index) {
+            values.push_back(point[j].second);
+        }
+        slots = values;
+        T value = compiled.second->Primal(slots);
+        // Partials w.r.t. variables of point the tape does not read are 0.
+        std::vector<T> derivs(point.size(), 0);
+        const std::vector<Tape<T>>& partials = *gradient.second;
+        for (int k = 0; k < partials.size(); ++k) {
+            slots = values;
+            derivs[index[k]] = partials[k].Primal(slots);
+        }
+        return_values[i] = std::pair<Status, ADValue<T>>(
+            status, ADValue<T>(value, derivs));
     }
-    return return_values; 
-} 
-
+    return return_values;
+}
 
-/**
- * The AutoDifferStdThread class inherits from the AutoDiffer class and provides
- * some the multiple function and multiple seed versions of the Derive function
- * from the AutoDiffer, but with std::thread versions of each Derive call. 
- */
 template <class T>
-class AutoDifferStdThread : public AutoDiffer<T> {
-  public:
-    AutoDifferStdThread() {}
+template <int K>
+std::pair<Status,std::vector<T>> AutoDiffer<T>::DeriveTaylor(
+    const std::string& equation,
+    const std::vector<std::pair<std::string, T>>& point,
+    const std::vector<T>& v) {
+    Status status;
+    std::vector<T> derivs(K + 1, 0);
+    if (v.size() != point.size()) {
+        status.code = ReturnCode::invalid_argument;
+        status.message = "Direction size does not match number of variables";
+        return std::pair<Status,std::vector<T>>(status, derivs);
+    }
+    std::vector<std::string> names;
+    for (auto& variable : point) {
+        names.push_back(variable.first);
+    }
+    std::pair<Status,const Tape<T>*> compiled = CompiledTape(equation, true);
+    status = compiled.first;
+    std::vector<int> index;
+    if (status.code == ReturnCode::success) {
+        status = compiled.second->ResolveVariables(names, index);
+    }
+    if (status.code != ReturnCode::success) {
+        return std::pair<Status,std::vector<T>>(status, derivs);
+    }
+    const Tape<T>& tape = *compiled.second;
+    // Each variable moves linearly along the direction, x + t*v.
+    std::vector<TaylorValue<T, K>> slots;
+    for (int j : index) {
+        slots.push_back(TaylorValue<T, K>(point[j].second, v[j]));
+    }
+    TaylorValue<T, K> result = tape.Forward(
+        slots, [](T c) { return TaylorValue<T, K>(c); });
+    for (int j = 0; j <= K; ++j) {
+        derivs[j] = result.derivative(j);
+    }
+    return std::pair<Status,std::vector<T>>(status, derivs);
+}
 
-    // Same as the multiple equation derive of AutoDiffer, but with std::thread 
-    // multithreading. A new thread will be created for each equation.
-    std::vector<std::pair<Status,ADValue<T>>> DeriveStdThread(
-        std::vector<std::string> equation);
-    
-    // Same as the multiple seed derive of the AutoDiffer, but with std::thread
-    // multithreading. A new thread will be created for each seed.
-    std::vector<std::pair<Status,ADValue<T>>> DeriveStdThread(
-        const std::string& equation, 
-        std::vector<std::vector<std::pair<std::string, ADValue<T>>>> seeds); 
-};
+template <class T>
+std::pair<Status,ADValue<T>> AutoDiffer<T>::DeriveParallel(
+    const std::string& equation,
+    const std::vector<std::pair<std::string, T>>& point, int num_threads) {
+    std::vector<std::string> names;
+    for (auto& variable : point) {
+        names.push_back(variable.first);
+    }
+    std::pair<Status,const Tape<T>*> compiled = CompiledTape(equation);
+    Status status = compiled.first;
+    std::vector<int> index;
+    if (status.code == ReturnCode::success) {
+        status = compiled.second->ResolveVariables(names, index);
+    }
+    if (status.code != ReturnCode::success) {
+        return std::pair<Status,ADValue<T>>(status, ADValue<T>(0,0));
+    }
+    auto it = parallel_tapes_.find(CacheKey(equation));
+    if (it == parallel_tapes_.end()) {
+        it = parallel_tapes_.emplace(CacheKey(equation),
+                                     ParallelTape<T>(*compiled.second)).first;
+    }
+    int n = point.size();
+    std::vector<ADValue<T>> slots;
+    for (int j : index) {
+        std::vector<T> seed(n, 0);
+        seed[j] = 1;
+        slots.push_back(ADValue<T>(point[j].second, seed));
+    }
+    ADValue<T> result = it->second.Forward(slots, [n](T c) {
+        return ADValue<T>(c, std::vector<T>(n, 0));
+    }, num_threads);
+    return std::pair<Status,ADValue<T>>(status, result);
+}
 
-// Function to handle a single threads worth of work. Everything passed in by
-// reference to allow it to be updated.
 template <class T>
-void SingleThreadWork(
-    int idx, const std::string& eq, 
-    std::vector<std::pair<Status,ADValue<T>>>& return_vals,
-    const std::vector<std::pair<std::string, ADValue<T>>>& seeds) {
-    
-    // Create parser.
-    Parser<T> parser(eq);
-    Status status = parser.Init(seeds);
+std::pair<Status,ADValue<T>> AutoDiffer<T>::DeriveSliced(
+    const std::string& equation, int num_threads) {
+    std::vector<std::string> names;
+    for (auto& seed : seeds_) {
+        names.push_back(seed.first);
+    }
+    int width = seeds_.empty() ? 0 : seeds_[0].second.dvals().size();
+    Status status;
+    for (auto& seed : seeds_) {
+        if (seed.second.dvals().size() != width) {
+            status.code = ReturnCode::invalid_argument;
+            status.message = "Seeds have different numbers of derivatives";
+            return std::pair<Status,ADValue<T>>(status, ADValue<T>(0,0));
+        }
+    }
+    // Compiled on this thread, the workers only read the tape.
+    std::pair<Status,const Tape<T>*> compiled = CompiledTape(equation, true);
+    status = compiled.first;
+    std::vector<int> index;
+    if (status.code == ReturnCode::success) {
+        status = compiled.second->ResolveVariables(names, index);
+    }
     if (status.code != ReturnCode::success) {
-            return_vals[idx] = std::pair<Status, ADValue<T>>(
-                status, ADValue<T>(0,0));
-    } else {
-        return_vals[idx] = parser.Run();
+        return std::pair<Status,ADValue<T>>(status, ADValue<T>(0,0));
+    }
+    const Tape<T>& tape = *compiled.second;
+    int num_slices = std::max(1, std::min(num_threads, width));
+    T value = 0;
+    std::vector<T> derivs(width, 0);
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    auto work = [&](int slice) {
+        int begin = static_cast<long long>(width) * slice / num_slices;
+        int end = static_cast<long long>(width) * (slice + 1) / num_slices;
+        try {
+            std::vector<std::pair<std::string, ADValue<T>>> slice_seeds;
+            for (auto& seed : seeds_) {
+                const std::vector<T>& dvals = seed.second.dvals();
+                slice_seeds.push_back(std::make_pair(seed.first,
+                    ADValue<T>(seed.second.val(),
+                               std::vector<T>(dvals.begin() + begin,
+                                              dvals.begin() + end))));
+            }
+            // The output derivatives of the slice land in the result itself.
+            Workspace<T> workspace;
+            T slice_value;
+            workspace.DeriveInto(tape, slice_seeds, slice_value,
+                                 derivs.data() + begin, 1);
+            if (slice == 0) {
+                value = slice_value;
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int slice = 1; slice < num_slices; ++slice) {
+        threads.push_back(std::thread(work, slice));
+    }
+    work(0);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
     }
+    return std::pair<Status,ADValue<T>>(status,
+                                        ADValue<T>(value, std::move(derivs)));
 }
 
 template <class T>
-std::vector<std::pair<Status,ADValue<T>>> AutoDifferStdThread<T>::DeriveStdThread(
-    std::vector<std::string> equations) {
-    // Initialize vector of return values.
+std::future<std::vector<std::pair<Status,ADValue<T>>>>
+AutoDiffer<T>::SubmitBatch(
+    int size, std::function<std::pair<Status,ADValue<T>>(int)> derive,
+    DeriveCallback<T> callback) {
+    // State shared by the tasks of a batch. The last task to finish
+    // fulfills the promise.
+    struct Batch {
+        std::vector<std::pair<Status,ADValue<T>>> results;
+        std::promise<std::vector<std::pair<Status,ADValue<T>>>> promise;
+        std::atomic<int> remaining;
+        std::mutex error_mutex;
+        std::exception_ptr error;
+    };
+    std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+    batch->results.resize(size);
+    batch->remaining = size;
+    std::future<std::vector<std::pair<Status,ADValue<T>>>> future =
+        batch->promise.get_future();
+    if (size == 0) {
+        batch->promise.set_value(std::move(batch->results));
+        return future;
+    }
+    if (!pool_) {
+        pool_ = std::make_shared<ThreadPool>(async_threads_);
+    }
+    // Each task keeps its pool alive, so replacing or dropping pool_ never
+    // waits for earlier batches; their last task releases the pool. pool_
+    // is not read again, as a callback may already be replacing it.
+    std::shared_ptr<ThreadPool> pool = pool_;
+    for (int i = 0; i < size; i++) {
+        pool->Submit([batch, derive, callback, i, pool] {
+            try {
+                batch->results[i] = derive(i);
+                if (callback) {
+                    callback(i, batch->results[i]);
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(batch->error_mutex);
+                if (!batch->error) {
+                    batch->error = std::current_exception();
+                }
+            }
+            if (--batch->remaining == 0) {
+                if (batch->error) {
+                    batch->promise.set_exception(batch->error);
+                } else {
+                    batch->promise.set_value(std::move(batch->results));
+                }
+            }
+        });
+    }
+    return future;
+}
+
+template <class T>
+std::future<std::vector<std::pair<Status,ADValue<T>>>>
+AutoDiffer<T>::DeriveAsync(std::vector<std::string> equations,
+                           DeriveCallback<T> callback) {
+    // Copies owned by the tasks, shared by every item of the batch.
+    std::shared_ptr<const std::vector<std::string>> shared_equations =
+        std::make_shared<const std::vector<std::string>>(
+            std::move(equations));
+    std::shared_ptr<const std::vector<std::pair<std::string, ADValue<T>>>>
+        seeds = std::make_shared<
+            const std::vector<std::pair<std::string, ADValue<T>>>>(seeds_);
+    return SubmitBatch(shared_equations->size(),
+                       [shared_equations, seeds](int i) {
+        Parser<T> parser((*shared_equations)[i]);
+        Status status = parser.Init(*seeds);
+        if (status.code != ReturnCode::success) {
+            return std::pair<Status, ADValue<T>>(status, ADValue<T>(0,0));
+        }
+        return parser.Run();
+    }, callback);
+}
+
+template <class T>
+std::future<std::vector<std::pair<Status,ADValue<T>>>>
+AutoDiffer<T>::DeriveAsync(
+    const std::string& equation,
+    std::vector<std::vector<std::pair<std::string, ADValue<T>>>> seeds,
+    DeriveCallback<T> callback) {
+    std::shared_ptr<const std::vector<
+        std::vector<std::pair<std::string, ADValue<T>>>>> shared_seeds =
+        std::make_shared<const std::vector<
+            std::vector<std::pair<std::string, ADValue<T>>>>>(
+                std::move(seeds));
+    return SubmitBatch(shared_seeds->size(), [equation, shared_seeds](int i) {
+        Parser<T> parser(equation);
+        Status status = parser.Init((*shared_seeds)[i]);
+        if (status.code != ReturnCode::success) {
+            return std::pair<Status, ADValue<T>>(status, ADValue<T>(0,0));
+        }
+        return parser.Run();
+    }, callback);
+}
+
+template <class T>
+std::vector<std::pair<Status,ADValue<T>>> AutoDiffer<T>::DeriveCompiled(
+    const std::vector<std::string>& equations) {
+    // The caches are not thread safe, so every tape is compiled up front.
+    std::vector<std::pair<Status,const Tape<T>*>> compiled;
+    for (const std::string& equation : equations) {
+        compiled.push_back(CompiledTape(equation, true));
+    }
+    if (workspaces_.size() < executor_.NumThreads()) {
+        workspaces_.resize(executor_.NumThreads());
+    }
     std::vector<std::pair<Status,ADValue<T>>> return_values(equations.size());
-    
-    // Thread vector.
-    std::vector<std::thread> thread_vec;
+    stats_ = executor_.RunWithWorkers(equations.size(),
+                                      [&](int i, int worker) {
+        if (compiled[i].first.code != ReturnCode::success) {
+            return_values[i] = std::pair<Status, ADValue<T>>(
+                compiled[i].first, ADValue<T>(0,0));
+        } else {
+            return_values[i] =
+                workspaces_[worker].Derive(*compiled[i].second, seeds_);
+        }
+    });
+    return return_values;
+}
+
+template <class T>
+std::vector<std::pair<Status,ADValue<T>>> AutoDiffer<T>::DeriveCompiled(
+    const std::string& equation,
+    const std::vector<std::vector<std::pair<std::string, ADValue<T>>>>&
+        seeds) {
+    std::vector<std::pair<Status,ADValue<T>>> return_values(seeds.size());
+    std::pair<Status,const Tape<T>*> compiled = CompiledTape(equation, true);
+    if (compiled.first.code != ReturnCode::success) {
+        for (auto& return_value : return_values) {
+            return_value = std::pair<Status, ADValue<T>>(compiled.first,
+                                                         ADValue<T>(0,0));
+        }
+        return return_values;
+    }
+    if (workspaces_.size() < executor_.NumThreads()) {
+        workspaces_.resize(executor_.NumThreads());
+    }
+    stats_ = executor_.RunWithWorkers(seeds.size(), [&](int i, int worker) {
+        return_values[i] =
+            workspaces_[worker].Derive(*compiled.second, seeds[i]);
+    });
+    return return_values;
+}
+
+template <class T>
+std::vector<std::pair<Status,ADValue<T>>> AutoDiffer<T>::DeriveArena(
+    const std::vector<std::string>& equations) {
+    std::vector<std::pair<Status,ADValue<T>>> return_values(
+        equations.size(),
+        std::pair<Status,ADValue<T>>(Status(), ADValue<T>(0,0)));
+    std::vector<std::string> names;
+    for (auto& seed : seeds_) {
+        names.push_back(seed.first);
+    }
+    int width = seeds_.empty() ? 0 : seeds_[0].second.dvals().size();
+    for (auto& seed : seeds_) {
+        if (seed.second.dvals().size() != width) {
+            Status status;
+            status.code = ReturnCode::invalid_argument;
+            status.message = "Seeds have different numbers of derivatives";
+            for (auto& return_value : return_values) {
+                return_value.first = status;
+            }
+            return return_values;
+        }
+    }
+    // Values of the last call are not referenced anymore.
+    arena_.Reset();
+    std::vector<ArenaADValue<T>> seeds;
+    for (auto& seed : seeds_) {
+        seeds.push_back(ArenaADValue<T>(seed.second.val(),
+                                        seed.second.dvals(), arena_));
+    }
+    std::vector<ArenaADValue<T>> slots;
     for (int i = 0; i < equations.size(); i++) {
-        // Construct a thread with SingleThreadWork.
-        thread_vec.push_back(std::thread(
-            SingleThreadWork<T>, i, std::ref(equations[i]), 
-            std::ref(return_values), std::ref(this->seeds_)));
+        std::pair<Status,const Tape<T>*> compiled =
+            CompiledTape(equations[i], true);
+        Status status = compiled.first;
+        std::vector<int> index;
+        if (status.code == ReturnCode::success) {
+            status = compiled.second->ResolveVariables(names, index);
+        }
+        return_values[i].first = status;
+        if (status.code != ReturnCode::success) {
+            continue;
+        }
+        slots.clear();
+        for (int j : index) {
+            slots.push_back(seeds[j]);
+        }
+        ArenaADValue<T> result = compiled.second->Forward(
+            slots, [](T c) { return ArenaADValue<T>(c); });
+        return_values[i].second =
+            ADValue<T>(result.val(), result.dvals(width));
     }
-    // Join all threads.
-    for(auto& t: thread_vec) {
-        t.join();
+    return return_values;
+}
+
+template <class T>
+void AutoDiffer<T>::DenseRows(
+    int rows, int width,
+    const std::function<Status(Workspace<T>&, int, T&, T*, int)>& derive,
+    T* values, T* jacobian, ReturnCode* codes, MatrixLayout layout,
+    std::vector<std::pair<int,Status>>* errors) {
+    if (workspaces_.size() < executor_.NumThreads()) {
+        workspaces_.resize(executor_.NumThreads());
     }
-    return return_values; 
-} 
+    std::mutex error_mutex;
+    if (errors) {
+        errors->clear();
+    }
+    stats_ = executor_.RunWithWorkers(rows, [&](int i, int worker) {
+        bool row_major = layout == MatrixLayout::row_major;
+        T* derivs = jacobian + (row_major ? static_cast<size_t>(i) * width : i);
+        int stride = row_major ? 1 : rows;
+        Status status;
+        try {
+            status = derive(workspaces_[worker], i, values[i], derivs,
+                            stride);
+        } catch (const std::logic_error& e) {
+            // An undefined derivative fails its row only.
+            status.code = ReturnCode::invalid_argument;
+            status.message = e.what();
+        }
+        codes[i] = status.code;
+        if (status.code != ReturnCode::success) {
+            values[i] = 0;
+            for (int k = 0; k < width; ++k) {
+                derivs[static_cast<size_t>(k) * stride] = 0;
+            }
+            if (errors) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                errors->push_back(std::pair<int,Status>(i, status));
+            }
+        }
+    });
+    if (errors) {
+        std::sort(errors->begin(), errors->end(),
+                  [](const std::pair<int,Status>& a,
+                     const std::pair<int,Status>& b) {
+            return a.first < b.first;
+        });
+    }
+}
 
 template <class T>
-std::vector<std::pair<Status,ADValue<T>>> AutoDifferStdThread<T>::DeriveStdThread(
-    const std::string& equation, 
-    std::vector<std::vector<std::pair<std::string, ADValue<T>>>> seeds) {
-    
-    // Initialize vector of return values.
-    std::vector<std::pair<Status,ADValue<T>>> return_values(seeds.size());
-    
-    // Thread vector.
-    std::vector<std::thread> thread_vec;
-    for (int i = 0; i < seeds.size(); i++) {
-        // Construct a thread with SingleThreadWork.
-        thread_vec.push_back(std::thread(
-            SingleThreadWork<T>, i, std::ref(equation), 
-            std::ref(return_values), std::ref(seeds[i])));
-    }
-    // Join all threads.
-    for(auto& t: thread_vec) {
-        t.join();
+Status AutoDiffer<T>::DeriveDense(
+    const std::vector<std::string>& equations, T* values, T* jacobian,
+    ReturnCode* codes, MatrixLayout layout,
+    std::vector<std::pair<int,Status>>* errors) {
+    Status status;
+    int width = seeds_.empty() ? 0 : seeds_[0].second.dvals().size();
+    for (auto& seed : seeds_) {
+        if (seed.second.dvals().size() != width) {
+            status.code = ReturnCode::invalid_argument;
+            status.message = "Seeds have different numbers of derivatives";
+            return status;
+        }
     }
-    return return_values; 
-} 
+    // The caches are not thread safe, so every tape is compiled up front.
+    std::vector<std::pair<Status,const Tape<T>*>> compiled;
+    for (const std::string& equation : equations) {
+        compiled.push_back(CompiledTape(equation, true));
+    }
+    DenseRows(equations.size(), width,
+              [&](Workspace<T>& workspace, int i, T& value, T* derivs,
+                  int stride) {
+        if (compiled[i].first.code != ReturnCode::success) {
+            return compiled[i].first;
+        }
+        return workspace.DeriveInto(*compiled[i].second, seeds_, value,
+                                    derivs, stride);
+    }, values, jacobian, codes, layout, errors);
+    return status;
+}
+
+template <class T>
+Status AutoDiffer<T>::DeriveDense(
+    const std::string& equation,
+    const std::vector<std::vector<std::pair<std::string, ADValue<T>>>>&
+        seeds,
+    T* values, T* jacobian, ReturnCode* codes, MatrixLayout layout,
+    std::vector<std::pair<int,Status>>* errors) {
+    int width = seeds.empty() || seeds[0].empty() ? 0 :
+                seeds[0][0].second.dvals().size();
+    std::pair<Status,const Tape<T>*> compiled = CompiledTape(equation, true);
+    DenseRows(seeds.size(), width,
+              [&](Workspace<T>& workspace, int i, T& value, T* derivs,
+                  int stride) {
+        if (compiled.first.code != ReturnCode::success) {
+            return compiled.first;
+        }
+        int row_width =
+            seeds[i].empty() ? 0 : seeds[i][0].second.dvals().size();
+        if (row_width != width) {
+            Status status;
+            status.code = ReturnCode::invalid_argument;
+            status.message = "Seeds have different numbers of derivatives";
+            return status;
+        }
+        return workspace.DeriveInto(*compiled.second, seeds[i], value,
+                                    derivs, stride);
+    }, values, jacobian, codes, layout, errors);
+    return Status();
+}
+
+template <class T>
+Status AutoDiffer<T>::DeriveDense(
+    const std::string& equation, const std::vector<std::string>& variables,
+    const T* points, int num_points,
+    T* values, T* jacobian, ReturnCode* codes, MatrixLayout layout,
+    std::vector<std::pair<int,Status>>* errors) {
+    std::pair<Status,const Tape<T>*> compiled = CompiledTape(equation, true);
+    Status status = compiled.first;
+    // Names are resolved once for every point.
+    std::vector<int> index;
+    if (status.code == ReturnCode::success) {
+        status = compiled.second->ResolveVariables(variables, index);
+    }
+    if (status.code != ReturnCode::success) {
+        return status;
+    }
+    int width = variables.size();
+    DenseRows(num_points, width,
+              [&](Workspace<T>& workspace, int i, T& value, T* derivs,
+                  int stride) {
+        return workspace.DerivePoint(*compiled.second, index,
+                                     points + static_cast<size_t>(i) * width,
+                                     width, value, derivs, stride);
+    }, values, jacobian, codes, layout, errors);
+    return status;
+}
+
+
+/**
+ * The AutoDifferOpenMp class is an AutoDiffer whose multiple function and
+ * multiple seed Derive run on OpenMP (see SetExecutor). It is kept for code
+ * written before the executor could be chosen at runtime; it runs serially
+ * unless the project is built with USE_THREAD, which Stats reports. To
+ * build with OpenMP, run `bash config.sh --thread` at the top level directory.
+ */
+template <class T>
+class AutoDifferOpenMp : public AutoDiffer<T> {
+  public:
+    // Constructor initializes the number of threads to be used.
+    AutoDifferOpenMp(int num_threads) {
+        this->SetExecutor(ExecutorPolicy::openmp, num_threads);
+    }
+
+    // Same as the multiple equation derive of AutoDiffer.
+    std::vector<std::pair<Status,ADValue<T>>> DeriveOpenMp(
+        std::vector<std::string> equations) {
+        return this->Derive(std::move(equations));
+    }
+
+    // Same as the multiple seed derive of the AutoDiffer.
+    std::vector<std::pair<Status,ADValue<T>>> DeriveOpenMp(
+        const std::string& equation, 
+        std::vector<std::vector<std::pair<std::string, ADValue<T>>>> seeds) {
+        return this->Derive(equation, std::move(seeds));
+    }
+};
+
+
+/**
+ * The AutoDifferStdThread class is an AutoDiffer whose multiple function and
+ * multiple seed Derive run on a pool of std::threads, one per hardware thread
+ * (see SetExecutor). It is kept for code written before the executor could
+ * be chosen at runtime.
+ */
+template <class T>
+class AutoDifferStdThread : public AutoDiffer<T> {
+  public:
+    AutoDifferStdThread() {
+        this->SetExecutor(ExecutorPolicy::thread_pool);
+    }
+
+    // Same as the multiple equation derive of AutoDiffer.
+    std::vector<std::pair<Status,ADValue<T>>> DeriveStdThread(
+        std::vector<std::string> equations) {
+        return this->Derive(std::move(equations));
+    }
+
+    // Same as the multiple seed derive of the AutoDiffer.
+    std::vector<std::pair<Status,ADValue<T>>> DeriveStdThread(
+        const std::string& equation, 
+        std::vector<std::vector<std::pair<std::string, ADValue<T>>>> seeds) {
+        return this->Derive(equation, std::move(seeds));
+    }
+};
 
 
 #endif /* AUTODIFFER_H */
@@ -0,0 +1,293 @@
+/**
+ * @file DeriveService.h
+ */
+
+#ifndef DERIVESERVICE_H
+#define DERIVESERVICE_H
+
+/* header files */
+#include "ADValue.hpp"
+#include "AutoDiffer.hpp"
+#include "InfixParser.hpp"
+#include "MpmcQueue.hpp"
+#include "Parser.hpp"
+
+/* system header files */
+#ifndef DOXYGEN_IGNORE
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#endif
+
+/**
+ * Callback of DeriveService, called once with the result of a request as
+ * soon as it is done, on the worker that derived it, after its future is
+ * ready. It must not throw.
+ */
+template <class T>
+using DeriveServiceCallback =
+    std::function<void(const std::pair<Status,ADValue<T>>&)>;
+
+/**
+ * The DeriveService class derives requests from any number of threads on a
+ * fixed set of workers, for servers that would otherwise build an
+ * AutoDiffer, or start threads, per request. Requests go through a bounded
+ * lock-free MpmcQueue, so submitting takes no lock while the workers keep
+ * up. When the queue is full, Submit waits for room and TrySubmit refuses,
+ * which caps the work in flight under bursty load. Each request completes
+ * through its own future and, optionally, a callback.
+ *
+ * Each worker derives on compiled tapes in an AutoDiffer of its own (see
+ * AutoDiffer::DeriveCompiled), so tapes are compiled once per worker and
+ * equation and then reused. The destructor finishes every submitted request
+ * before joining the workers.
+ *
+ * Example usage:
+ *
+ * DeriveService<double> service(8, 1024);
+ * std::future<std::pair<Status, ADValue<double>>> result = service.Submit(
+ *     "((x^2)*(sin(y)))", { { "x", ADValue<double>(1.5, {1, 0}) },
+ *                           { "y", ADValue<double>(2.0, {0, 1}) } });
+ * ADValue<double> gradient = result.get().second;
+ */
+template <class T>
+class DeriveService {
+  private:
+    struct Request {
+      std::string equation;
+      std::vector<std::pair<std::string, ADValue<T>>> seeds;
+      std::promise<std::pair<Status,ADValue<T>>> promise;
+      DeriveServiceCallback<T> callback;
+    };
+
+    MpmcQueue<Request> queue_;
+    std::vector<std::thread> workers_;
+
+    // Requests pushed and not popped yet, as seen by the waiting threads. A
+    // push is counted after it lands and a pop after it leaves, so it may
+    // briefly lag the queue.
+    std::atomic<int> pending_{0};
+
+    // Threads sleeping on an empty (workers) or full (producers) queue. A
+    // thread counts itself before checking pending_, and the other side
+    // changes pending_ before checking the count, so one of them sees the
+    // other and no wakeup is lost.
+    std::atomic<int> idle_workers_{0};
+    std::atomic<int> blocked_producers_{0};
+    std::mutex mutex_;
+    std::condition_variable available_;
+    std::condition_variable room_;
+    bool stopping_ = false;
+
+    /**
+     * Derives requests until the service is destroyed and the queue is
+     * empty.
+     *
+     * @param syntax: the notation of the equations.
+     */
+    void WorkerLoop(Syntax syntax) {
+        AutoDiffer<T> differ;
+        differ.SetSyntax(syntax);
+        differ.SetExecutor(ExecutorPolicy::serial, 1);
+        Request request;
+        while (true) {
+            if (!queue_.TryPop(request)) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                ++idle_workers_;
+                available_.wait(lock, [this] {
+                    return stopping_ || pending_.load() > 0;
+                });
+                --idle_workers_;
+                if (stopping_ && pending_.load() <= 0) {
+                    return;
+                }
+                continue;
+            }
+            --pending_;
+            if (blocked_producers_.load() > 0) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                room_.notify_one();
+            }
+            Run(differ, request);
+        }
+    }
+
+    /**
+     * Derives a request and completes it.
+     *
+     * @param differ: the AutoDiffer of the worker.
+     * @param request: the request.
+     */
+    void Run(AutoDiffer<T>& differ, Request& request) {
+        std::pair<Status,ADValue<T>> result(Status(), ADValue<T>(0,0));
+        try {
+            std::vector<std::vector<std::pair<std::string, ADValue<T>>>>
+                seeds(1);
+            seeds[0] = std::move(request.seeds);
+            result = differ.DeriveCompiled(request.equation, seeds)[0];
+        } catch (const std::logic_error& e) {
+            // An undefined derivative, reported like any other failure.
+            result.first.code = ReturnCode::invalid_argument;
+            result.first.message = e.what();
+        } catch (...) {
+            request.promise.set_exception(std::current_exception());
+            return;
+        }
+        // The future is ready before the callback runs, so a callback that
+        // throws anyway cannot change the result.
+        if (request.callback) {
+            request.promise.set_value(result);
+            try {
+                request.callback(result);
+            } catch (...) {
+            }
+        } else {
+            request.promise.set_value(std::move(result));
+        }
+    }
+
+    // Builds a request, leaving its promise to the caller.
+    static Request MakeRequest(
+        std::string equation,
+        std::vector<std::pair<std::string, ADValue<T>>> seeds,
+        DeriveServiceCallback<T> callback) {
+        Request request;
+        request.equation = std::move(equation);
+        request.seeds = std::move(seeds);
+        request.callback = std::move(callback);
+        return request;
+    }
+
+    /**
+     * Pushes a request and wakes a worker if one is idle.
+     *
+     * @param request: the request, moved from only on success.
+     * @returns: false if the queue is full.
+     */
+    bool Push(Request& request) {
+        if (!queue_.TryPush(std::move(request))) {
+            return false;
+        }
+        ++pending_;
+        if (idle_workers_.load() > 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            available_.notify_one();
+        }
+        return true;
+    }
+
+  public:
+    /**
+     * Constructor. Starts the workers.
+     *
+     * @param num_threads: the number of workers, 0 for one per hardware
+     * thread.
+     * @param capacity: the most requests waiting at once, rounded up to a
+     * power of two of at least 2 (see MpmcQueue).
+     * @param syntax: the notation of the equations (see
+     * AutoDiffer::SetSyntax).
+     */
+    explicit DeriveService(int num_threads = 0, int capacity = 1024,
+                           Syntax syntax = Syntax::parenthesized)
+        : queue_(std::max(2, capacity)) {
+        if (num_threads <= 0) {
+            num_threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for (int i = 0; i < num_threads; ++i) {
+            workers_.push_back(std::thread(&DeriveService::WorkerLoop, this,
+                                           syntax));
+        }
+    }
+
+    DeriveService(const DeriveService&) = delete;
+    DeriveService& operator=(const DeriveService&) = delete;
+
+    /**
+     * Destructor. Waits for every submitted request to complete. No request
+     * may be submitted once it has started.
+     */
+    ~DeriveService() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        available_.notify_all();
+        for (std::thread& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    /* getters */
+    int NumThreads() const { return workers_.size(); }
+    int Capacity() const { return queue_.Capacity(); }
+    // Requests waiting for a worker, approximate while requests move.
+    int NumPending() const { return std::max(0, pending_.load()); }
+
+    /**
+     * Submits a request without waiting.
+     *
+     * @param equation: the equation to derive.
+     * @param seeds: the seeds of its variables, as Derive.
+     * @param result: set to the future of the result on success.
+     * @param callback: called with the result when it is done, may be
+     * empty.
+     * @returns: false, with nothing submitted, if the queue is full.
+     */
+    bool TrySubmit(std::string equation,
+                   std::vector<std::pair<std::string, ADValue<T>>> seeds,
+                   std::future<std::pair<Status,ADValue<T>>>& result,
+                   DeriveServiceCallback<T> callback =
+                       DeriveServiceCallback<T>()) {
+        Request request = MakeRequest(std::move(equation), std::move(seeds),
+                                      std::move(callback));
+        std::future<std::pair<Status,ADValue<T>>> future =
+            request.promise.get_future();
+        if (!Push(request)) {
+            return false;
+        }
+        result = std::move(future);
+        return true;
+    }
+
+    /**
+     * Submits a request, waiting for room in the queue if it is full.
+     *
+     * @param equation: the equation to derive.
+     * @param seeds: the seeds of its variables, as Derive.
+     * @param callback: called with the result when it is done, may be
+     * empty.
+     * @returns: the future of a Status and ADValue pair, as Derive. An
+     * undefined derivative (a power of a negative base with a varying
+     * exponent) is an invalid_argument status rather than a logic_error.
+     * Only other exceptions, e.g., running out of memory, are rethrown by
+     * the future, and then the callback is not called.
+     */
+    std::future<std::pair<Status,ADValue<T>>> Submit(
+        std::string equation,
+        std::vector<std::pair<std::string, ADValue<T>>> seeds,
+        DeriveServiceCallback<T> callback = DeriveServiceCallback<T>()) {
+        Request request = MakeRequest(std::move(equation), std::move(seeds),
+                                      std::move(callback));
+        std::future<std::pair<Status,ADValue<T>>> result =
+            request.promise.get_future();
+        while (!Push(request)) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            ++blocked_producers_;
+            room_.wait(lock, [this] {
+                return pending_.load() < Capacity();
+            });
+            --blocked_producers_;
+        }
+        return result;
+    }
+};
+
+#endif /* DERIVESERVICE_H */
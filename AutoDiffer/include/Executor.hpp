@@ -0,0 +1,341 @@
+/**
+ * @file Executor.h
+ */
+
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+/* header files */
+#include "Parser.hpp"
+#include "ThreadPool.hpp"
+
+#ifdef USE_THREAD
+#include <omp.h>
+#endif
+/* system header files */
+#ifndef DOXYGEN_IGNORE
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#endif
+
+// How the items of a batch (e.g., the equations given to Derive) are spread
+// over threads.
+enum class ExecutorPolicy {
+  serial,        // one item after the other on the calling thread
+  openmp,        // an OpenMP parallel for, serial unless built with USE_THREAD
+  thread_pool,   // pool workers claim the next item from a shared counter
+  work_stealing, // each worker owns a range and steals from the others
+};
+
+// Statistics of the last batch run by an Executor.
+struct ExecutorStats {
+  // The backend that actually ran the batch, which is serial when the chosen
+  // one is not available or there was nothing to run in parallel.
+  ExecutorPolicy policy = ExecutorPolicy::serial;
+  int num_threads = 1;
+  int num_items = 0;
+  // Items run by a worker other than the one that owned them first, for
+  // work_stealing.
+  int num_stolen = 0;
+};
+
+/**
+ * Gets the name of a policy, e.g., "work_stealing".
+ *
+ * @param policy: the policy.
+ * @returns: the name, as accepted by ParseExecutorPolicy.
+ */
+inline std::string ExecutorPolicyName(ExecutorPolicy policy) {
+    switch (policy) {
+      case ExecutorPolicy::serial : return "serial";
+      case ExecutorPolicy::openmp : return "openmp";
+      case ExecutorPolicy::thread_pool : return "thread_pool";
+      case ExecutorPolicy::work_stealing : return "work_stealing";
+    }
+    return "";
+}
+
+/**
+ * Gets a policy by name, e.g., from a command line flag read at startup.
+ *
+ * @param name: the name, as returned by ExecutorPolicyName.
+ * @param policy: set to the policy on success.
+ * @returns: an invalid_argument status if no policy has that name.
+ */
+inline Status ParseExecutorPolicy(const std::string& name,
+                                  ExecutorPolicy& policy) {
+    Status status;
+    for (ExecutorPolicy candidate : { ExecutorPolicy::serial,
+                                      ExecutorPolicy::openmp,
+                                      ExecutorPolicy::thread_pool,
+                                      ExecutorPolicy::work_stealing }) {
+        if (ExecutorPolicyName(candidate) == name) {
+            policy = candidate;
+            return status;
+        }
+    }
+    status.code = ReturnCode::invalid_argument;
+    status.message = "Unknown executor policy: " + name;
+    return status;
+}
+
+/**
+ * The Executor class runs a batch of independent items with a policy chosen
+ * at runtime, so one binary can pick its strategy on each host. The
+ * thread_pool and work_stealing policies run on num_threads - 1 pool workers
+ * started on first use, plus the calling thread.
+ *
+ * Example usage:
+ *
+ * Executor executor(ExecutorPolicy::work_stealing, 8);
+ * std::vector<double> out(1000);
+ * executor.Run(out.size(), [&](int i) { out[i] = sin(i); });
+ */
+class Executor {
+  private:
+    ExecutorPolicy policy_;
+    int num_threads_;
+    std::shared_ptr<ThreadPool> pool_;
+
+    // Error of the first item that threw in a batch, shared by the workers.
+    struct Errors {
+      std::mutex mutex;
+      std::exception_ptr first;
+      std::atomic<bool> failed{false};
+
+      void Catch() {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (!first) {
+              first = std::current_exception();
+          }
+          failed.store(true);
+      }
+    };
+
+    /**
+     * Runs worker(t) for t in [0, num_threads), worker 0 on the calling
+     * thread and the others on the pool, and waits for all of them.
+     *
+     * @param num_threads: the number of workers.
+     * @param worker: the work of one worker. It must not throw.
+     */
+    void RunWorkers(int num_threads, const std::function<void(int)>& worker) {
+        if (!pool_) {
+            pool_ = std::make_shared<ThreadPool>(num_threads_ - 1);
+        }
+        std::mutex mutex;
+        std::condition_variable finished;
+        int running = num_threads - 1;
+        for (int t = 1; t < num_threads; ++t) {
+            pool_->Submit([&, t] {
+                worker(t);
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--running == 0) {
+                    finished.notify_one();
+                }
+            });
+        }
+        worker(0);
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&] { return running == 0; });
+    }
+
+    void RunSerial(int size, const std::function<void(int, int)>& work,
+                   Errors& errors) {
+        for (int i = 0; i < size && !errors.failed.load(); ++i) {
+            try {
+                work(i, 0);
+            } catch (...) {
+                errors.Catch();
+            }
+        }
+    }
+
+    void RunOpenMp(int size, int num_threads,
+                   const std::function<void(int, int)>& work, Errors& errors) {
+#ifndef USE_THREAD
+        // Only read by the pragma, which is ignored without OpenMP.
+        (void)num_threads;
+#endif
+        #pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+        for (int i = 0; i < size; ++i) {
+            // Exceptions must not leave an OpenMP region.
+            if (!errors.failed.load()) {
+                try {
+#ifdef USE_THREAD
+                    work(i, omp_get_thread_num());
+#else
+                    work(i, 0);
+#endif
+                } catch (...) {
+                    errors.Catch();
+                }
+            }
+        }
+    }
+
+    void RunThreadPool(int size, int num_threads,
+                       const std::function<void(int, int)>& work,
+                       Errors& errors) {
+        std::atomic<int> next(0);
+        RunWorkers(num_threads, [&](int t) {
+            for (int i = next++; i < size && !errors.failed.load();
+                 i = next++) {
+                try {
+                    work(i, t);
+                } catch (...) {
+                    errors.Catch();
+                }
+            }
+        });
+    }
+
+    int RunWorkStealing(int size, int num_threads,
+                        const std::function<void(int, int)>& work,
+                        Errors& errors) {
+        // Items not started yet of each worker. The owner takes them from
+        // the front and thieves take the back half.
+        struct Range {
+          std::mutex mutex;
+          int begin;
+          int end;
+        };
+        std::vector<Range> ranges(num_threads);
+        for (int t = 0; t < num_threads; ++t) {
+            ranges[t].begin = static_cast<long long>(size) * t / num_threads;
+            ranges[t].end =
+                static_cast<long long>(size) * (t + 1) / num_threads;
+        }
+        std::atomic<int> stolen(0);
+        RunWorkers(num_threads, [&](int t) {
+            Range& own = ranges[t];
+            while (!errors.failed.load()) {
+                int item = -1;
+                {
+                    std::lock_guard<std::mutex> lock(own.mutex);
+                    if (own.begin < own.end) {
+                        item = own.begin++;
+                    }
+                }
+                for (int k = 1; item < 0 && k < num_threads; ++k) {
+                    Range& victim = ranges[(t + k) % num_threads];
+                    int begin;
+                    int end;
+                    {
+                        std::lock_guard<std::mutex> lock(victim.mutex);
+                        end = victim.end;
+                        begin = end - (end - victim.begin + 1) / 2;
+                        victim.end = begin;
+                    }
+                    if (begin < end) {
+                        stolen += end - begin;
+                        std::lock_guard<std::mutex> lock(own.mutex);
+                        own.begin = begin + 1;
+                        own.end = end;
+                        item = begin;
+                    }
+                }
+                // Items never create items, so when every range is empty
+                // there is nothing left to steal.
+                if (item < 0) {
+                    return;
+                }
+                try {
+                    work(item, t);
+                } catch (...) {
+                    errors.Catch();
+                }
+            }
+        });
+        return stolen.load();
+    }
+
+  public:
+    /**
+     * Constructor.
+     *
+     * @param policy: the policy.
+     * @param num_threads: the number of threads, 0 for one per hardware
+     * thread.
+     */
+    explicit Executor(ExecutorPolicy policy = ExecutorPolicy::serial,
+                      int num_threads = 0)
+        : policy_(policy),
+          num_threads_(num_threads > 0 ? num_threads :
+                       std::max(1u, std::thread::hardware_concurrency())) {}
+
+    /* getters */
+    ExecutorPolicy Policy() const { return policy_; }
+    int NumThreads() const { return num_threads_; }
+
+    /**
+     * Runs work(i) for every i in [0, size) and waits for all of them.
+     *
+     * @param size: the number of items.
+     * @param work: the work of one item. Items may run concurrently, in any
+     * order, on any thread.
+     * @returns: the statistics of the batch. If an item throws, the first
+     * exception is rethrown once every thread has stopped, and items not
+     * started by then are skipped.
+     */
+    ExecutorStats Run(int size, const std::function<void(int)>& work) {
+        return RunWithWorkers(size, [&](int i, int) { work(i); });
+    }
+
+    /**
+     * Runs work(i, worker) for every i in [0, size), as Run, where worker
+     * identifies the thread running the item. No two items with the same
+     * worker run at the same time, so each worker can keep state of its own
+     * (e.g., a Workspace) between items.
+     *
+     * @param size: the number of items.
+     * @param work: the work of one item.
+     * @returns: the statistics of the batch. The workers are numbered from 0
+     * to stats.num_threads - 1.
+     */
+    ExecutorStats RunWithWorkers(int size,
+                                 const std::function<void(int, int)>& work) {
+        ExecutorStats stats;
+        stats.num_items = size;
+        int num_threads = std::max(1, std::min(num_threads_, size));
+        stats.policy = num_threads > 1 ? policy_ : ExecutorPolicy::serial;
+#ifndef USE_THREAD
+        if (stats.policy == ExecutorPolicy::openmp) {
+            // The pragma is ignored without OpenMP.
+            stats.policy = ExecutorPolicy::serial;
+        }
+#endif
+        stats.num_threads =
+            stats.policy == ExecutorPolicy::serial ? 1 : num_threads;
+        Errors errors;
+        switch (stats.policy) {
+          case ExecutorPolicy::serial :
+            RunSerial(size, work, errors);
+            break;
+          case ExecutorPolicy::openmp :
+            RunOpenMp(size, num_threads, work, errors);
+            break;
+          case ExecutorPolicy::thread_pool :
+            RunThreadPool(size, num_threads, work, errors);
+            break;
+          case ExecutorPolicy::work_stealing :
+            stats.num_stolen = RunWorkStealing(size, num_threads, work,
+                                               errors);
+            break;
+        }
+        if (errors.first) {
+            std::rethrow_exception(errors.first);
+        }
+        return stats;
+    }
+};
+
+#endif /* EXECUTOR_H */
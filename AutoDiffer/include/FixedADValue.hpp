@@ -0,0 +1,173 @@
+/**
+ * @file FixedADValue.h
+ */
+
+#ifndef FIXEDADVALUE_H
+#define FIXEDADVALUE_H
+
+/* header files */
+#include "ADNode.hpp"
+
+/* system header files */
+#ifndef DOXYGEN_IGNORE
+# include <array>
+# include <stdexcept>
+#endif
+
+
+/**
+ * The FixedADValue class is an ADValue with a compile-time number of
+ * derivatives, N, stored inline. It provides the same operator interface as
+ * ADValue so it can be evaluated through a compiled Tape, and is used to
+ * process wide seed vectors in chunks of N directions. With a small N (e.g.,
+ * 8 or 16) every intermediate fits in a few cache lines and the derivative
+ * loops have a fixed trip count that the compiler can vectorize.
+ */
+template <class T, int N>
+class FixedADValue {
+  private:
+    // Value.
+    T v;
+
+    // Derivative values.
+    std::array<T, N> dvs;
+
+    /**
+     * Applies a unary op with the chain rule, dvs[i] = f'(v) * dvs[i].
+     *
+     * @param op: the unary operation.
+     * @returns: FixedADValue with the result of the op.
+     */
+    FixedADValue<T, N> Unary(Operation op) const;
+
+    /**
+     * Applies a binary op, dvs[i] = df/da * dvs[i] + df/db * other.dvs[i].
+     *
+     * @param op: the binary operation.
+     * @param other: the right hand side (or base of a log).
+     * @returns: FixedADValue with the result of the op.
+     */
+    FixedADValue<T, N> Binary(Operation op,
+                              const FixedADValue<T, N>& other) const;
+
+  public:
+    /**
+     * Default constructor. Zero value and derivatives.
+     */
+    FixedADValue() : v(0) { dvs.fill(0); }
+
+    /**
+     * Constant constructor. All derivatives are zero.
+     *
+     * @param: val: the value.
+     */
+    explicit FixedADValue(T val) : v(val) { dvs.fill(0); }
+
+    /**
+     * Constructor with the full array of derivatives.
+     *
+     * @param: val: the value.
+     * @param: dvals: the derivatives.
+     */
+    FixedADValue(T val, const std::array<T, N>& dvals) : v(val), dvs(dvals) {}
+
+    /* getters */
+    T val() const { return v; };
+    T dval(int i) const { return dvs[i]; };
+
+    /* setters */
+    void set_dval(int i, T dval) { dvs[i] = dval; };
+
+    /* operators, see ADValue for documentation */
+    FixedADValue<T, N> operator+(const FixedADValue<T, N> &other) const {
+        return Binary(Operation::addition, other);
+    }
+    FixedADValue<T, N> operator-(const FixedADValue<T, N> &other) const {
+        return Binary(Operation::subtraction, other);
+    }
+    FixedADValue<T, N> power(const FixedADValue<T, N> &other) const {
+        return Binary(Operation::power, other);
+    }
+    FixedADValue<T, N> ADmul(const FixedADValue<T, N> &other) const {
+        return Binary(Operation::multiplication, other);
+    }
+    FixedADValue<T, N> ADdiv(const FixedADValue<T, N> &other) const {
+        return Binary(Operation::division, other);
+    }
+    FixedADValue<T, N> ADlog(const FixedADValue<T, N> &other) const {
+        return Binary(Operation::log, other);
+    }
+    FixedADValue<T, N> ADexp() const { return Unary(Operation::exp); }
+    FixedADValue<T, N> ADsin() const { return Unary(Operation::sin); }
+    FixedADValue<T, N> ADcos() const { return Unary(Operation::cos); }
+    FixedADValue<T, N> ADtan() const { return Unary(Operation::tan); }
+    FixedADValue<T, N> ADarcsin() const { return Unary(Operation::arcsin); }
+    FixedADValue<T, N> ADarccos() const { return Unary(Operation::arccos); }
+    FixedADValue<T, N> ADarctan() const { return Unary(Operation::arctan); }
+    FixedADValue<T, N> ADsinh() const { return Unary(Operation::sinh); }
+    FixedADValue<T, N> ADcosh() const { return Unary(Operation::cosh); }
+    FixedADValue<T, N> ADtanh() const { return Unary(Operation::tanh); }
+    FixedADValue<T, N> ADlogistic() const {
+        return Unary(Operation::logistic);
+    }
+    FixedADValue<T, N> ADsqrt() const { return Unary(Operation::sqrt); }
+    FixedADValue<T, N> ADfma(const FixedADValue<T, N> &other,
+                             const FixedADValue<T, N> &addend) const;
+    FixedADValue<T, N> ADsquare() const { return Unary(Operation::square); }
+    FixedADValue<T, N> ADreciprocal() const {
+        return Unary(Operation::reciprocal);
+    }
+    FixedADValue<T, N> ADipow(const FixedADValue<T, N> &other) const {
+        return Binary(Operation::ipow, other);
+    }
+    FixedADValue<T, N> ADexpneg() const { return Unary(Operation::expneg); }
+    FixedADValue<T, N> ADloglogistic(const FixedADValue<T, N> &other) const {
+        return Binary(Operation::loglogistic, other);
+    }
+};
+
+// Implementation
+
+template <class T, int N>
+FixedADValue<T, N> FixedADValue<T, N>::Unary(Operation op) const {
+    FixedADValue<T, N> result(PrimalOperation(op, v, T(0)));
+    T da, db;
+    PartialOperation(op, v, T(0), result.v, da, db);
+    // Chain rule.
+    for (int i = 0; i < N; ++i) {
+        result.dvs[i] = da * dvs[i];
+    }
+    return result;
+}
+
+template <class T, int N>
+FixedADValue<T, N> FixedADValue<T, N>::Binary(
+    Operation op, const FixedADValue<T, N>& other) const {
+    FixedADValue<T, N> result(PrimalOperation(op, v, other.v));
+    T da, db;
+    if (!PartialOperation(op, v, other.v, result.v, da, db)) {
+        // Negative base, the exponent must be a constant.
+        for (int i = 0; i < N; ++i) {
+            if (other.dvs[i] != 0) {
+                throw std::logic_error("Derivative not defined or complex.");
+            }
+        }
+        db = 0;
+    }
+    for (int i = 0; i < N; ++i) {
+        result.dvs[i] = da * dvs[i] + db * other.dvs[i];
+    }
+    return result;
+}
+
+template <class T, int N>
+FixedADValue<T, N> FixedADValue<T, N>::ADfma(
+    const FixedADValue<T, N>& other, const FixedADValue<T, N>& addend) const {
+    FixedADValue<T, N> result(v * other.v + addend.v);
+    for (int i = 0; i < N; ++i) {
+        result.dvs[i] = dvs[i] * other.v + other.dvs[i] * v + addend.dvs[i];
+    }
+    return result;
+}
+
+#endif /* FIXEDADVALUE_H */
@@ -0,0 +1,239 @@
+/**
+ * @file IncrementalDiffer.h
+ */
+
+#ifndef INCREMENTALDIFFER_H
+#define INCREMENTALDIFFER_H
+
+/* header files */
+#include "ADNode.hpp"
+#include "ADValue.hpp"
+#include "Parser.hpp"
+#include "Tape.hpp"
+
+/* system header files */
+#ifndef DOXYGEN_IGNORE
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+#endif
+
+
+/**
+ * The IncrementalDiffer class keeps an equation evaluated so that changing a
+ * single seed only recomputes the part of the expression that depends on it.
+ * The equation is compiled once, and Init records for every variable the
+ * instructions that (transitively) depend on it. The value and derivatives of
+ * every intermediate are cached between calls. It follows the same Init/Run
+ * protocol as the Parser.
+ *
+ * Example usage: f(x,y) = sin(x) * y, changing y only recomputes the product.
+ *
+ * IncrementalDiffer<double> inc("((sin(x))*y)");
+ * inc.Init(seeds);                        // seeds for "x" and "y"
+ * ADValue<double> f = inc.Run().second;   // full evaluation
+ * f = inc.UpdateSeed("y", 3.0).second;    // one instruction recomputed
+ */
+template <class T>
+class IncrementalDiffer {
+  private:
+    // The string used to represent the equation.
+    std::string equation_;
+
+    // The compiled equation.
+    Tape<T> tape_;
+
+    // Cached value of every slot of the tape.
+    std::vector<ADValue<T>> slots_;
+
+    // Names of the seeds given to Init and the tape variable of each seed
+    // (-1 if the equation does not use it).
+    std::vector<std::string> seed_names_;
+    std::vector<int> seed_variables_;
+
+    // For each tape variable, the indices of the instructions that depend on
+    // it, in evaluation order.
+    std::vector<std::vector<int>> dependents_;
+
+    // Number of instructions recomputed by the last Run or UpdateSeed.
+    int last_update_size_ = 0;
+
+    // Status of Init.
+    Status status_;
+
+    /**
+     * Recomputes a list of instructions in order.
+     *
+     * @param instructions: indices into the tape instructions.
+     */
+    void Recompute(const std::vector<int>& instructions);
+
+  public:
+    /**
+     * IncrementalDiffer constructor.
+     *
+     * @param equation: a string representation of the equation.
+     */
+    IncrementalDiffer(std::string equation) : equation_(equation) {}
+
+    /**
+     * Compiles the equation, binds the seeds and evaluates every instruction.
+     *
+     * @param seed_values: a vector of string -> ADValue pairs, as for the
+     * Parser.
+     * @returns: a status to indicate success or failure with a message.
+     */
+    Status Init(std::vector<std::pair<std::string, ADValue<T>>> seed_values);
+
+    /**
+     * Gets the current result. No work is done.
+     *
+     * @returns: a pair of status and ADValue. If Init failed, the status is
+     * the failure and the ADValue object is zero.
+     */
+    std::pair<Status,ADValue<T>> Run() const;
+
+    /**
+     * Changes the value (and derivatives) of a seed and recomputes only the
+     * instructions that depend on it.
+     *
+     * @param variable: the name of the seed (e.g., "y").
+     * @param value: the new value of the seed.
+     * @returns: a pair of status and the updated result.
+     */
+    std::pair<Status,ADValue<T>> UpdateSeed(const std::string& variable,
+                                            const ADValue<T>& value);
+
+    /**
+     * Changes the value of a seed, keeping its derivatives.
+     *
+     * @param variable: the name of the seed (e.g., "y").
+     * @param value: the new value of the seed.
+     * @returns: a pair of status and the updated result.
+     */
+    std::pair<Status,ADValue<T>> UpdateSeed(const std::string& variable,
+                                            T value);
+
+    /**
+     * Gets the number of instructions recomputed by the last call to Init or
+     * UpdateSeed.
+     */
+    int LastUpdateSize() const { return last_update_size_; }
+};
+
+
+/* Implementation */
+
+template <class T>
+Status IncrementalDiffer<T>::Init(
+    std::vector<std::pair<std::string, ADValue<T>>> seed_values) {
+    status_ = tape_.Compile(equation_);
+    if (status_.code != ReturnCode::success) {
+        return status_;
+    }
+    seed_names_.clear();
+    for (auto& seed_val : seed_values) {
+        seed_names_.push_back(seed_val.first);
+    }
+    std::vector<int> index;
+    status_ = tape_.ResolveVariables(seed_names_, index);
+    if (status_.code != ReturnCode::success) {
+        return status_;
+    }
+    seed_variables_.assign(seed_names_.size(), -1);
+    slots_.clear();
+    for (int i = 0; i < index.size(); ++i) {
+        seed_variables_[index[i]] = i;
+        slots_.push_back(seed_values[index[i]].second);
+    }
+
+    // Record the instructions that depend on each variable.
+    const std::vector<Instruction>& instructions = tape_.Instructions();
+    dependents_.assign(index.size(), std::vector<int>());
+    std::vector<bool> dirty(tape_.NumSlots());
+    for (int v = 0; v < index.size(); ++v) {
+        std::fill(dirty.begin(), dirty.end(), false);
+        dirty[v] = true;
+        for (int i = 0; i < instructions.size(); ++i) {
+            const Instruction& ins = instructions[i];
+            if (dirty[ins.lhs] || (ins.rhs >= 0 && dirty[ins.rhs]) ||
+                (ins.third >= 0 && dirty[ins.third])) {
+                dirty[ins.dst] = true;
+                dependents_[v].push_back(i);
+            }
+        }
+    }
+
+    // Full evaluation. Constants have zero derivatives of the seed width, as
+    // in Parser::GetValue.
+    int seed_size = seed_values.size() > 0 ? seed_values.size() : 1;
+    std::vector<T> zeros(seed_size, 0);
+    tape_.Forward(slots_, [&zeros](T c) { return ADValue<T>(c, zeros); });
+    last_update_size_ = instructions.size();
+    return status_;
+}
+
+template <class T>
+std::pair<Status,ADValue<T>> IncrementalDiffer<T>::Run() const {
+    if (status_.code != ReturnCode::success || slots_.empty()) {
+        return std::pair<Status,ADValue<T>>(status_, ADValue<T>(0,0));
+    }
+    return std::pair<Status,ADValue<T>>(status_, slots_[tape_.Output()]);
+}
+
+template <class T>
+std::pair<Status,ADValue<T>> IncrementalDiffer<T>::UpdateSeed(
+    const std::string& variable, const ADValue<T>& value) {
+    if (status_.code != ReturnCode::success || slots_.empty()) {
+        return Run();
+    }
+    for (int i = 0; i < seed_names_.size(); ++i) {
+        if (seed_names_[i] != variable) {
+            continue;
+        }
+        int v = seed_variables_[i];
+        if (v < 0) {
+            // The equation does not use this seed.
+            last_update_size_ = 0;
+            return Run();
+        }
+        slots_[v] = value;
+        Recompute(dependents_[v]);
+        return Run();
+    }
+    Status status;
+    status.code = ReturnCode::parse_error;
+    status.message = "Key not found: " + variable;
+    return std::pair<Status,ADValue<T>>(status, ADValue<T>(0,0));
+}
+
+template <class T>
+std::pair<Status,ADValue<T>> IncrementalDiffer<T>::UpdateSeed(
+    const std::string& variable, T value) {
+    for (int i = 0; i < seed_names_.size(); ++i) {
+        if (seed_names_[i] == variable && seed_variables_[i] >= 0 &&
+            !slots_.empty()) {
+            const ADValue<T>& seed = slots_[seed_variables_[i]];
+            return UpdateSeed(variable, ADValue<T>(value, seed.dvals()));
+        }
+    }
+    // Unused or unknown seed, nothing to keep.
+    return UpdateSeed(variable, ADValue<T>(value, 0));
+}
+
+template <class T>
+void IncrementalDiffer<T>::Recompute(const std::vector<int>& instructions) {
+    const std::vector<Instruction>& tape_instructions = tape_.Instructions();
+    for (int i : instructions) {
+        const Instruction& ins = tape_instructions[i];
+        ADValue<T>& lhs = slots_[ins.lhs];
+        ADValue<T>& rhs = ins.rhs < 0 ? lhs : slots_[ins.rhs];
+        ADValue<T>& third = ins.third < 0 ? lhs : slots_[ins.third];
+        slots_[ins.dst] = EvaluateOperation(ins.op, lhs, rhs, third);
+    }
+    last_update_size_ = instructions.size();
+}
+
+
+#endif /* INCREMENTALDIFFER_H */
@@ -0,0 +1,536 @@
+/**
+ * @file InfixParser.h
+ */
+
+#ifndef INFIXPARSER_H
+#define INFIXPARSER_H
+
+/* header files */
+#include "ADNode.hpp"
+#include "MappedFile.hpp"
+#include "Parser.hpp"
+#include "Tape.hpp"
+
+/* system header files */
+#ifndef DOXYGEN_IGNORE
+#include <cctype>
+#include <istream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#endif
+
+// The notation an equation is written in.
+enum class Syntax {
+  parenthesized, // fully parenthesized, read by Parser and Tape::Compile
+  infix,         // standard infix notation, read by InfixParser
+};
+
+/**
+ * The InfixParser compiles equations written in standard infix notation into
+ * a Tape, the same compiled form produced by Tape::Compile for the fully
+ * parenthesized syntax. Operators follow the usual precedence, from lowest to
+ * highest: + and -, then * and /, then unary minus, then ^. All binary ops are
+ * left associative except ^, which is right associative, so -x^2 is -(x^2)
+ * and 2^3^2 is 2^(3^2). Functions use call syntax, e.g., sin(x), and the
+ * logarithm keeps its base in the name, e.g., log_2_(x). Whitespace is
+ * ignored. The equation is read in a single left to right pass, and every
+ * operation is emitted to the tape as soon as both of its operands are known.
+ *
+ * The parser does not recurse. Operators, open parentheses and function calls
+ * waiting for their operands are kept on an explicit stack, so the nesting
+ * depth is only limited by memory (e.g., 10^6 nested parentheses on a thread
+ * with a small stack), and time and memory are linear in the equation.
+ *
+ * The equation can be a string, a buffer owned by the caller (e.g., a
+ * MappedFile) or a stream, which is read in fixed size chunks. The text is
+ * never copied as a whole, so with hash consing (SetHashConsing) the memory
+ * used while compiling is bounded by the expression DAG and the nesting depth
+ * rather than by the size of the text. CompileInfixFile maps a file and
+ * compiles it this way.
+ *
+ * Example usage: equivalent to "(((x^2)+(y^2))*(sin(x)))".
+ *
+ * Tape<double> tape;
+ * InfixParser<double> parser("(x^2 + y^2) * sin(x)");
+ * assert(parser.Compile(tape).code == ReturnCode::success);
+ *
+ * std::ifstream file("equation.txt");
+ * InfixParser<double> stream_parser(file);
+ * stream_parser.SetHashConsing(true);
+ * assert(stream_parser.Compile(tape).code == ReturnCode::success);
+ */
+template <class T>
+class InfixParser {
+  private:
+    // An entry of the stack of operators waiting for their right hand side.
+    struct Pending {
+      enum Kind { binary, negation, group, call };
+      Kind kind;
+      // The binary operation or the function of a call.
+      Operation op;
+      // Precedence of a binary operation or negation.
+      int precedence;
+      // Left hand side of a binary operation, or the base of a log call.
+      int lhs;
+    };
+
+    // Size of the chunks read from a stream.
+    static const int kChunkSize = 1 << 16;
+
+    // The equation, when constructed from a string.
+    std::string equation_;
+
+    // Where the equation starts and ends, when it is held in memory.
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+
+    // The stream, when reading from one, and the chunk read last.
+    std::istream* stream_ = nullptr;
+    std::vector<char> chunk_;
+
+    // Unread part of the current buffer (the equation or the chunk).
+    const char* cur_ = nullptr;
+    const char* end_ = nullptr;
+
+    // Position of the next character to read, counted from the start.
+    size_t pos_ = 0;
+
+    TapeBuilder<T> builder_;
+
+    // Whether repeated subexpressions are emitted once.
+    bool hash_consing_ = false;
+
+    // Operators, open parentheses and calls not yet emitted, innermost last.
+    std::vector<Pending> stack_;
+
+    // Text of the current name or number, reused between tokens.
+    std::string token_;
+
+    // Stream for reading numbers, reused for the same reason.
+    std::istringstream number_stream_;
+
+    // Node of every number read so far, by its text, so a repeated literal
+    // is not converted again.
+    std::unordered_map<std::string, int> number_nodes_;
+
+    /**
+     * Gets the next character without consuming it or skipping whitespace,
+     * reading the next chunk of a stream if needed.
+     *
+     * @returns: the next character, or '\0' at the end of the equation.
+     */
+    char Current();
+
+    /**
+     * Consumes the current character.
+     */
+    void Advance() {
+        ++cur_;
+        ++pos_;
+    }
+
+    /**
+     * Skips whitespace and returns the next character without consuming it.
+     *
+     * @returns: the next character, or '\0' at the end of the equation.
+     */
+    char Peek();
+
+    /**
+     * Reads an operand, or the start of one: a unary minus, an open
+     * parenthesis or a function name and its '(' are pushed onto the stack,
+     * and the parser keeps expecting an operand.
+     *
+     * @param node: set to the node id of a number or variable.
+     * @param complete: set to whether node was set.
+     * @returns: a status to indicate success or failure with a message.
+     */
+    Status ParseOperand(int& node, bool& complete);
+
+    /**
+     * Reads a number at the current position.
+     *
+     * @param node: set to the node id of the constant.
+     * @returns: a status to indicate success or failure with a message.
+     */
+    Status ParseNumber(int& node);
+
+    /**
+     * Reads the text of token_ as a value of type T.
+     *
+     * @param value: set to the value.
+     * @returns: whether all of token_ is a valid value.
+     */
+    bool ReadToken(T& value);
+
+    /**
+     * Emits the pending operators on top of the stack that bind tighter than
+     * an operator of the given precedence, with node as the right hand side
+     * of the innermost one. Stops at an open parenthesis or call.
+     *
+     * @param precedence: precedence of the next operator, 0 to emit every
+     * operator up to the innermost parenthesis.
+     * @param right_associative: whether the next operator is ^.
+     * @param node: the right hand side, set to the value of the emitted ops.
+     */
+    void Reduce(int precedence, bool right_associative, int& node);
+
+    /**
+     * Builds a parse_error status.
+     *
+     * @param message: what went wrong.
+     * @param position: where, counted from the start of the equation.
+     * @returns: the status.
+     */
+    Status Error(const std::string& message, size_t position) const;
+
+    /**
+     * Builds a parse_error status pointing at the current position.
+     *
+     * @param message: what went wrong.
+     * @returns: the status.
+     */
+    Status Error(const std::string& message) const {
+        return Error(message, pos_);
+    }
+
+  public:
+    /**
+     * Constructor.
+     *
+     * @param equation: the equation in infix notation (e.g., "x^2 + sin(y)").
+     */
+    explicit InfixParser(const std::string& equation) : equation_(equation) {}
+
+    /**
+     * Constructor from a buffer owned by the caller, which must stay valid
+     * until Compile returns.
+     *
+     * @param data: the first character of the equation.
+     * @param size: the number of characters.
+     */
+    InfixParser(const char* data, size_t size) : data_(data), size_(size) {}
+
+    /**
+     * Constructor from a stream, which is read to its end by Compile.
+     *
+     * @param stream: the stream holding the equation.
+     */
+    explicit InfixParser(std::istream& stream)
+        : stream_(&stream), chunk_(kChunkSize) {}
+
+    /**
+     * Enables or disables hash consing (see TapeBuilder::SetHashConsing).
+     *
+     * @param hash_consing: whether to emit repeated subexpressions once.
+     */
+    void SetHashConsing(bool hash_consing) { hash_consing_ = hash_consing; }
+
+    /* getters */
+    // Number of characters read by the last Compile.
+    size_t BytesRead() const { return pos_; }
+
+    /**
+     * Compiles the equation into a tape. A stream can only be compiled once.
+     *
+     * @param tape: the tape to fill. Any previous contents are replaced.
+     * @returns: a status to indicate success or failure with a message.
+     */
+    Status Compile(Tape<T>& tape);
+};
+
+/**
+ * Compiles an infix equation stored in a file. The file is mapped rather than
+ * read into a string, and the tape is built with hash consing.
+ *
+ * @param path: the path of the file.
+ * @param tape: the tape to fill.
+ * @param bytes: if not null, set to the size of the file.
+ * @returns: a status to indicate success or failure with a message.
+ */
+template <class T>
+Status CompileInfixFile(const std::string& path, Tape<T>& tape,
+                        size_t* bytes = nullptr);
+
+
+/* Implementation InfixParser */
+
+// Binding power of a binary operator character, 0 if it is not one.
+inline int InfixPrecedence(char c) {
+    switch (c) {
+      case '+' : case '-' : return 1;
+      case '*' : case '/' : return 2;
+      case '^' : return 4;
+    }
+    return 0;
+}
+
+// Binding power of unary minus, between * and ^.
+const int kNegationPrecedence = 3;
+
+template <class T>
+Status InfixParser<T>::Compile(Tape<T>& tape) {
+    pos_ = 0;
+    if (stream_ == nullptr) {
+        cur_ = data_ != nullptr ? data_ : equation_.data();
+        end_ = cur_ + (data_ != nullptr ? size_ : equation_.size());
+    } else {
+        cur_ = end_ = nullptr;
+    }
+    builder_ = TapeBuilder<T>();
+    builder_.SetHashConsing(hash_consing_);
+    stack_.clear();
+    number_nodes_.clear();
+    // Alternate between reading an operand and reading what follows it.
+    int node = -1;
+    while (true) {
+        bool complete = false;
+        Status status = ParseOperand(node, complete);
+        if (status.code != ReturnCode::success) {
+            return status;
+        }
+        if (!complete) {
+            continue;
+        }
+        // Close every group and call that ends after the operand.
+        char c = Peek();
+        while (c == ')') {
+            Reduce(0, false, node);
+            if (stack_.empty()) {
+                return Error("Unexpected \')\'");
+            }
+            Pending open = stack_.back();
+            stack_.pop_back();
+            if (open.kind == Pending::call) {
+                node = open.op == Operation::log ?
+                    builder_.Emit(Operation::log, node, open.lhs) :
+                    builder_.Emit(open.op, node);
+            }
+            Advance();
+            c = Peek();
+        }
+        int precedence = InfixPrecedence(c);
+        if (precedence == 0) {
+            break;
+        }
+        Advance();
+        // Right associative ^ leaves a pending ^ on the stack, the others
+        // are emitted first.
+        Reduce(precedence, c == '^', node);
+        Operation op;
+        switch (c) {
+          case '+' : op = Operation::addition; break;
+          case '-' : op = Operation::subtraction; break;
+          case '*' : op = Operation::multiplication; break;
+          case '/' : op = Operation::division; break;
+          default : op = Operation::power; break;
+        }
+        stack_.push_back(Pending{Pending::binary, op, precedence, node});
+    }
+    Reduce(0, false, node);
+    if (!stack_.empty()) {
+        return Error("Expected \')\'");
+    }
+    char c = Peek();
+    if (c != '\0') {
+        return Error(std::string("Unexpected \'") + c + "\'");
+    }
+    builder_.Build(node, tape);
+    return Status();
+}
+
+template <class T>
+void InfixParser<T>::Reduce(int precedence, bool right_associative,
+                            int& node) {
+    while (!stack_.empty()) {
+        const Pending& top = stack_.back();
+        if (top.kind == Pending::group || top.kind == Pending::call ||
+            top.precedence < precedence ||
+            (top.precedence == precedence && right_associative)) {
+            return;
+        }
+        if (top.kind == Pending::negation) {
+            // Negation is subtraction from zero, as in the parser.
+            node = builder_.Emit(Operation::subtraction, builder_.Constant(0),
+                                 node);
+        } else {
+            node = builder_.Emit(top.op, top.lhs, node);
+        }
+        stack_.pop_back();
+    }
+}
+
+template <class T>
+char InfixParser<T>::Current() {
+    if (cur_ == end_ && stream_ != nullptr && *stream_) {
+        stream_->read(chunk_.data(), chunk_.size());
+        cur_ = chunk_.data();
+        end_ = cur_ + stream_->gcount();
+    }
+    return cur_ != end_ ? *cur_ : '\0';
+}
+
+template <class T>
+char InfixParser<T>::Peek() {
+    char c = Current();
+    while (isspace(c)) {
+        Advance();
+        c = Current();
+    }
+    return c;
+}
+
+template <class T>
+Status InfixParser<T>::Error(const std::string& message,
+                             size_t position) const {
+    Status status;
+    status.code = ReturnCode::parse_error;
+    status.message = message + " at position " + std::to_string(position);
+    return status;
+}
+
+template <class T>
+bool InfixParser<T>::ReadToken(T& value) {
+    number_stream_.clear();
+    number_stream_.str(token_);
+    number_stream_ >> value;
+    return number_stream_.eof() && !number_stream_.fail();
+}
+
+template <class T>
+Status InfixParser<T>::ParseOperand(int& node, bool& complete) {
+    char c = Peek();
+    if (c == '-') {
+        Advance();
+        stack_.push_back(Pending{Pending::negation, Operation::subtraction,
+                                 kNegationPrecedence, -1});
+        return Status();
+    }
+    if (c == '(') {
+        Advance();
+        stack_.push_back(Pending{Pending::group, Operation::addition, 0, -1});
+        return Status();
+    }
+    if (isdigit(c) || c == '.') {
+        complete = true;
+        return ParseNumber(node);
+    }
+
+    if (!isalpha(c) && c != '_') {
+        return Error(c == '\0' ? "Unexpected end of input" :
+                     std::string("Unexpected \'") + c + "\'");
+    }
+    token_.clear();
+    while (isalnum(c) || c == '_') {
+        token_ += c;
+        Advance();
+        c = Current();
+        // Log carries its base, log_<base>_, which may hold any character.
+        if (token_.size() == 4 && token_.compare(0, 4, "log_") == 0) {
+            break;
+        }
+    }
+
+    Pending call{Pending::call, Operation::log, 0, -1};
+    if (token_ == "log_") {
+        size_t base_start = pos_;
+        token_.clear();
+        while (c != '_' && c != '\0' && c != '(') {
+            token_ += c;
+            Advance();
+            c = Current();
+        }
+        if (c != '_' || token_.empty()) {
+            return Error("Invalid base of log", base_start);
+        }
+        Advance();
+        T base_value;
+        if (ReadToken(base_value)) {
+            call.lhs = builder_.Constant(base_value);
+        } else if (isalpha(token_[0])) {
+            call.lhs = builder_.Variable(token_);
+        } else {
+            return Error("Invalid base of log", base_start);
+        }
+        token_ = "log";
+    } else {
+        const Keyword* keyword = LookupKeyword(token_);
+        if (keyword == nullptr || keyword->op == Operation::log) {
+            // Anything else is a variable, which cannot be called.
+            if (Peek() == '(') {
+                return Error("Unknown function " + token_);
+            }
+            node = builder_.Variable(token_);
+            complete = true;
+            return Status();
+        }
+        call.op = keyword->op;
+    }
+    if (Peek() != '(') {
+        return Error("Expected \'(\' after " + token_);
+    }
+    Advance();
+    stack_.push_back(call);
+    return Status();
+}
+
+template <class T>
+Status InfixParser<T>::ParseNumber(int& node) {
+    // Digits, an optional fraction and an optional exponent.
+    size_t start = pos_;
+    token_.clear();
+    char c = Current();
+    while (isdigit(c) || c == '.') {
+        token_ += c;
+        Advance();
+        c = Current();
+    }
+    if (c == 'e' || c == 'E') {
+        token_ += c;
+        Advance();
+        c = Current();
+        if (c == '+' || c == '-') {
+            token_ += c;
+            Advance();
+            c = Current();
+        }
+        while (isdigit(c)) {
+            token_ += c;
+            Advance();
+            c = Current();
+        }
+    }
+    auto it = number_nodes_.find(token_);
+    if (it != number_nodes_.end()) {
+        node = it->second;
+        return Status();
+    }
+    T num;
+    if (!ReadToken(num)) {
+        return Error("Invalid number", start);
+    }
+    node = builder_.Constant(num);
+    number_nodes_.emplace(token_, node);
+    return Status();
+}
+
+template <class T>
+Status CompileInfixFile(const std::string& path, Tape<T>& tape,
+                        size_t* bytes) {
+    MappedFile file;
+    Status status = file.Open(path);
+    if (status.code != ReturnCode::success) {
+        return status;
+    }
+    if (bytes != nullptr) {
+        *bytes = file.size();
+    }
+    InfixParser<T> parser(file.data(), file.size());
+    parser.SetHashConsing(true);
+    return parser.Compile(tape);
+}
+
+#endif /* INFIXPARSER_H */
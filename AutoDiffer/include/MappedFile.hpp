@@ -0,0 +1,130 @@
+/**
+ * @file MappedFile.h
+ */
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+/* header files */
+#include "Parser.hpp"
+
+/* system header files */
+#ifndef DOXYGEN_IGNORE
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#if defined(__unix__) || defined(__APPLE__)
+#define AUTODIFFER_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#endif
+
+
+/**
+ * The MappedFile class maps a whole file into memory, read only, and unmaps it
+ * when destroyed. The pages are only read from disk when they are touched, and
+ * the kernel can drop them again under memory pressure, so a large file does
+ * not need to fit in the heap. Where mmap is not available the file is read
+ * into a buffer instead.
+ *
+ * Example usage:
+ *
+ * MappedFile file;
+ * assert(file.Open("equation.txt").code == ReturnCode::success);
+ * InfixParser<double> parser(file.data(), file.size());
+ */
+class MappedFile {
+  private:
+    // The contents of the file, valid until the MappedFile is destroyed.
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+
+    // Whether data_ is a mapping to unmap, rather than buffer_ or nothing.
+    bool mapped_ = false;
+
+    // Contents of the file when it could not be mapped.
+    std::vector<char> buffer_;
+
+    /**
+     * Unmaps or frees the current contents.
+     */
+    void Close();
+
+  public:
+    MappedFile() {}
+    ~MappedFile() { Close(); }
+
+    // A mapping has a single owner.
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * Maps a file, replacing any file mapped before.
+     *
+     * @param path: the path of the file.
+     * @returns: an invalid_argument status if the file cannot be read.
+     */
+    Status Open(const std::string& path);
+
+    /* getters */
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool IsMapped() const { return mapped_; }
+};
+
+
+/* Implementation MappedFile */
+
+inline void MappedFile::Close() {
+#ifdef AUTODIFFER_HAVE_MMAP
+    if (mapped_) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+    data_ = nullptr;
+    size_ = 0;
+    mapped_ = false;
+    buffer_.clear();
+}
+
+inline Status MappedFile::Open(const std::string& path) {
+    Close();
+    Status status;
+#ifdef AUTODIFFER_HAVE_MMAP
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE,
+                              fd, 0);
+            if (data != MAP_FAILED) {
+                data_ = static_cast<const char*>(data);
+                size_ = info.st_size;
+                mapped_ = true;
+            }
+        }
+        close(fd);
+        if (mapped_) {
+            return status;
+        }
+    }
+#endif
+    // Not mappable (e.g., empty, a pipe or no mmap), read it instead.
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if (!file) {
+        status.code = ReturnCode::invalid_argument;
+        status.message = "Cannot open file: " + path;
+        return status;
+    }
+    buffer_.assign(std::istreambuf_iterator<char>(file),
+                   std::istreambuf_iterator<char>());
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+    return status;
+}
+
+#endif /* MAPPEDFILE_H */
@@ -0,0 +1,150 @@
+/**
+ * @file MpmcQueue.h
+ */
+
+#ifndef MPMCQUEUE_H
+#define MPMCQUEUE_H
+
+/* system header files */
+#ifndef DOXYGEN_IGNORE
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#endif
+
+// Size of a cache line, which the producer and consumer positions of an
+// MpmcQueue are kept apart by.
+const size_t kCacheLineSize = 64;
+
+/**
+ * The MpmcQueue class is a bounded lock-free queue that any number of
+ * threads can push to and pop from at the same time (D. Vyukov's bounded
+ * MPMC queue). Every cell carries a sequence number telling whether it is
+ * ready to be written or read in the current lap, so a push or pop is one
+ * compare-and-swap on a position plus a store, without locks. Pushing to a
+ * full queue and popping from an empty one fail instead of waiting, and it
+ * is up to the caller how to wait (see DeriveService).
+ *
+ * Example usage:
+ *
+ * MpmcQueue<int> queue(1024);
+ * if (!queue.TryPush(42)) {
+ *     // full
+ * }
+ * int item;
+ * if (queue.TryPop(item)) {
+ *     ...
+ * }
+ */
+template <class U>
+class MpmcQueue {
+  private:
+    struct Cell {
+      std::atomic<size_t> sequence;
+      U item;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+
+    // Next position to push to and to pop from, padded onto lines of their
+    // own so producers and consumers do not invalidate each other's cache.
+    // Padding rather than alignas, which new only honors from C++17.
+    char padding_front_[kCacheLineSize];
+    std::atomic<size_t> tail_;
+    char padding_middle_[kCacheLineSize - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> head_;
+    char padding_back_[kCacheLineSize - sizeof(std::atomic<size_t>)];
+
+  public:
+    /**
+     * Constructor.
+     *
+     * @param capacity: the most items the queue can hold, rounded up to a
+     * power of two of at least 2. With a single cell the sequence number
+     * written by a push would read as free for the next push.
+     */
+    explicit MpmcQueue(size_t capacity) : tail_(0), head_(0) {
+        size_t size = 2;
+        while (size < capacity) {
+            size *= 2;
+        }
+        cells_.reset(new Cell[size]);
+        mask_ = size - 1;
+        for (size_t i = 0; i < size; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    /* getters */
+    size_t Capacity() const { return mask_ + 1; }
+
+    /**
+     * Pushes an item if the queue is not full.
+     *
+     * @param item: the item, moved from only on success.
+     * @returns: false if the queue is full.
+     */
+    bool TryPush(U&& item) {
+        size_t position = tail_.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells_[position & mask_];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            ptrdiff_t lap = static_cast<ptrdiff_t>(sequence - position);
+            if (lap == 0) {
+                // The cell is free in this lap, claim it.
+                if (tail_.compare_exchange_weak(position, position + 1,
+                                                std::memory_order_relaxed)) {
+                    cell.item = std::move(item);
+                    cell.sequence.store(position + 1,
+                                        std::memory_order_release);
+                    return true;
+                }
+            } else if (lap < 0) {
+                // The item of the previous lap has not been popped.
+                return false;
+            } else {
+                // Another producer claimed the cell first.
+                position = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * Pops the oldest item if the queue is not empty.
+     *
+     * @param item: set to the item on success.
+     * @returns: false if the queue is empty.
+     */
+    bool TryPop(U& item) {
+        size_t position = head_.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells_[position & mask_];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            ptrdiff_t lap = static_cast<ptrdiff_t>(sequence - (position + 1));
+            if (lap == 0) {
+                // The cell holds the item of this lap, claim it.
+                if (head_.compare_exchange_weak(position, position + 1,
+                                                std::memory_order_relaxed)) {
+                    item = std::move(cell.item);
+                    // Free for the push of the next lap.
+                    cell.sequence.store(position + mask_ + 1,
+                                        std::memory_order_release);
+                    return true;
+                }
+            } else if (lap < 0) {
+                // Nothing was pushed to the cell in this lap.
+                return false;
+            } else {
+                // Another consumer claimed the cell first.
+                position = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+#endif /* MPMCQUEUE_H */
@@ -0,0 +1,399 @@
+/**
+ * @file ParallelTape.h
+ */
+
+#ifndef PARALLELTAPE_H
+#define PARALLELTAPE_H
+
+/* header files */
+#include "ADNode.hpp"
+#include "Tape.hpp"
+
+/* system header files */
+#ifndef DOXYGEN_IGNORE
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#endif
+
+// Default smallest cost (see OperationCost) of the share of an instruction
+// level given to one thread. Levels cheaper than two such shares run on a
+// single thread, since splitting them costs more than it saves.
+const int kParallelChunkCost = 2048;
+
+/**
+ * Rough relative cost of an operation, used to balance the work given to
+ * each thread. Additions and products are 1, divisions and roots a few, and
+ * transcendental functions and general powers the most.
+ *
+ * @param op: the operation.
+ * @returns: the cost.
+ */
+inline int OperationCost(Operation op) {
+    switch (op) {
+      case Operation::addition :
+      case Operation::subtraction :
+      case Operation::multiplication :
+      case Operation::fma :
+      case Operation::square :
+        return 1;
+      case Operation::division :
+      case Operation::reciprocal :
+      case Operation::sqrt :
+        return 4;
+      default :
+        return 16;
+    }
+}
+
+/**
+ * The Barrier class blocks threads until a fixed number of them have arrived,
+ * after which it can be used again, as std::barrier (C++20).
+ */
+class Barrier {
+  private:
+    std::mutex mutex_;
+    std::condition_variable arrived_;
+
+    // Number of threads that wait on the barrier.
+    int count_;
+
+    // Number of threads still to arrive in this round.
+    int waiting_;
+
+    // Incremented each time every thread has arrived.
+    int generation_ = 0;
+
+  public:
+    /**
+     * Constructor.
+     *
+     * @param count: the number of threads that wait on the barrier.
+     */
+    explicit Barrier(int count) : count_(count), waiting_(count) {}
+
+    /**
+     * Blocks until all count threads have called Wait.
+     */
+    void Wait() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        int generation = generation_;
+        if (--waiting_ == 0) {
+            waiting_ = count_;
+            ++generation_;
+            arrived_.notify_all();
+            return;
+        }
+        arrived_.wait(lock, [&] { return generation != generation_; });
+    }
+};
+
+/**
+ * The ParallelTape class evaluates a single compiled tape on several threads.
+ * The instructions are levelized: the level of an instruction is one more than
+ * the highest level of the instructions it reads, so the instructions of a
+ * level are independent of each other and only read earlier levels. They are
+ * reordered level by level, and every level whose total cost (see
+ * OperationCost) is enough for at least two threads becomes a parallel stage,
+ * split into contiguous shares of equal cost, one per thread. Runs of cheaper
+ * levels are merged into serial stages run by one thread, so narrow parts of
+ * the expression (e.g., a long chain) cost no synchronization. Threads meet at
+ * a barrier after each stage.
+ *
+ * This pays off for very large expressions with wide levels, e.g., sums of
+ * many independent terms, and more so with expensive value types such as an
+ * ADValue with many derivatives. The tape must not reuse slots.
+ *
+ * Example usage:
+ *
+ * ParallelTape<double> parallel(tape);
+ * std::vector<double> slots = {1.5, 2.0};
+ * double value = parallel.Primal(slots, 8);
+ */
+template <class T>
+class ParallelTape {
+  private:
+    // A range of the levelized instructions run by one or all threads.
+    struct Stage {
+      int begin;
+      int end;
+      bool parallel;
+    };
+
+    // The tape, for its variables and constants.
+    Tape<T> tape_;
+
+    // The instructions of tape_, sorted by level.
+    std::vector<Instruction> instructions_;
+
+    // prefix_cost_[i] is the cost of the first i levelized instructions.
+    std::vector<long long> prefix_cost_;
+
+    std::vector<Stage> stages_;
+    int num_levels_ = 0;
+    int min_chunk_cost_;
+
+    /**
+     * Number of threads a stage is split between.
+     *
+     * @param stage: the stage.
+     * @param num_threads: the threads available.
+     * @returns: between 1 and num_threads.
+     */
+    int NumChunks(const Stage& stage, int num_threads) const;
+
+    /**
+     * First instruction of the share of a thread in a parallel stage, so that
+     * every share has about the same cost.
+     *
+     * @param stage: the stage.
+     * @param chunk: the share, up to num_chunks (giving the end of the stage).
+     * @param num_chunks: the number of shares.
+     * @returns: the index of the instruction.
+     */
+    int ChunkBegin(const Stage& stage, int chunk, int num_chunks) const;
+
+    /**
+     * Runs every stage on a number of threads.
+     *
+     * @param run: called as run(begin, end) to evaluate a range of the
+     * levelized instructions. Exceptions are rethrown on the calling thread
+     * once every thread has stopped.
+     * @param num_threads: the number of threads, including the caller.
+     */
+    template <class RangeFn>
+    void Run(RangeFn run, int num_threads) const;
+
+  public:
+    /**
+     * Constructor. Levelizes the tape and plans the stages.
+     *
+     * @param tape: the tape, copied. Throws a logic_error if it reuses slots.
+     * @param min_chunk_cost: the smallest cost of the share of one thread.
+     */
+    explicit ParallelTape(const Tape<T>& tape,
+                          int min_chunk_cost = kParallelChunkCost);
+
+    /* getters */
+    const Tape<T>& GetTape() const { return tape_; }
+    int NumLevels() const { return num_levels_; }
+    int NumStages() const { return stages_.size(); }
+    int NumParallelStages() const;
+
+    /**
+     * Gets a view of the levelized tape. Evaluating it on one thread gives the
+     * same results as the original tape.
+     *
+     * @returns: the view, valid while this ParallelTape lives.
+     */
+    TapeView<T> View() const {
+        return TapeView<T>(tape_.Variables().size(), tape_.Constants().data(),
+                           tape_.Constants().size(), instructions_.data(),
+                           instructions_.size(), tape_.Output(),
+                           tape_.NumSlots(), false);
+    }
+
+    /**
+     * Evaluates the tape with any value type, as Tape::Forward.
+     *
+     * @param slots: holds the value of each variable on entry. On exit it is
+     * resized to the number of slots and holds the value of every slot.
+     * @param constant: a callable converting a T constant to a value type.
+     * @param num_threads: the number of threads to use, including the caller.
+     * @returns: the value of the output slot.
+     */
+    template <class V, class ConstantFn>
+    V Forward(std::vector<V>& slots, ConstantFn constant,
+              int num_threads) const;
+
+    /**
+     * Evaluates the tape on plain values, as Tape::Primal.
+     *
+     * @param slots: holds the value of each variable on entry. On exit it is
+     * resized to the number of slots and holds the value of every slot.
+     * @param num_threads: the number of threads to use, including the caller.
+     * @returns: the value of the output slot.
+     */
+    T Primal(std::vector<T>& slots, int num_threads) const;
+};
+
+
+/* Implementation ParallelTape */
+
+template <class T>
+ParallelTape<T>::ParallelTape(const Tape<T>& tape, int min_chunk_cost)
+    : tape_(tape), min_chunk_cost_(std::max(1, min_chunk_cost)) {
+    if (tape.ReusesSlots()) {
+        throw std::logic_error(
+            "ParallelTape requires a tape without slot reuse.");
+    }
+    const std::vector<Instruction>& instructions = tape.Instructions();
+    int n = instructions.size();
+    // Level of the value in each slot, 0 for variables and constants.
+    std::vector<int> slot_level(tape.NumSlots(), 0);
+    std::vector<int> level(n);
+    for (int i = 0; i < n; ++i) {
+        const Instruction& ins = instructions[i];
+        int operands = slot_level[ins.lhs];
+        if (ins.rhs >= 0) {
+            operands = std::max(operands, slot_level[ins.rhs]);
+        }
+        if (ins.third >= 0) {
+            operands = std::max(operands, slot_level[ins.third]);
+        }
+        level[i] = operands + 1;
+        slot_level[ins.dst] = level[i];
+        num_levels_ = std::max(num_levels_, level[i]);
+    }
+
+    // Counting sort by level, keeping the tape order within a level.
+    std::vector<int> level_begin(num_levels_ + 2, 0);
+    for (int i = 0; i < n; ++i) {
+        ++level_begin[level[i] + 1];
+    }
+    for (int l = 1; l < level_begin.size(); ++l) {
+        level_begin[l] += level_begin[l - 1];
+    }
+    instructions_.resize(n);
+    std::vector<int> next(level_begin);
+    for (int i = 0; i < n; ++i) {
+        instructions_[next[level[i]]++] = instructions[i];
+    }
+    prefix_cost_.assign(n + 1, 0);
+    for (int i = 0; i < n; ++i) {
+        prefix_cost_[i + 1] = prefix_cost_[i] +
+                              OperationCost(instructions_[i].op);
+    }
+
+    // Wide levels become parallel stages, runs of narrow ones serial stages.
+    for (int l = 1; l <= num_levels_; ++l) {
+        int begin = level_begin[l];
+        int end = level_begin[l + 1];
+        bool parallel =
+            prefix_cost_[end] - prefix_cost_[begin] >= 2LL * min_chunk_cost_;
+        if (!parallel && !stages_.empty() && !stages_.back().parallel) {
+            stages_.back().end = end;
+        } else {
+            stages_.push_back(Stage{begin, end, parallel});
+        }
+    }
+}
+
+template <class T>
+int ParallelTape<T>::NumParallelStages() const {
+    int count = 0;
+    for (const Stage& stage : stages_) {
+        count += stage.parallel ? 1 : 0;
+    }
+    return count;
+}
+
+template <class T>
+int ParallelTape<T>::NumChunks(const Stage& stage, int num_threads) const {
+    if (!stage.parallel) {
+        return 1;
+    }
+    long long cost = prefix_cost_[stage.end] - prefix_cost_[stage.begin];
+    return std::max(1LL, std::min<long long>(num_threads,
+                                             cost / min_chunk_cost_));
+}
+
+template <class T>
+int ParallelTape<T>::ChunkBegin(const Stage& stage, int chunk,
+                                int num_chunks) const {
+    if (chunk == 0) {
+        return stage.begin;
+    }
+    if (chunk == num_chunks) {
+        return stage.end;
+    }
+    long long cost = prefix_cost_[stage.end] - prefix_cost_[stage.begin];
+    long long target = prefix_cost_[stage.begin] + cost * chunk / num_chunks;
+    return std::lower_bound(prefix_cost_.begin() + stage.begin,
+                            prefix_cost_.begin() + stage.end, target) -
+           prefix_cost_.begin();
+}
+
+template <class T>
+template <class RangeFn>
+void ParallelTape<T>::Run(RangeFn run, int num_threads) const {
+    int max_chunks = 1;
+    for (const Stage& stage : stages_) {
+        max_chunks = std::max(max_chunks, NumChunks(stage, num_threads));
+    }
+    num_threads = std::min(num_threads, max_chunks);
+    if (num_threads <= 1) {
+        run(0, static_cast<int>(instructions_.size()));
+        return;
+    }
+
+    Barrier barrier(num_threads);
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    std::atomic<bool> failed(false);
+    auto worker = [&](int thread) {
+        for (int s = 0; s < stages_.size(); ++s) {
+            const Stage& stage = stages_[s];
+            int chunks = NumChunks(stage, num_threads);
+            if (thread < chunks && !failed.load()) {
+                try {
+                    run(ChunkBegin(stage, thread, chunks),
+                        ChunkBegin(stage, thread + 1, chunks));
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                    failed.store(true);
+                }
+            }
+            // Every thread must reach every barrier, even after a failure.
+            if (s + 1 < stages_.size()) {
+                barrier.Wait();
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int t = 1; t < num_threads; ++t) {
+        threads.push_back(std::thread(worker, t));
+    }
+    worker(0);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+template <class T>
+template <class V, class ConstantFn>
+V ParallelTape<T>::Forward(std::vector<V>& slots, ConstantFn constant,
+                           int num_threads) const {
+    TapeView<T> view = View();
+    slots.resize(view.NumSlots());
+    for (int j = 0; j < view.NumConstants(); ++j) {
+        slots[view.NumVariables() + j] = constant(view.Constants()[j]);
+    }
+    Run([&](int begin, int end) { view.ForwardRange(slots, begin, end); },
+        num_threads);
+    return slots[view.Output()];
+}
+
+template <class T>
+T ParallelTape<T>::Primal(std::vector<T>& slots, int num_threads) const {
+    TapeView<T> view = View();
+    slots.resize(view.NumSlots());
+    std::copy(view.Constants(), view.Constants() + view.NumConstants(),
+              slots.begin() + view.NumVariables());
+    Run([&](int begin, int end) { view.PrimalRange(slots, begin, end); },
+        num_threads);
+    return slots[view.Output()];
+}
+
+#endif /* PARALLELTAPE_H */
@@ -8,12 +8,13 @@
 /* header files */
 #include "ADNode.hpp"
 #include "ADValue.hpp"
+#include "StringView.hpp"
 
 /* system header files */
 #ifndef DOXYGEN_IGNORE
 #include <algorithm>
+#include <array>
 #include <iostream>
-#include <set>
 #include <sstream>
 #include <string>
 #include <stack>
@@ -25,6 +26,7 @@
 enum class ReturnCode {
   success = 1,
   parse_error = 2,
+  invalid_argument = 3,
 };
 
 // Error handling object. If code != ReturnCode::success, then message will be
@@ -35,6 +37,99 @@ struct Status {
 };
 
 
+// A function name of the parenthesized syntax and its operation.
+struct Keyword {
+  const char* name;
+  size_t length;
+  Operation op;
+};
+
+// Every function name. Log is followed by its base, log_<base>_.
+const Keyword kKeywords[] = {
+    { "sin", 3, Operation::sin },
+    { "cos", 3, Operation::cos },
+    { "tan", 3, Operation::tan },
+    { "exp", 3, Operation::exp },
+    { "log", 3, Operation::log },
+    { "sinh", 4, Operation::sinh },
+    { "cosh", 4, Operation::cosh },
+    { "tanh", 4, Operation::tanh },
+    { "sqrt", 4, Operation::sqrt },
+    { "arcsin", 6, Operation::arcsin },
+    { "arccos", 6, Operation::arccos },
+    { "arctan", 6, Operation::arctan },
+    { "logistic", 8, Operation::logistic },
+};
+
+const int kNumKeywords = sizeof(kKeywords) / sizeof(kKeywords[0]);
+
+// Size of the keyword hash table, a power of two.
+const int kKeywordTableSize = 32;
+
+/**
+ * Hashes a word of at least 3 characters from its length, first character and
+ * third to last character. The constants were chosen so that no two keywords
+ * share a slot of the table, i.e., the hash is perfect over kKeywords.
+ *
+ * @param word: the word.
+ * @returns: the slot in the keyword table.
+ */
+inline int KeywordHash(StringView word) {
+    size_t n = word.size();
+    return (int)(n + 2 * (unsigned char)word[0] +
+                 15 * (unsigned char)word[n - 3]) & (kKeywordTableSize - 1);
+}
+
+/**
+ * Looks up a function name.
+ *
+ * @param word: the whole name (e.g., "sinh").
+ * @returns: the keyword, or nullptr if the word is not a function name.
+ */
+inline const Keyword* LookupKeyword(StringView word) {
+    // Slot to index in kKeywords, -1 if empty. Built once, then only read.
+    struct Table {
+      std::array<int, kKeywordTableSize> slots;
+      Table() {
+          slots.fill(-1);
+          for (int i = 0; i < kNumKeywords; ++i) {
+              slots[KeywordHash(kKeywords[i].name)] = i;
+          }
+      }
+    };
+    static const Table table;
+    if (word.size() < 3) {
+        return nullptr;
+    }
+    int index = table.slots[KeywordHash(word)];
+    if (index < 0 || word != StringView(kKeywords[index].name,
+                                        kKeywords[index].length)) {
+        return nullptr;
+    }
+    return &kKeywords[index];
+}
+
+/**
+ * Finds the longest function name that the group starts with, e.g., sinh
+ * rather than sin for "sinhx0".
+ *
+ * @param group: the contents of a group (e.g., "sinhx0").
+ * @returns: the keyword, or nullptr if the group does not start with one.
+ */
+inline const Keyword* MatchKeyword(StringView group) {
+    static const size_t lengths[] = { 8, 6, 4, 3 };
+    for (size_t length : lengths) {
+        if (group.size() >= length) {
+            const Keyword* keyword = LookupKeyword(group.substr(0, length));
+            if (keyword != nullptr) {
+                return keyword;
+            }
+        }
+    }
+    return nullptr;
+}
+
+
 /**
  * The Parser class handles most of the logic in the AutoDiffer library. The 
  * parser is constructed with a string representation of the function to derive
@@ -44,6 +139,10 @@ struct Status {
  * is to construct it with a string, call Init with the appropriate seed values
  * and then extract the result with a call to Run. The parser should not be used
  * by clients, and instead should only be used from an AutoDiffer object.
+ *
+ * The contents of each group are read through StringViews into the equation,
+ * and function names are found in a perfect hash table, so reading a group
+ * does not copy it.
  */
 template <class T>
 class Parser {
@@ -64,9 +163,12 @@ class Parser {
     // The size of the seed vector. This will be 1 for scalar functions.
     int seed_size_ = 1;
 
-    // The special characters representing the elementary operations that we
-    // parse for.
-    std::set<char> operations = { '+','^','-','/','*' };
+    // Buffer for looking up a key in values_, reused so a lookup does not
+    // allocate once it has grown to the longest key.
+    std::string key_;
+
+    // Stream for reading constants, reused for the same reason.
+    std::istringstream number_stream_;
 
     /**
      * Sets the cursors based on the deepest value of parentheses. This function
@@ -84,12 +186,22 @@ class Parser {
      * created (e.g., GetValue("x0") will fetch the first constructed 
      * intermediate value).
      *
-     * @param key: the string containing the id to be retrieved.
+     * @param key: the id to be retrieved.
      * @return: a pair with a status as the first object and an ADValue as the
      *          second. One should check that that Status.code == success
      *          before using the ADValue. 
      */
-    std::pair<Status,ADValue<T>> GetValue(const std::string& key);
+    std::pair<Status,ADValue<T>> GetValue(StringView key);
+
+    /**
+     * Finds a stored value (a seed or an intermediate) without trying to read
+     * the key as a constant.
+     *
+     * @param key: the name of the value (e.g., "x0").
+     * @return: an iterator into values_, values_.end() if not found.
+     */
+    typename std::unordered_map<std::string, ADValue<T>>::iterator
+    FindValue(StringView key);
 
     /**
      * Gets the index of the operation if it belongs to the single character
@@ -101,7 +213,7 @@ class Parser {
      * @param op: a refernce to an op that can be set if an operation is found.
      * @return: the index inside the sub_str of the op. 
      */
-    int GetOpIndex(const std::string& sub_str, Operation& op);
+    int GetOpIndex(StringView sub_str, Operation& op);
 
     /**
      * Handles any ops that are a single character (e.g., +,^,-,/,*).
@@ -120,13 +232,12 @@ class Parser {
      * @returns: a status containing either an success or failure with a message
      */
     Status HandleCharOps(ADValue<T>& left_val, ADValue<T>& right_val, 
-                         std::string sub_str, Operation& op, int op_index);
+                         StringView sub_str, Operation& op, int op_index);
 
     /**
      * Handles any ops that are not single character (e.g., sin, arcsin, ...).
-     * The function works by figuring out how many letters the operation has and
-     * delegating the processing to HandleThreeLetterOps, HandleFourLetterOps,
-     * HandleSixLetterOps, or HandleLogisticOp. The left and right ADValue 
+     * The function name is looked up with MatchKeyword, and a group without
+     * one is a lone value, evaluated as value + 0. The left and right ADValue 
      * references that are passed along with the operation reference will be set
      * by this function.  
      *
@@ -140,70 +251,21 @@ class Parser {
      * @returns: a status containing either an success or failure with a message
      */
     Status HandleStringOps(ADValue<T>& left_val, ADValue<T>& right_val, 
-                           std::string sub_str, Operation& op);
+                           StringView sub_str, Operation& op);
 
     /**
-     * Handles any 3 letter ops (sin, cos, tan, exp, log). Called by 
-     * HandleStringOps.
+     * Handles log, which carries its base in the group: log_<base>_<argument>.
+     * Called by HandleStringOps.
      *
      * @param left_val: a reference to the left value of the ADNode. This will
-     * be updated.
-     * @param right_val: a reference to the right value. In unary operations,
-     * this will be set to 0.
-     * @param sub_str: the current substring within the left and right cursor.
-     * @param op: a reference to the outer operation that will be set by this
-     * function.
-     * @returns: a status containing either an success or failure with a message
-     */
-    Status HandleThreeLetterOps(ADValue<T>& left_val, ADValue<T>& right_val, 
-                                std::string sub_str, Operation& op);  
-    
-    /**
-     * Handles any 4 letter ops (sinh, cosh, tanh, sqrt). Called by 
-     * HandleStringOps.
-     *
-     * @param left_val: a reference to the left value of the ADNode. This will
-     * be updated.
-     * @param right_val: a reference to the right value. In unary operations,
-     * this will be set to 0.
+     * be set to the argument.
+     * @param right_val: a reference to the right value. This will be set to
+     * the base.
      * @param sub_str: the current substring within the left and right cursor.
-     * @param op: a reference to the outer operation that will be set by this
-     * function.
      * @returns: a status containing either an success or failure with a message
      */
-    Status HandleFourLetterOps(ADValue<T>& left_val, ADValue<T>& right_val, 
-                               std::string sub_str, Operation& op);
-    
-    /**
-     * Handles any 6 letter ops (arcsin, arccos, arctan). Called by 
-     * HandleStringOps.
-     *
-     * @param left_val: a reference to the left value of the ADNode. This will
-     * be updated.
-     * @param right_val: a reference to the right value. In unary operations,
-     * this will be set to 0.
-     * @param sub_str: the current substring within the left and right cursor.
-     * @param op: a reference to the outer operation that will be set by this
-     * function.
-     * @returns: a status containing either an success or failure with a message
-     */
-    Status HandleSixLetterOps(ADValue<T>& left_val, ADValue<T>& right_val, 
-                               std::string sub_str, Operation& op);
-    
-    /**
-     * Handles the logistic operation. Called by HandleStringOps.
-     *
-     * @param left_val: a reference to the left value of the ADNode. This will
-     * be updated.
-     * @param right_val: a reference to the right value. In unary operations,
-     * this will be set to 0.
-     * @param sub_str: the current substring within the left and right cursor.
-     * @param op: a reference to the outer operation that will be set by this
-     * function.
-     * @returns: a status containing either an success or failure with a message
-     */
-    Status HandleLogisticOp(ADValue<T>& left_val, ADValue<T>& right_val, 
-                            std::string sub_str, Operation& op);
+    Status HandleLogOp(ADValue<T>& left_val, ADValue<T>& right_val, 
+                       StringView sub_str);
 
     /**
      * Checks if an argument to a string operations (e.g., sin) is valid.
@@ -219,8 +281,8 @@ class Parser {
      */
     Status CheckValidArgument(ADValue<T>& left_val, 
                               ADValue<T>& right_val, 
-                              const std::string& op_name, 
-                              const std::string& sub_str);
+                              StringView op_name, 
+                              StringView sub_str);
 
     /**
      * Evaluate the current part of the equation that is within the left and 
@@ -341,39 +403,30 @@ Status Parser<T>::Init(
 }
 
 template <class T> 
-int Parser<T>::GetOpIndex(const std::string& sub_str, Operation& op) {
-    int op_index = -1;
-    // Iterate sub_str until an op character is found. If none retrun -1.
-    for (int i = 0; i < sub_str.length(); ++i) {
-        std::set<char>::iterator it = operations.find(sub_str[i]);
-        if (it != operations.end()) {
-            char op_char = *it;
-            if (op_char == '+') {
-                op = Operation::addition;
-            } else if (op_char == '^') {
-                op = Operation::power;
-            } else if (op_char == '-') {
-                op = Operation::subtraction;
-            } else if (op_char == '/') {
-                op = Operation::division;
-            } else if (op_char == '*') {
-                op = Operation::multiplication;
-            }
-            op_index = i;
-            break;
-        }
+int Parser<T>::GetOpIndex(StringView sub_str, Operation& op) {
+    // The first op character wins. If none return -1.
+    size_t op_index = sub_str.find_first_of("+^-/*");
+    if (op_index == StringView::npos) {
+        return -1;
+    }
+    switch (sub_str[op_index]) {
+      case '+' : op = Operation::addition; break;
+      case '^' : op = Operation::power; break;
+      case '-' : op = Operation::subtraction; break;
+      case '/' : op = Operation::division; break;
+      default : op = Operation::multiplication; break;
     }
     return op_index;
 }
 
 template <class T>
 Status Parser<T>::HandleCharOps(ADValue<T>& left_val, ADValue<T>& right_val, 
-                                std::string sub_str, Operation& op, 
+                                StringView sub_str, Operation& op, 
                                 int op_index) {
     Status status;
     // Operations including negation, + , - , ^, *
-    std::string LHS = sub_str.substr(0,op_index);
-    std::string RHS = sub_str.substr(op_index+1);
+    StringView LHS = sub_str.substr(0,op_index);
+    StringView RHS = sub_str.substr(op_index+1);
     
     // Get value of variable or constant for RHS.
     auto res_right = GetValue(RHS);
@@ -405,12 +458,13 @@ Status Parser<T>::HandleCharOps(ADValue<T>& left_val, ADValue<T>& right_val,
 
 template <class T>
 Status Parser<T>::HandleStringOps(ADValue<T>& left_val, ADValue<T>& right_val, 
-                                  std::string sub_str, Operation& op) {
-    Status status;
-    // Check if trig function
-    // deal with (x)
-    if (sub_str.length() <= 3) {
-        // All of the alpha functions are three letters or more.
+                                  StringView sub_str, Operation& op) {
+    // All of the alpha functions are three letters or more, and need an
+    // argument after the name.
+    const Keyword* keyword = sub_str.length() > 3 ?
+        MatchKeyword(sub_str) : nullptr;
+    if (keyword == nullptr) {
+        // No alpha operation, deal with (x). Try to cast as into type T.
         auto value_cast_pair = GetValue(sub_str); 
         if (value_cast_pair.first.code != ReturnCode::success) {
             return value_cast_pair.first; 
@@ -418,68 +472,28 @@ Status Parser<T>::HandleStringOps(ADValue<T>& left_val, ADValue<T>& right_val,
         left_val = value_cast_pair.second; 
         right_val = GetValue("0").second;
         op = Operation::addition; 
-    } else {
-        // Get each of the potential sub strings.
-        std::string three_letter = sub_str.substr(0,3);
-        std::string four_letter = sub_str.substr(0,4);
-        std::string six_letter = sub_str.substr(0,6);
-        std::string eight_letter = sub_str.substr(0,8); 
-
-        // These are the operations that we support.
-        std::vector<std::string> four_letter_ops = {
-            "sinh", "cosh", "tanh", "sqrt"};
-        std::vector<std::string> three_letter_ops = {
-            "sin", "cos", "tan", "exp", "log"};
-        std::vector<std::string> six_letter_ops = {
-            "arcsin", "arccos", "arctan"};
-        
-        // Logistic is the only 8 letter op.
-        if (eight_letter.compare("logistic") == 0) {
-            return HandleLogisticOp(left_val, right_val, sub_str, op);
-        }
-        // Check if the four letter op is supported. This must come before the
-        // three letter checks to avoid confusion between sin and sinh.
-        if (std::find(four_letter_ops.begin(), 
-                      four_letter_ops.end(), 
-                      four_letter) != four_letter_ops.end()) {
-            return HandleFourLetterOps(left_val, right_val, sub_str, op);
-        }
-        // Check if the six letter op is supported.
-        if (std::find(six_letter_ops.begin(), 
-                      six_letter_ops.end(), 
-                      six_letter) != six_letter_ops.end()) {
-            return HandleSixLetterOps(left_val, right_val, sub_str, op);
-        }
-        // Check if the three letter op is supported.
-        if (std::find(three_letter_ops.begin(), 
-                      three_letter_ops.end(), 
-                      three_letter) != three_letter_ops.end()) {
-            return HandleThreeLetterOps(left_val, right_val, sub_str, op);
-        }
-    
-        // sub_str > 3, no alpha operation. Try to cast as into type T.
-        auto value_cast_pair = GetValue(sub_str); 
-        if (value_cast_pair.first.code != ReturnCode::success) {
-            return value_cast_pair.first; 
-        }
-        left_val = value_cast_pair.second; 
-        right_val = GetValue("0").second;
-        op = Operation::addition;                            
-    } 
-    return status;
+        return value_cast_pair.first;
+    }
+    op = keyword->op;
+    if (op == Operation::log) {
+        return HandleLogOp(left_val, right_val, sub_str);
+    }
+    return CheckValidArgument(left_val, right_val,
+                              StringView(keyword->name, keyword->length),
+                              sub_str);
 }
 
 template <class T>
 Status Parser<T>::CheckValidArgument(ADValue<T>& left_val, 
                                      ADValue<T>& right_val, 
-                                     const std::string& op_name,
-                                     const std::string& sub_str) {
+                                     StringView op_name,
+                                     StringView sub_str) {
     Status status;
     // Check if the argument is found in the table.
-    auto stored_val = values_.find(sub_str.substr(op_name.length())); 
+    auto stored_val = FindValue(sub_str.substr(op_name.length())); 
     if (stored_val == values_.end()) {
         status.code = ReturnCode::parse_error; 
-        status.message = "Invalid argument to " + op_name; 
+        status.message = "Invalid argument to " + op_name.ToString(); 
         return status; 
     }
     // Initialize right val to zero because it will not be used by unary ops.
@@ -489,93 +503,34 @@ Status Parser<T>::CheckValidArgument(ADValue<T>& left_val,
 }
 
 template <class T>
-Status Parser<T>::HandleThreeLetterOps(ADValue<T>& left_val, 
-                                       ADValue<T>& right_val, 
-                                       std::string sub_str, 
-                                       Operation& op) {
+Status Parser<T>::HandleLogOp(ADValue<T>& left_val, ADValue<T>& right_val, 
+                              StringView sub_str) {
     Status status;
-    std::string three_letter = sub_str.substr(0,3);
-    if (three_letter.compare("sin") == 0) {
-        op = Operation::sin;
-        return CheckValidArgument(left_val, right_val, "sin", sub_str);
-    } else if (three_letter.compare("cos") == 0) {
-        op = Operation::cos;
-        return CheckValidArgument(left_val, right_val, "cos", sub_str);
-    } else if (three_letter.compare("tan") == 0) {
-        op = Operation::tan; 
-        return CheckValidArgument(left_val, right_val, "tan", sub_str);
-    } else if (three_letter.compare("exp") == 0) {
-        op = Operation::exp; 
-        return CheckValidArgument(left_val, right_val, "exp", sub_str);
-    } else /* Must be log. */{
-        // Log is more complicated because we need to parse the base.
-        op = Operation::log;
-        int right_marker = sub_str.substr(4).find('_');
-        // Get base.
-        right_val = GetValue(
-            sub_str.substr(4, right_marker)).second;
-        auto stored_val = values_.find(
-            sub_str.substr(4+right_marker+1)); 
-        if (stored_val == values_.end()) {
-            status.code = ReturnCode::parse_error; 
-            status.message = "Invalid argument to log"; 
-            return status; 
-        }
-        left_val = stored_val->second;
-    }
-    return status; 
-}
-
-template <class T>
-Status Parser<T>::HandleFourLetterOps(ADValue<T>& left_val, 
-                                      ADValue<T>& right_val, 
-                                      std::string sub_str, 
-                                      Operation& op) {
-    std::string four_letter = sub_str.substr(0,4);
-    if (four_letter.compare("sinh") == 0) {
-        op = Operation::sinh; 
-        return CheckValidArgument(left_val, right_val, "sinh", sub_str);
-    } else if (four_letter.compare("cosh") == 0) {
-        op = Operation::cosh; 
-        return CheckValidArgument(left_val, right_val, "cosh", sub_str);               
-    } else if (four_letter.compare("tanh") == 0) {
-        op = Operation::tanh; 
-        return CheckValidArgument(left_val, right_val, "tanh", sub_str);               
-    } else /* Must be sqrt. */ {
-        op = Operation::sqrt; 
-        return CheckValidArgument(left_val, right_val, "sqrt", sub_str);                
+    // Log is more complicated because we need to parse the base.
+    size_t right_marker = sub_str.find('_', 4);
+    if (right_marker == StringView::npos) {
+        status.code = ReturnCode::parse_error; 
+        status.message = "Invalid argument to log"; 
+        return status; 
     }
-}
-
-template <class T>
-Status Parser<T>::HandleSixLetterOps(ADValue<T>& left_val, 
-            ADValue<T>& right_val, std::string sub_str, Operation& op) {
-    std::string inv_trig_str = sub_str.substr(0,6);
-    if (inv_trig_str.compare("arcsin") == 0) {
-        op = Operation::arcsin; 
-        return CheckValidArgument(left_val, right_val, "arcsin", sub_str);
-    } else if (inv_trig_str.compare("arccos") == 0) {
-        op = Operation::arccos; 
-        return CheckValidArgument(left_val, right_val, "arccos", sub_str);
-    } else /* Must be arctan. */ {
-        op = Operation::arctan; 
-        return CheckValidArgument(left_val, right_val, "arctan", sub_str);
+    // Get base.
+    right_val = GetValue(sub_str.substr(4, right_marker - 4)).second;
+    auto stored_val = FindValue(sub_str.substr(right_marker + 1)); 
+    if (stored_val == values_.end()) {
+        status.code = ReturnCode::parse_error; 
+        status.message = "Invalid argument to log"; 
+        return status; 
     }
-}
-
-template <class T>
-Status Parser<T>::HandleLogisticOp(ADValue<T>& left_val, ADValue<T>& right_val, 
-                                   std::string sub_str, Operation& op) {
-    op = Operation::logistic; 
-    return CheckValidArgument(left_val, right_val, "logistic", sub_str);
+    left_val = stored_val->second;
+    return status; 
 }
 
 template <class T>
 Status Parser<T>::Next() {
     Status status;
     // We only focus on the part of the equation between the left and right 
-    // cursor.
-    std::string sub_str = equation_.substr(
+    // cursor. The view is only used before equation_ is modified below.
+    StringView sub_str = StringView(equation_).substr(
         left_cursor_+1, right_cursor_ - (left_cursor_+1));
     Operation op;
     int op_index = GetOpIndex(sub_str, op);
@@ -608,12 +563,9 @@ Status Parser<T>::Next() {
     std::string new_val_name = 'x' + std::to_string(v_idx_++);
     values_[new_val_name] = cur_value;
 
-    // Replace the old cursor contents with just this new value name.
-    std::string new_str = equation_.replace(
+    // Replace the old cursor contents with just this new value name, in place.
+    equation_.replace(
         left_cursor_, right_cursor_ - left_cursor_ + 1, new_val_name);
-    
-    // Update equation.
-    equation_ = new_str;
     if (!SetCursor()) {
         return status;
     }
@@ -621,27 +573,35 @@ Status Parser<T>::Next() {
 }
 
 template <class T>
-std::pair<Status,ADValue<T>> Parser<T>::GetValue(const std::string& key) {
+typename std::unordered_map<std::string, ADValue<T>>::iterator
+Parser<T>::FindValue(StringView key) {
+    key_.assign(key.data(), key.size());
+    return values_.find(key_);
+}
+
+template <class T>
+std::pair<Status,ADValue<T>> Parser<T>::GetValue(StringView key) {
     Status status;
     // Check for empty key.
     if (key.empty()) {
         return std::pair<Status, ADValue<T>>(status, ADValue<T>(0, 0));
     }
-    auto it = values_.find(key);
+    auto it = FindValue(key);
     // Look in values table for key
     if (it != values_.end()) {
-        return std::pair<Status, ADValue<T>>(status, values_[key]);
+        return std::pair<Status, ADValue<T>>(status, it->second);
     }
 
     // Key is not in table, so try to cast the string to type T through use of
     // stringstream.
-    std::istringstream ss(key);
+    number_stream_.clear();
+    number_stream_.str(key_);
     T num;
-    ss >> num;
+    number_stream_ >> num;
     // Casting failed.
-    if (!ss.eof() || ss.fail()){
+    if (!number_stream_.eof() || number_stream_.fail()){
         status.code = ReturnCode::parse_error;
-        status.message = "Key not found: " + key;
+        status.message = "Key not found: " + key_;
         return std::pair<Status, ADValue<T>>(status, ADValue<T>(0,0));
     }
     std::vector<T> zeros(seed_size_, 0);
@@ -661,8 +621,7 @@ bool Parser<T>::SetCursor() {
             if (depth > max_depth) {
                 max_depth = depth;
                 left_cursor_ = i;
-                right_cursor_ = left_cursor_ + equation_.substr(
-                    left_cursor_).find(')');
+                right_cursor_ = equation_.find(')', left_cursor_);
             }
         } else if (equation_[i] == ')') {
             depth -= 1;
@@ -0,0 +1,250 @@
+/**
+ * @file PassManager.h
+ */
+
+#ifndef PASSMANAGER_H
+#define PASSMANAGER_H
+
+/* header files */
+#include "ADNode.hpp"
+#include "Parser.hpp"
+#include "Tape.hpp"
+#include "TapePasses.hpp"
+
+/* system header files */
+#ifndef DOXYGEN_IGNORE
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+#endif
+
+// Statistics of one pass of a PassManager run.
+struct PassStats {
+  std::string name;
+  int ops_before = 0;
+  int ops_after = 0;
+  // Slots used by the tape after the pass.
+  int slots_after = 0;
+  double seconds = 0;
+  // Listing of the tape after the pass, empty unless dumping is enabled.
+  std::string dump;
+};
+
+/**
+ * The PassManager runs an ordered pipeline of optimization passes over a
+ * compiled tape. Passes are added by name and run in the order they were
+ * added. Each one can be disabled without changing the order, and every run
+ * records the op count and time of each pass, and optionally a dump of the
+ * tape after it. This lets the cost of compiling be traded against the speed
+ * of evaluation: an expression evaluated once can use an empty pipeline,
+ * while a hot one can use every pass.
+ *
+ * The built in passes are:
+ *  - "canonicalize": canonical operand order and layout (Canonicalize).
+ *  - "fold": constant folding and identities (FoldConstants).
+ *  - "strength_reduce": integer powers to multiplications (StrengthReduce).
+ *  - "cse": common subexpression elimination.
+ *  - "fuse": fused ops such as fma and square (FuseOperations).
+ *  - "dce": dead code elimination.
+ *  - "liveness": slot reuse (Tape::ReuseSlots). The tape then only supports
+ *    forward sweeps, so this should be the last pass.
+ *
+ * Example usage:
+ *
+ * PassManager<double> passes;
+ * passes.AddPass("fold");
+ * passes.AddPass("dce");
+ * passes.SetDump(true);
+ * passes.Run(tape);
+ * for (const PassStats& stats : passes.Stats()) {
+ *     std::cout << stats.name << " " << stats.ops_after << std::endl;
+ * }
+ */
+template <class T>
+class PassManager {
+  private:
+    struct Pass {
+      std::string name;
+      std::function<void(Tape<T>&)> run;
+      bool enabled;
+    };
+
+    // The pipeline, in order.
+    std::vector<Pass> passes_;
+
+    // Whether to dump the tape after each pass.
+    bool dump_ = false;
+
+    // Statistics of the last run, one entry per enabled pass.
+    std::vector<PassStats> stats_;
+
+    /**
+     * Looks up a built in pass.
+     *
+     * @param name: the name of the pass (e.g., "fold").
+     * @param run: set to the pass.
+     * @returns: false if there is no built in pass with that name.
+     */
+    static bool BuiltinPass(const std::string& name,
+                            std::function<void(Tape<T>&)>& run);
+
+  public:
+    PassManager() {}
+
+    /**
+     * The default pipeline: fold, strength_reduce, cse, fuse and dce. It keeps
+     * every intermediate, so the tape can still be swept in reverse.
+     *
+     * @returns: a PassManager with the default pipeline.
+     */
+    static PassManager<T> Default();
+
+    /**
+     * Appends a built in pass to the pipeline.
+     *
+     * @param name: the name of the pass (e.g., "cse").
+     * @returns: an invalid_argument status if there is no such pass.
+     */
+    Status AddPass(const std::string& name);
+
+    /**
+     * Appends a custom pass to the pipeline.
+     *
+     * @param name: the name reported in the statistics.
+     * @param run: the pass, rewriting the tape in place.
+     */
+    void AddPass(const std::string& name, std::function<void(Tape<T>&)> run) {
+        passes_.push_back(Pass{name, run, true});
+    }
+
+    /**
+     * Enables or disables every pass with the given name.
+     *
+     * @param name: the name of the pass.
+     * @param enabled: whether the pass runs.
+     * @returns: an invalid_argument status if no pass has that name.
+     */
+    Status SetEnabled(const std::string& name, bool enabled);
+
+    /**
+     * Removes every pass from the pipeline.
+     */
+    void Clear() { passes_.clear(); }
+
+    /* setters */
+    void SetDump(bool dump) { dump_ = dump; }
+
+    /* getters */
+    std::vector<std::string> Passes() const;
+    const std::vector<PassStats>& Stats() const { return stats_; }
+
+    /**
+     * Runs the enabled passes in order.
+     *
+     * @param tape: the tape to optimize.
+     */
+    void Run(Tape<T>& tape);
+};
+
+
+/* Implementation PassManager */
+
+template <class T>
+bool PassManager<T>::BuiltinPass(const std::string& name,
+                                 std::function<void(Tape<T>&)>& run) {
+    if (name == "canonicalize") {
+        run = Canonicalize<T>;
+    } else if (name == "fold") {
+        run = FoldConstants<T>;
+    } else if (name == "strength_reduce") {
+        run = StrengthReduce<T>;
+    } else if (name == "cse") {
+        run = EliminateCommonSubexpressions<T>;
+    } else if (name == "fuse") {
+        run = FuseOperations<T>;
+    } else if (name == "dce") {
+        run = EliminateDeadCode<T>;
+    } else if (name == "liveness") {
+        run = [](Tape<T>& tape) { tape.ReuseSlots(); };
+    } else {
+        return false;
+    }
+    return true;
+}
+
+template <class T>
+PassManager<T> PassManager<T>::Default() {
+    PassManager<T> passes;
+    passes.AddPass("fold");
+    passes.AddPass("strength_reduce");
+    passes.AddPass("cse");
+    passes.AddPass("fuse");
+    passes.AddPass("dce");
+    return passes;
+}
+
+template <class T>
+Status PassManager<T>::AddPass(const std::string& name) {
+    Status status;
+    std::function<void(Tape<T>&)> run;
+    if (!BuiltinPass(name, run)) {
+        status.code = ReturnCode::invalid_argument;
+        status.message = "Unknown pass: " + name;
+        return status;
+    }
+    AddPass(name, run);
+    return status;
+}
+
+template <class T>
+Status PassManager<T>::SetEnabled(const std::string& name, bool enabled) {
+    Status status;
+    bool found = false;
+    for (Pass& pass : passes_) {
+        if (pass.name == name) {
+            pass.enabled = enabled;
+            found = true;
+        }
+    }
+    if (!found) {
+        status.code = ReturnCode::invalid_argument;
+        status.message = "Unknown pass: " + name;
+    }
+    return status;
+}
+
+template <class T>
+std::vector<std::string> PassManager<T>::Passes() const {
+    std::vector<std::string> names;
+    for (const Pass& pass : passes_) {
+        names.push_back(pass.name);
+    }
+    return names;
+}
+
+template <class T>
+void PassManager<T>::Run(Tape<T>& tape) {
+    stats_.clear();
+    for (const Pass& pass : passes_) {
+        if (!pass.enabled) {
+            continue;
+        }
+        PassStats stats;
+        stats.name = pass.name;
+        stats.ops_before = tape.Instructions().size();
+        auto start = std::chrono::steady_clock::now();
+        pass.run(tape);
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        stats.seconds = elapsed.count();
+        stats.ops_after = tape.Instructions().size();
+        stats.slots_after = tape.NumSlots();
+        if (dump_) {
+            stats.dump = tape.Dump();
+        }
+        stats_.push_back(stats);
+    }
+}
+
+#endif /* PASSMANAGER_H */
@@ -0,0 +1,158 @@
+/**
+ * @file StringView.h
+ */
+
+#ifndef STRINGVIEW_H
+#define STRINGVIEW_H
+
+/* system header files */
+#ifndef DOXYGEN_IGNORE
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#endif
+
+
+/**
+ * The StringView class is a non-owning, read-only view of a range of
+ * characters, a small stand in for std::string_view, which is not available in
+ * C++11. It lets the parsers look at parts of an equation without copying
+ * them. The member names follow std::string_view so it can be replaced by it
+ * later. A view does not keep its buffer alive, so it must not outlive the
+ * string it was taken from, nor be used after that string is modified.
+ *
+ * Example usage:
+ *
+ * std::string equation = "(sinx0)";
+ * StringView group = StringView(equation).substr(1, 5); // "sinx0"
+ * assert(group.substr(0, 3) == "sin");
+ */
+class StringView {
+  private:
+    // First character of the view.
+    const char* data_;
+
+    // Number of characters in the view.
+    size_t size_;
+
+  public:
+    // Returned by find when nothing is found, as std::string::npos. An
+    // enumerator rather than a static member, which would need a definition
+    // outside the header once it is bound to a reference.
+    enum : size_t { npos = static_cast<size_t>(-1) };
+
+    /**
+     * Default constructor. An empty view.
+     */
+    StringView() : data_(nullptr), size_(0) {}
+
+    /**
+     * Constructor from a pointer and a length.
+     *
+     * @param data: the first character.
+     * @param size: the number of characters.
+     */
+    StringView(const char* data, size_t size) : data_(data), size_(size) {}
+
+    /**
+     * Constructor from a null terminated string (e.g., a literal).
+     *
+     * @param str: the string.
+     */
+    StringView(const char* str) : data_(str), size_(strlen(str)) {}
+
+    /**
+     * Constructor from a std::string. The view is invalidated when the string
+     * is modified or destroyed.
+     *
+     * @param str: the string.
+     */
+    StringView(const std::string& str) : data_(str.data()), size_(str.size()) {}
+
+    /* getters */
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    size_t length() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    char operator[](size_t i) const { return data_[i]; }
+    const char* begin() const { return data_; }
+    const char* end() const { return data_ + size_; }
+
+    /**
+     * Gets a view of part of this view.
+     *
+     * @param pos: the first character, at most size().
+     * @param count: the number of characters, clamped to the end of the view.
+     * @returns: the view, pointing into the same buffer.
+     */
+    StringView substr(size_t pos, size_t count = npos) const {
+        if (pos > size_) {
+            throw std::out_of_range("StringView::substr");
+        }
+        size_t rest = size_ - pos;
+        return StringView(data_ + pos, count < rest ? count : rest);
+    }
+
+    /**
+     * Finds the first occurrence of a character.
+     *
+     * @param c: the character.
+     * @param pos: where to start looking.
+     * @returns: the index of the character, or npos.
+     */
+    size_t find(char c, size_t pos = 0) const {
+        for (size_t i = pos; i < size_; ++i) {
+            if (data_[i] == c) {
+                return i;
+            }
+        }
+        return npos;
+    }
+
+    /**
+     * Finds the first occurrence of any of a set of characters.
+     *
+     * @param chars: the characters, null terminated.
+     * @param pos: where to start looking.
+     * @returns: the index of the character, or npos.
+     */
+    size_t find_first_of(const char* chars, size_t pos = 0) const {
+        for (size_t i = pos; i < size_; ++i) {
+            if (strchr(chars, data_[i]) != nullptr && data_[i] != '\0') {
+                return i;
+            }
+        }
+        return npos;
+    }
+
+    /**
+     * Whether the view begins with a prefix.
+     *
+     * @param prefix: the prefix.
+     * @returns: true if the first characters are the prefix.
+     */
+    bool starts_with(StringView prefix) const {
+        return prefix.size_ <= size_ &&
+               (prefix.size_ == 0 ||
+                memcmp(data_, prefix.data_, prefix.size_) == 0);
+    }
+
+    /**
+     * Copies the characters into a new string. This allocates, so it is meant
+     * for error messages and other cold paths.
+     *
+     * @returns: the string.
+     */
+    std::string ToString() const { return std::string(data_, size_); }
+};
+
+inline bool operator==(StringView lhs, StringView rhs) {
+    return lhs.size() == rhs.size() &&
+           (lhs.empty() || memcmp(lhs.data(), rhs.data(), lhs.size()) == 0);
+}
+
+inline bool operator!=(StringView lhs, StringView rhs) {
+    return !(lhs == rhs);
+}
+
+#endif /* STRINGVIEW_H */
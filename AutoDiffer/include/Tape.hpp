@@ -0,0 +1,1017 @@
+/**
+ * @file Tape.h
+ */
+
+#ifndef TAPE_H
+#define TAPE_H
+
+/* header files */
+#include "ADNode.hpp"
+#include "ADValue.hpp"
+#include "Parser.hpp"
+
+/* system header files */
+#ifndef DOXYGEN_IGNORE
+#include <algorithm>
+#include <cctype>
+#include <limits>
+#include <map>
+#include <math.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#endif
+
+// A single instruction of a compiled tape. The result of applying op to the
+// values in slots lhs (and rhs) is written to slot dst. For unary ops rhs is
+// -1. For log, lhs is the argument and rhs is the base (as in ADNode). third
+// is the addend of fma and -1 for every other op.
+struct Instruction {
+  Operation op;
+  int dst;
+  int lhs;
+  int rhs;
+  int third;
+};
+
+/**
+ * Name of an operation, as used by Tape::Dump.
+ *
+ * @param op: the operation.
+ * @returns: the lower case name (e.g., "multiplication").
+ */
+inline const char* OperationName(Operation op) {
+    switch (op) {
+      case Operation::addition : return "addition";
+      case Operation::subtraction : return "subtraction";
+      case Operation::multiplication : return "multiplication";
+      case Operation::division : return "division";
+      case Operation::power : return "power";
+      case Operation::sin : return "sin";
+      case Operation::cos : return "cos";
+      case Operation::tan : return "tan";
+      case Operation::exp : return "exp";
+      case Operation::arcsin : return "arcsin";
+      case Operation::arccos : return "arccos";
+      case Operation::arctan : return "arctan";
+      case Operation::sinh : return "sinh";
+      case Operation::cosh : return "cosh";
+      case Operation::tanh : return "tanh";
+      case Operation::logistic : return "logistic";
+      case Operation::log : return "log";
+      case Operation::sqrt : return "sqrt";
+      case Operation::fma : return "fma";
+      case Operation::square : return "square";
+      case Operation::reciprocal : return "reciprocal";
+      case Operation::ipow : return "ipow";
+      case Operation::expneg : return "expneg";
+      case Operation::loglogistic : return "loglogistic";
+    }
+    return "unknown";
+}
+
+// Hash of an (op, lhs, rhs, third) key, used to find instructions that
+// compute the same value.
+struct OperandsHash {
+  size_t operator()(const std::tuple<Operation, int, int, int>& key) const {
+      size_t h = static_cast<size_t>(std::get<0>(key));
+      h = h * 1000003 ^ static_cast<size_t>(std::get<1>(key));
+      h = h * 1000003 ^ static_cast<size_t>(std::get<2>(key));
+      h = h * 1000003 ^ static_cast<size_t>(std::get<3>(key));
+      return h;
+  }
+};
+
+template <class T>
+class Tape;
+
+template <class T>
+class MappedTape;
+
+/**
+ * The TapeBuilder incrementally assembles a Tape. Variables, constants and
+ * instructions are all referred to by node ids handed out by the builder, and
+ * Build() lays them out as slots in the order [variables][constants][results].
+ * Variables and constants are deduplicated so that every name or literal has
+ * exactly one slot. With hash consing enabled, instructions are deduplicated
+ * too, so repeated subexpressions are stored once and the size of the builder
+ * is bounded by the expression DAG rather than the length of the equation.
+ */
+template <class T>
+class TapeBuilder {
+  private:
+    enum class NodeKind { variable, constant, instruction };
+
+    // Kind and per-kind index of every node handed out so far.
+    std::vector<std::pair<NodeKind, int>> nodes_;
+
+    // Variable names in order of first appearance.
+    std::vector<std::string> variables_;
+    std::unordered_map<std::string, int> variable_nodes_;
+
+    // Constant pool.
+    std::vector<T> constants_;
+    std::map<T, int> constant_nodes_;
+
+    // Instructions with lhs/rhs holding node ids (dst is unused until Build).
+    std::vector<Instruction> instructions_;
+
+    // Whether Emit reuses an identical earlier instruction.
+    bool hash_consing_ = false;
+
+    // Node of each (op, operands) emitted so far, when hash consing.
+    std::unordered_map<std::tuple<Operation, int, int, int>, int, OperandsHash>
+        instruction_nodes_;
+
+  public:
+    TapeBuilder() {}
+
+    /**
+     * Enables or disables hash consing. With it, emitting an instruction that
+     * was already emitted, up to the order of the operands of + and *, returns
+     * the earlier node, as EliminateCommonSubexpressions would.
+     *
+     * @param hash_consing: whether to deduplicate instructions.
+     */
+    void SetHashConsing(bool hash_consing) { hash_consing_ = hash_consing; }
+
+    /* getters */
+    int NumNodes() const { return nodes_.size(); }
+
+    /**
+     * Gets the node for a named input variable, creating it if needed.
+     *
+     * @param name: the variable name (e.g., "x").
+     * @returns: the node id of the variable.
+     */
+    int Variable(const std::string& name);
+
+    /**
+     * Gets the node for a literal constant, creating it if needed.
+     *
+     * @param value: the constant value.
+     * @returns: the node id of the constant.
+     */
+    int Constant(T value);
+
+    /**
+     * Appends an instruction.
+     *
+     * @param op: the operation to apply.
+     * @param lhs: node id of the main operand.
+     * @param rhs: node id of the auxilary operand, -1 for unary ops.
+     * @param third: node id of the addend of fma, -1 for other ops.
+     * @returns: the node id of the result.
+     */
+    int Emit(Operation op, int lhs, int rhs = -1, int third = -1);
+
+    /**
+     * Lays out all nodes as slots and moves them into a tape.
+     *
+     * @param output: the node id holding the result of the expression.
+     * @param tape: the tape to fill. Any previous contents are replaced.
+     */
+    void Build(int output, Tape<T>& tape);
+};
+
+/**
+ * The TapeView class evaluates a compiled tape held in memory that it does not
+ * own: the vectors of a Tape (see Tape::View) or a tape mapped from a file
+ * (see TapeFile). It holds the slot layout and the pointers only, so it is
+ * cheap to copy, and it must not outlive the memory it points to.
+ */
+template <class T>
+class TapeView {
+  private:
+    int num_variables_ = 0;
+    const T* constants_ = nullptr;
+    int num_constants_ = 0;
+    const Instruction* instructions_ = nullptr;
+    int num_instructions_ = 0;
+    int output_ = 0;
+    int num_slots_ = 0;
+    bool reuses_slots_ = false;
+
+  public:
+    TapeView() {}
+
+    /**
+     * Constructor.
+     *
+     * @param num_variables: the number of variables, in slots 0 and up.
+     * @param constants: the constant pool, in the slots after the variables.
+     * @param num_constants: the size of the constant pool.
+     * @param instructions: the instructions in evaluation order.
+     * @param num_instructions: the number of instructions.
+     * @param output: the slot holding the result.
+     * @param num_slots: the total number of slots.
+     * @param reuses_slots: whether results share slots (see Tape::ReuseSlots).
+     */
+    TapeView(int num_variables, const T* constants, int num_constants,
+             const Instruction* instructions, int num_instructions,
+             int output, int num_slots, bool reuses_slots)
+        : num_variables_(num_variables), constants_(constants),
+          num_constants_(num_constants), instructions_(instructions),
+          num_instructions_(num_instructions), output_(output),
+          num_slots_(num_slots), reuses_slots_(reuses_slots) {}
+
+    /* getters */
+    int NumVariables() const { return num_variables_; }
+    const T* Constants() const { return constants_; }
+    int NumConstants() const { return num_constants_; }
+    const Instruction* Instructions() const { return instructions_; }
+    int NumInstructions() const { return num_instructions_; }
+    int Output() const { return output_; }
+    int NumSlots() const { return num_slots_; }
+    bool ReusesSlots() const { return reuses_slots_; }
+
+    /* evaluation, see Tape for documentation */
+    template <class V, class ConstantFn>
+    V Forward(std::vector<V>& slots, ConstantFn constant) const;
+    T Primal(std::vector<T>& slots) const;
+
+    /**
+     * Runs a range of the instructions of Forward or Primal, e.g., to split
+     * an evaluation between threads (see ParallelTape). slots must already
+     * hold the variables, the constants and every value the range reads.
+     *
+     * @param slots: the slots, of size NumSlots().
+     * @param begin: the first instruction.
+     * @param end: one past the last instruction.
+     */
+    template <class V>
+    void ForwardRange(std::vector<V>& slots, int begin, int end) const;
+    void PrimalRange(std::vector<T>& slots, int begin, int end) const;
+    void Adjoint(const std::vector<T>& slots, T seed,
+                 std::vector<T>& adjoints) const;
+};
+
+/**
+ * The Tape class holds an equation compiled to a flat list of instructions.
+ * Where the Parser rewrites the equation string while it evaluates, a tape is
+ * compiled once and can then be evaluated many times with any value type that
+ * provides the ADValue interface (see EvaluateOperation in ADNode.hpp), with
+ * plain values of type T, or swept in reverse to accumulate adjoints.
+ *
+ * Example usage: gradient of f(x,y) = x*y + sin(x) with one reverse sweep.
+ *
+ * Tape<double> tape;
+ * assert(tape.Compile("((x*y)+(sin(x)))").code == ReturnCode::success);
+ * std::vector<double> slots = { 1.0, 2.0 };  // in tape.Variables() order
+ * double f = tape.Primal(slots);
+ * std::vector<double> adjoints;
+ * tape.Adjoint(slots, 1.0, adjoints);        // adjoints[0] == df/dx
+ */
+template <class T>
+class Tape {
+  private:
+    friend class TapeBuilder<T>;
+    friend class MappedTape<T>;
+
+    // Names of the input variables. Variable i lives in slot i.
+    std::vector<std::string> variables_;
+
+    // Constant pool. Constant j lives in slot variables_.size() + j.
+    std::vector<T> constants_;
+
+    // Instructions in evaluation order.
+    std::vector<Instruction> instructions_;
+
+    // The slot holding the result of the expression.
+    int output_ = 0;
+
+    // Total number of slots used by the tape.
+    int num_slots_ = 0;
+
+    // Whether instruction results share slots (see ReuseSlots).
+    bool reuses_slots_ = false;
+
+    /**
+     * Compiles the contents of a single innermost set of parentheses. Nested
+     * groups have already been replaced by references of the form "#<node>".
+     * Mirrors the rules of Parser::Next so that both accept the same language.
+     *
+     * @param builder: the builder to emit into.
+     * @param group: the text between a matching pair of parentheses.
+     * @param node: set to the node id holding the value of the group.
+     * @returns: a status to indicate success or failure with a message.
+     */
+    static Status CompileGroup(TapeBuilder<T>& builder,
+                               const std::string& group, int& node);
+
+    /**
+     * Resolves an operand, which is a reference to a group, a constant or a
+     * variable name. An empty operand is the constant zero, as in the parser.
+     *
+     * @param builder: the builder to emit into.
+     * @param key: the operand text.
+     * @param node: set to the node id of the operand.
+     * @returns: a status to indicate success or failure with a message.
+     */
+    static Status ResolveOperand(TapeBuilder<T>& builder,
+                                 const std::string& key, int& node);
+
+    /**
+     * Resolves the argument of a named function (e.g., sin). Like the parser,
+     * only variables and groups are accepted, so "(sin2)" is an error.
+     *
+     * @param builder: the builder to emit into.
+     * @param op_name: the name of the function, used for the error message.
+     * @param key: the argument text.
+     * @param node: set to the node id of the argument.
+     * @returns: a status to indicate success or failure with a message.
+     */
+    static Status ResolveArgument(TapeBuilder<T>& builder,
+                                  const std::string& op_name,
+                                  const std::string& key, int& node);
+
+  public:
+    Tape() {}
+
+    /**
+     * Compiles an equation in the parser syntax (e.g., "((x^2)+(sin(y)))")
+     * into this tape, replacing any previous contents. Variables are recorded
+     * in order of first appearance.
+     *
+     * @param equation: a string representation of the equation.
+     * @returns: a status to indicate success or failure with a message.
+     */
+    Status Compile(const std::string& equation);
+
+    /* getters */
+    const std::vector<std::string>& Variables() const { return variables_; }
+    const std::vector<T>& Constants() const { return constants_; }
+    const std::vector<Instruction>& Instructions() const {
+        return instructions_;
+    }
+    int Output() const { return output_; }
+    int NumSlots() const { return num_slots_; }
+    bool ReusesSlots() const { return reuses_slots_; }
+
+    /**
+     * Number of values the tape computes or reads, i.e., the number of slots
+     * it needs without slot reuse.
+     *
+     * @returns: variables + constants + instructions.
+     */
+    int NumValues() const {
+        return variables_.size() + constants_.size() + instructions_.size();
+    }
+
+    /**
+     * Human readable listing of the tape, one slot or instruction per line,
+     * e.g., "s3 = multiplication s0 s2".
+     *
+     * @returns: the listing.
+     */
+    std::string Dump() const;
+
+    /**
+     * Writes the tape as an equation in the infix syntax of InfixParser, e.g.,
+     * to print a derivative built by DifferentiateTape. Every operation is
+     * parenthesized and constants keep all their digits, so compiling the
+     * string gives the same values. Values read more than once are written
+     * out at every use, so the string can be much longer than the tape.
+     *
+     * @returns: the equation.
+     */
+    std::string ToInfix() const;
+
+    /**
+     * Linear-scan register allocation. Computes the last instruction that
+     * reads every result and hands its slot to a later result once it is
+     * dead, so NumSlots() becomes the peak number of live values. Memory then
+     * scales with the width of the expression instead of its length. Forward
+     * and Primal work unchanged on the rewritten tape, but the slots no longer
+     * hold every intermediate, so Adjoint cannot be used afterwards.
+     */
+    void ReuseSlots();
+
+    /**
+     * Maps each variable of the tape to its position in a list of names.
+     *
+     * @param names: the names provided by the caller (e.g., seed names).
+     * @param index: set so that variable i of the tape is names[index[i]].
+     * @returns: a parse_error status naming the first missing variable.
+     */
+    Status ResolveVariables(const std::vector<std::string>& names,
+                            std::vector<int>& index) const;
+
+    /**
+     * Evaluates the tape with any value type providing the ADValue interface.
+     *
+     * @param slots: holds the value of each variable on entry. On exit it is
+     * resized to NumSlots() and holds the value of every slot.
+     * @param constant: a callable converting a T constant to a value type.
+     * @returns: the value of the output slot.
+     */
+    template <class V, class ConstantFn>
+    V Forward(std::vector<V>& slots, ConstantFn constant) const {
+        return View().Forward(slots, constant);
+    }
+
+    /**
+     * Evaluates the tape on plain values without any derivative work.
+     *
+     * @param slots: holds the value of each variable on entry. On exit it is
+     * resized to NumSlots() and holds the value of every slot.
+     * @returns: the value of the output slot.
+     */
+    T Primal(std::vector<T>& slots) const { return View().Primal(slots); }
+
+    /**
+     * Reverse sweep. Propagates a seed on the output back to every slot.
+     *
+     * @param slots: the slot values from a preceding call to Primal.
+     * @param seed: the adjoint of the output.
+     * @param adjoints: resized to NumSlots(). adjoints[i] for i < number of
+     * variables is seed times the partial of the output w.r.t. variable i.
+     * Throws a logic_error if the tape reuses slots.
+     */
+    void Adjoint(const std::vector<T>& slots, T seed,
+                 std::vector<T>& adjoints) const {
+        View().Adjoint(slots, seed, adjoints);
+    }
+
+    /**
+     * Gets a view of the tape for evaluation. It is invalidated when the tape
+     * is modified or destroyed.
+     *
+     * @returns: the view.
+     */
+    TapeView<T> View() const {
+        return TapeView<T>(variables_.size(), constants_.data(),
+                           constants_.size(), instructions_.data(),
+                           instructions_.size(), output_, num_slots_,
+                           reuses_slots_);
+    }
+};
+
+
+/* Implementation TapeBuilder */
+
+template <class T>
+int TapeBuilder<T>::Variable(const std::string& name) {
+    auto it = variable_nodes_.find(name);
+    if (it != variable_nodes_.end()) {
+        return it->second;
+    }
+    int node = nodes_.size();
+    nodes_.emplace_back(NodeKind::variable, variables_.size());
+    variables_.push_back(name);
+    variable_nodes_[name] = node;
+    return node;
+}
+
+template <class T>
+int TapeBuilder<T>::Constant(T value) {
+    auto it = constant_nodes_.find(value);
+    if (it != constant_nodes_.end()) {
+        return it->second;
+    }
+    int node = nodes_.size();
+    nodes_.emplace_back(NodeKind::constant, constants_.size());
+    constants_.push_back(value);
+    constant_nodes_[value] = node;
+    return node;
+}
+
+template <class T>
+int TapeBuilder<T>::Emit(Operation op, int lhs, int rhs, int third) {
+    int node = nodes_.size();
+    if (hash_consing_) {
+        std::tuple<Operation, int, int, int> key(op, lhs, rhs, third);
+        if ((op == Operation::addition || op == Operation::multiplication ||
+             op == Operation::fma) && rhs < lhs) {
+            key = std::make_tuple(op, rhs, lhs, third);
+        }
+        auto inserted = instruction_nodes_.emplace(key, node);
+        if (!inserted.second) {
+            return inserted.first->second;
+        }
+    }
+    nodes_.emplace_back(NodeKind::instruction, instructions_.size());
+    instructions_.push_back(Instruction{op, -1, lhs, rhs, third});
+    return node;
+}
+
+template <class T>
+void TapeBuilder<T>::Build(int output, Tape<T>& tape) {
+    int num_variables = variables_.size();
+    int num_constants = constants_.size();
+    // Final slot of each node.
+    std::vector<int> slot(nodes_.size());
+    for (int i = 0; i < nodes_.size(); ++i) {
+        switch (nodes_[i].first) {
+          case NodeKind::variable :
+            slot[i] = nodes_[i].second;
+            break;
+          case NodeKind::constant :
+            slot[i] = num_variables + nodes_[i].second;
+            break;
+          case NodeKind::instruction :
+            slot[i] = num_variables + num_constants + nodes_[i].second;
+            break;
+        }
+    }
+    for (int i = 0; i < instructions_.size(); ++i) {
+        Instruction& ins = instructions_[i];
+        ins.dst = num_variables + num_constants + i;
+        ins.lhs = slot[ins.lhs];
+        ins.rhs = ins.rhs < 0 ? -1 : slot[ins.rhs];
+        ins.third = ins.third < 0 ? -1 : slot[ins.third];
+    }
+    tape.variables_.swap(variables_);
+    tape.constants_.swap(constants_);
+    tape.instructions_.swap(instructions_);
+    tape.output_ = slot[output];
+    tape.num_slots_ = num_variables + num_constants + tape.instructions_.size();
+    tape.reuses_slots_ = false;
+
+    // Leave the builder empty.
+    nodes_.clear();
+    variables_.clear();
+    variable_nodes_.clear();
+    constants_.clear();
+    constant_nodes_.clear();
+    instructions_.clear();
+    instruction_nodes_.clear();
+}
+
+
+/* Implementation Tape */
+
+template <class T>
+Status Tape<T>::Compile(const std::string& equation) {
+    Status status;
+    TapeBuilder<T> builder;
+    // Text of each currently open set of parentheses. When a set closes, it is
+    // compiled and replaced by a "#<node>" reference in the enclosing set, the
+    // same way Parser::Next replaces it by an intermediate name.
+    std::vector<std::string> groups;
+    int output = -1;
+    for (char const &c : equation) {
+        if (c == '(') {
+            if (output >= 0) {
+                status.code = ReturnCode::parse_error;
+                status.message = "Unexpected input after final \')\'";
+                return status;
+            }
+            groups.emplace_back();
+        } else if (c == ')') {
+            if (groups.empty()) {
+                status.code = ReturnCode::parse_error;
+                status.message = "Unbalanced parentheses -- too many \')\'";
+                return status;
+            }
+            std::string group;
+            group.swap(groups.back());
+            groups.pop_back();
+            int node;
+            status = CompileGroup(builder, group, node);
+            if (status.code != ReturnCode::success) {
+                return status;
+            }
+            if (groups.empty()) {
+                output = node;
+            } else {
+                groups.back() += '#' + std::to_string(node);
+            }
+        } else if (c == '#') {
+            // Reserved for references to compiled groups.
+            status.code = ReturnCode::parse_error;
+            status.message = "Invalid character \'#\'";
+            return status;
+        } else if (groups.empty()) {
+            status.code = ReturnCode::parse_error;
+            status.message = output >= 0 ?
+                "Unexpected input after final \')\'" : "No parentheses found.";
+            return status;
+        } else {
+            groups.back() += c;
+        }
+    }
+    if (!groups.empty()) {
+        status.code = ReturnCode::parse_error;
+        status.message = "Unbalanced parentheses -- too many \'(\'";
+        return status;
+    }
+    if (output < 0) {
+        status.code = ReturnCode::parse_error;
+        status.message = "No parentheses found.";
+        return status;
+    }
+    builder.Build(output, *this);
+    return status;
+}
+
+template <class T>
+Status Tape<T>::CompileGroup(TapeBuilder<T>& builder,
+                             const std::string& group, int& node) {
+    Status status;
+    // Single character ops. As in Parser::GetOpIndex the first one wins.
+    size_t op_index = group.find_first_of("+^-/*");
+    if (op_index != std::string::npos) {
+        Operation op;
+        switch (group[op_index]) {
+          case '+' : op = Operation::addition; break;
+          case '^' : op = Operation::power; break;
+          case '-' : op = Operation::subtraction; break;
+          case '/' : op = Operation::division; break;
+          default : op = Operation::multiplication; break;
+        }
+        std::string lhs = group.substr(0, op_index);
+        std::string rhs = group.substr(op_index + 1);
+        // Handle negation operation as a subcase of subtraction.
+        bool negation = op == Operation::subtraction && lhs.empty();
+        if (!negation && (lhs.empty() || rhs.empty())) {
+            status.code = ReturnCode::parse_error;
+            status.message = "Binary operation requires LHS and RHS";
+            return status;
+        }
+        // Resolve left to right so variables are recorded in reading order.
+        int lhs_node;
+        status = ResolveOperand(builder, lhs, lhs_node);
+        if (status.code != ReturnCode::success) {
+            return status;
+        }
+        int rhs_node;
+        status = ResolveOperand(builder, rhs, rhs_node);
+        if (status.code != ReturnCode::success) {
+            return status;
+        }
+        node = builder.Emit(op, lhs_node, rhs_node);
+        return status;
+    }
+
+    // Named functions, the longest match wins so sinh is not read as sin.
+    if (group.length() > 3) {
+        const Keyword* keyword = MatchKeyword(group);
+        if (keyword != nullptr && keyword->op != Operation::log) {
+            int arg;
+            status = ResolveArgument(builder, keyword->name,
+                                     group.substr(keyword->length), arg);
+            if (status.code != ReturnCode::success) {
+                return status;
+            }
+            node = builder.Emit(keyword->op, arg);
+            return status;
+        }
+        // Log also carries its base: log_<base>_<argument>.
+        if (group.compare(0, 3, "log") == 0) {
+            size_t right_marker = group.find('_', 4);
+            int base;
+            if (group[3] != '_' || right_marker == std::string::npos ||
+                ResolveOperand(builder, group.substr(4, right_marker - 4),
+                               base).code != ReturnCode::success) {
+                status.code = ReturnCode::parse_error;
+                status.message = "Invalid argument to log";
+                return status;
+            }
+            int arg;
+            status = ResolveArgument(
+                builder, "log", group.substr(right_marker + 1), arg);
+            if (status.code != ReturnCode::success) {
+                return status;
+            }
+            node = builder.Emit(Operation::log, arg, base);
+            return status;
+        }
+    }
+
+    // A lone value. The parser evaluates this as (value + 0).
+    int value;
+    status = ResolveOperand(builder, group, value);
+    if (status.code != ReturnCode::success) {
+        return status;
+    }
+    node = builder.Emit(Operation::addition, value, builder.Constant(0));
+    return status;
+}
+
+template <class T>
+Status Tape<T>::ResolveOperand(TapeBuilder<T>& builder,
+                               const std::string& key, int& node) {
+    Status status;
+    if (key.empty()) {
+        node = builder.Constant(0);
+        return status;
+    }
+    // Reference to an already compiled group.
+    if (key[0] == '#' && key.find_first_not_of("0123456789", 1) ==
+        std::string::npos) {
+        node = std::stoi(key.substr(1));
+        return status;
+    }
+    if (key.find('#') == std::string::npos) {
+        // Try to cast the string to type T, as in Parser::GetValue.
+        std::istringstream ss(key);
+        T num;
+        ss >> num;
+        if (ss.eof() && !ss.fail()) {
+            node = builder.Constant(num);
+            return status;
+        }
+        // Anything else is a variable.
+        if (!isdigit(key[0]) && key[0] != '.') {
+            node = builder.Variable(key);
+            return status;
+        }
+    }
+    status.code = ReturnCode::parse_error;
+    status.message = "Key not found: " + key;
+    return status;
+}
+
+template <class T>
+Status Tape<T>::ResolveArgument(TapeBuilder<T>& builder,
+                                const std::string& op_name,
+                                const std::string& key, int& node) {
+    Status status;
+    // Only groups and variables are valid arguments.
+    int candidate = -1;
+    if (!key.empty() &&
+        ResolveOperand(builder, key, candidate).code == ReturnCode::success &&
+        (key[0] == '#' || (!isdigit(key[0]) && key[0] != '.'))) {
+        node = candidate;
+        return status;
+    }
+    status.code = ReturnCode::parse_error;
+    status.message = "Invalid argument to " + op_name;
+    return status;
+}
+
+template <class T>
+Status Tape<T>::ResolveVariables(const std::vector<std::string>& names,
+                                 std::vector<int>& index) const {
+    Status status;
+    index.assign(variables_.size(), -1);
+    for (int i = 0; i < variables_.size(); ++i) {
+        for (int j = 0; j < names.size(); ++j) {
+            if (names[j] == variables_[i]) {
+                index[i] = j;
+                break;
+            }
+        }
+        if (index[i] < 0) {
+            status.code = ReturnCode::parse_error;
+            status.message = "Key not found: " + variables_[i];
+            return status;
+        }
+    }
+    return status;
+}
+
+template <class T>
+std::string Tape<T>::ToInfix() const {
+    // Equation of the current value of every slot, built in tape order.
+    std::vector<std::string> text(num_slots_);
+    std::ostringstream out;
+    out.precision(std::numeric_limits<T>::max_digits10);
+    for (int i = 0; i < variables_.size(); ++i) {
+        text[i] = variables_[i];
+    }
+    for (int j = 0; j < constants_.size(); ++j) {
+        out.str("");
+        out << (constants_[j] < 0 ? -constants_[j] : constants_[j]);
+        text[variables_.size() + j] = constants_[j] < 0 ?
+            "(-" + out.str() + ")" : out.str();
+    }
+    for (const Instruction& ins : instructions_) {
+        const std::string& a = text[ins.lhs];
+        std::string b = ins.rhs < 0 ? "" : text[ins.rhs];
+        std::string result;
+        switch (ins.op) {
+          case Operation::addition : result = "(" + a + "+" + b + ")"; break;
+          case Operation::subtraction : result = "(" + a + "-" + b + ")"; break;
+          case Operation::multiplication :
+            result = "(" + a + "*" + b + ")";
+            break;
+          case Operation::division : result = "(" + a + "/" + b + ")"; break;
+          case Operation::power :
+          case Operation::ipow :
+            result = "(" + a + "^" + b + ")";
+            break;
+          case Operation::log :
+          case Operation::loglogistic : {
+            std::string arg = ins.op == Operation::log ? a :
+                "logistic(" + a + ")";
+            int base = ins.rhs - variables_.size();
+            if (base >= 0 && base < constants_.size() && constants_[base] > 0) {
+                // The base of log is a literal, log_<base>_.
+                out.str("");
+                out << constants_[base];
+                result = "log_" + out.str() + "_(" + arg + ")";
+            } else {
+                out.str("");
+                out << M_E;
+                std::string ln = "log_" + out.str() + "_(";
+                result = "(" + ln + arg + ")/" + ln + b + "))";
+            }
+            break;
+          }
+          case Operation::fma :
+            result = "((" + a + "*" + b + ")+" + text[ins.third] + ")";
+            break;
+          case Operation::square : result = "(" + a + "*" + a + ")"; break;
+          case Operation::reciprocal : result = "(1/" + a + ")"; break;
+          case Operation::expneg : result = "exp(-" + a + ")"; break;
+          default :
+            result = std::string(OperationName(ins.op)) + "(" + a + ")";
+            break;
+        }
+        text[ins.dst] = result;
+    }
+    return text[output_];
+}
+
+template <class T>
+std::string Tape<T>::Dump() const {
+    std::ostringstream out;
+    for (int i = 0; i < variables_.size(); ++i) {
+        out << "s" << i << " = variable " << variables_[i] << "\n";
+    }
+    for (int j = 0; j < constants_.size(); ++j) {
+        out << "s" << variables_.size() + j << " = constant " << constants_[j]
+            << "\n";
+    }
+    for (const Instruction& ins : instructions_) {
+        out << "s" << ins.dst << " = " << OperationName(ins.op) << " s"
+            << ins.lhs;
+        if (ins.rhs >= 0) {
+            out << " s" << ins.rhs;
+        }
+        if (ins.third >= 0) {
+            out << " s" << ins.third;
+        }
+        out << "\n";
+    }
+    out << "output s" << output_ << "\n";
+    return out.str();
+}
+
+template <class T>
+void Tape<T>::ReuseSlots() {
+    if (reuses_slots_) {
+        return;
+    }
+    // Variables and constants keep their slots, results are reallocated.
+    int base = variables_.size() + constants_.size();
+    // Index of the last instruction reading each slot, -1 if never read.
+    std::vector<int> last_use(num_slots_, -1);
+    for (int i = 0; i < instructions_.size(); ++i) {
+        last_use[instructions_[i].lhs] = i;
+        if (instructions_[i].rhs >= 0) {
+            last_use[instructions_[i].rhs] = i;
+        }
+        if (instructions_[i].third >= 0) {
+            last_use[instructions_[i].third] = i;
+        }
+    }
+    // The output is read after the final instruction.
+    last_use[output_] = instructions_.size();
+
+    std::vector<int> slot(num_slots_);
+    for (int i = 0; i < base; ++i) {
+        slot[i] = i;
+    }
+    // Dead slots, reused last in first out so recent slots stay in cache.
+    std::vector<int> free_slots;
+    int num_slots = base;
+    for (int i = 0; i < instructions_.size(); ++i) {
+        Instruction& ins = instructions_[i];
+        int lhs = ins.lhs;
+        int rhs = ins.rhs;
+        int third = ins.third;
+        ins.lhs = slot[lhs];
+        ins.rhs = rhs < 0 ? -1 : slot[rhs];
+        ins.third = third < 0 ? -1 : slot[third];
+        // Operands read for the last time can hold the result, since an
+        // instruction reads its operands before writing its result.
+        if (lhs >= base && last_use[lhs] == i) {
+            free_slots.push_back(slot[lhs]);
+        }
+        if (rhs >= base && rhs != lhs && last_use[rhs] == i) {
+            free_slots.push_back(slot[rhs]);
+        }
+        if (third >= base && third != lhs && third != rhs &&
+            last_use[third] == i) {
+            free_slots.push_back(slot[third]);
+        }
+        int dst;
+        if (free_slots.empty()) {
+            dst = num_slots++;
+        } else {
+            dst = free_slots.back();
+            free_slots.pop_back();
+        }
+        slot[ins.dst] = dst;
+        if (last_use[ins.dst] < 0) {
+            // Never read, so the slot is free again right away.
+            free_slots.push_back(dst);
+        }
+        ins.dst = dst;
+    }
+    output_ = slot[output_];
+    num_slots_ = num_slots;
+    reuses_slots_ = true;
+}
+
+
+/* Implementation TapeView */
+
+template <class T>
+template <class V, class ConstantFn>
+V TapeView<T>::Forward(std::vector<V>& slots, ConstantFn constant) const {
+    slots.resize(num_slots_);
+    for (int j = 0; j < num_constants_; ++j) {
+        slots[num_variables_ + j] = constant(constants_[j]);
+    }
+    ForwardRange(slots, 0, num_instructions_);
+    return slots[output_];
+}
+
+template <class T>
+template <class V>
+void TapeView<T>::ForwardRange(std::vector<V>& slots, int begin,
+                               int end) const {
+    for (int i = begin; i < end; ++i) {
+        const Instruction& ins = instructions_[i];
+        V& lhs = slots[ins.lhs];
+        // Unary ops ignore their auxilary value.
+        V& rhs = ins.rhs < 0 ? lhs : slots[ins.rhs];
+        V& third = ins.third < 0 ? lhs : slots[ins.third];
+        slots[ins.dst] = EvaluateOperation(ins.op, lhs, rhs, third);
+    }
+}
+
+template <class T>
+T TapeView<T>::Primal(std::vector<T>& slots) const {
+    slots.resize(num_slots_);
+    std::copy(constants_, constants_ + num_constants_,
+              slots.begin() + num_variables_);
+    PrimalRange(slots, 0, num_instructions_);
+    return slots[output_];
+}
+
+template <class T>
+void TapeView<T>::PrimalRange(std::vector<T>& slots, int begin,
+                              int end) const {
+    for (int i = begin; i < end; ++i) {
+        const Instruction& ins = instructions_[i];
+        T rhs = ins.rhs < 0 ? 0 : slots[ins.rhs];
+        T third = ins.third < 0 ? 0 : slots[ins.third];
+        slots[ins.dst] = PrimalOperation(ins.op, slots[ins.lhs], rhs, third);
+    }
+}
+
+template <class T>
+void TapeView<T>::Adjoint(const std::vector<T>& slots, T seed,
+                          std::vector<T>& adjoints) const {
+    if (reuses_slots_) {
+        throw std::logic_error("Adjoint requires a tape without slot reuse.");
+    }
+    // Which slots depend on a variable. Needed to reject exponents that vary
+    // when the base of a power is negative, as ADValue::power does.
+    std::vector<bool> active(num_slots_, false);
+    for (int i = 0; i < num_variables_; ++i) {
+        active[i] = true;
+    }
+    for (int i = 0; i < num_instructions_; ++i) {
+        const Instruction& ins = instructions_[i];
+        active[ins.dst] = active[ins.lhs] ||
+            (ins.rhs >= 0 && active[ins.rhs]) ||
+            (ins.third >= 0 && active[ins.third]);
+    }
+
+    adjoints.assign(num_slots_, 0);
+    adjoints[output_] = seed;
+    for (int i = num_instructions_ - 1; i >= 0; --i) {
+        const Instruction& ins = instructions_[i];
+        T adjoint = adjoints[ins.dst];
+        if (adjoint == 0 || !active[ins.dst]) {
+            continue;
+        }
+        T rhs = ins.rhs < 0 ? 0 : slots[ins.rhs];
+        T da, db;
+        if (!PartialOperation(ins.op, slots[ins.lhs], rhs, slots[ins.dst],
+                              da, db) && active[ins.rhs]) {
+            throw std::logic_error("Derivative not defined or complex.");
+        }
+        adjoints[ins.lhs] += da * adjoint;
+        if (ins.rhs >= 0) {
+            adjoints[ins.rhs] += db * adjoint;
+        }
+        if (ins.third >= 0) {
+            // The addend of fma.
+            adjoints[ins.third] += adjoint;
+        }
+    }
+}
+
+
+#endif /* TAPE_H */
@@ -0,0 +1,246 @@
+/**
+ * @file TapeDerivative.h
+ */
+
+#ifndef TAPEDERIVATIVE_H
+#define TAPEDERIVATIVE_H
+
+/* header files */
+#include "ADNode.hpp"
+#include "Tape.hpp"
+#include "TapePasses.hpp"
+
+/* system header files */
+#ifndef DOXYGEN_IGNORE
+#include <math.h>
+#include <vector>
+#endif
+
+/**
+ * Symbolic differentiation. Builds a tape that computes the partial
+ * derivative of the output of a tape w.r.t. one of its variables, so the
+ * derivative can be cached, optimized and evaluated with Primal like any
+ * other tape instead of propagating dual numbers on every call. Every
+ * instruction is differentiated with the local partials of PartialOperation,
+ * i.e., the rules of the ADValue operators, and the primal values they read
+ * are part of the same tape, so OptimizeTape (run at the end) shares them
+ * between the partials and drops the primal instructions the derivative does
+ * not need. Values whose derivative is known to be zero are not
+ * differentiated at all.
+ *
+ * Where ADValue reports an error or an infinite derivative (e.g., a power
+ * with a varying exponent and a base that is not positive, or sqrt at 0) the
+ * derivative tape evaluates to NaN instead.
+ *
+ * Example usage: d/dx of x^2 * sin(y) is the tape of (2*x) * sin(y).
+ *
+ * Tape<double> tape;
+ * tape.Compile("((x^2)*(sin(y)))");
+ * Tape<double> dx;
+ * DifferentiateTape(tape, 0, dx);
+ * std::vector<double> slots = {1.5, 2.0};
+ * double partial = dx.Primal(slots);
+ *
+ * @param tape: the tape to differentiate. It may reuse slots.
+ * @param variable: the index of the variable in tape.Variables().
+ * @param derivative: replaced by the derivative, a tape with the same
+ * variables in the same order.
+ */
+template <class T>
+void DifferentiateTape(const Tape<T>& tape, int variable, Tape<T>& derivative);
+
+/**
+ * Differentiates a tape w.r.t. each of its variables (see DifferentiateTape).
+ *
+ * @param tape: the tape to differentiate.
+ * @param partials: resized to the number of variables, partials[i] is the
+ * derivative w.r.t. variable i.
+ */
+template <class T>
+void GradientTapes(const Tape<T>& tape, std::vector<Tape<T>>& partials);
+
+
+/* Implementation TapeDerivative */
+
+template <class T>
+void DifferentiateTape(const Tape<T>& tape, int variable, Tape<T>& derivative) {
+    TapeRewriter<T> rewriter(tape);
+    // Node of the derivative of the current value of each slot, -1 if it is
+    // known to be zero.
+    std::vector<int> tangent(tape.NumSlots(), -1);
+    tangent[variable] = rewriter.ConstantNode(1);
+
+    // Helpers on nodes of the derivative, where -1 is a zero.
+    auto emit = [&](Operation op, int lhs, int rhs) {
+        return rewriter.EmitNode(op, lhs, rhs);
+    };
+    auto add = [&](int lhs, int rhs) {
+        return lhs < 0 ? rhs : rhs < 0 ? lhs :
+            emit(Operation::addition, lhs, rhs);
+    };
+    auto subtract = [&](int lhs, int rhs) {
+        return rhs < 0 ? lhs : emit(Operation::subtraction,
+            lhs < 0 ? rewriter.ConstantNode(0) : lhs, rhs);
+    };
+    auto scale = [&](int d, int factor) {
+        return d < 0 ? -1 : emit(Operation::multiplication, d, factor);
+    };
+    auto divide = [&](int d, int divisor) {
+        return d < 0 ? -1 : emit(Operation::division, d, divisor);
+    };
+    auto negate = [&](int d) { return subtract(-1, d); };
+    // Natural log, as a log with base e.
+    auto ln = [&](int node) {
+        return emit(Operation::log, node, rewriter.ConstantNode(M_E));
+    };
+
+    for (const Instruction& ins : tape.Instructions()) {
+        int da = tangent[ins.lhs];
+        int db = ins.rhs < 0 ? -1 : tangent[ins.rhs];
+        int dc = ins.third < 0 ? -1 : tangent[ins.third];
+        int a = rewriter.Node(ins.lhs);
+        int b = ins.rhs < 0 ? -1 : rewriter.Node(ins.rhs);
+        rewriter.Emit(ins);
+        int value = rewriter.Node(ins.dst);
+        if (da < 0 && db < 0 && dc < 0) {
+            tangent[ins.dst] = -1;
+            continue;
+        }
+        int d = -1;
+        switch (ins.op) {
+          case Operation::addition : d = add(da, db); break;
+          case Operation::subtraction : d = subtract(da, db); break;
+          case Operation::multiplication : {
+            d = add(scale(da, b), scale(db, a));
+            break;
+          }
+          case Operation::division : {
+            // da / b - db * a / b^2
+            d = subtract(divide(da, b), divide(scale(db, a),
+                emit(Operation::multiplication, b, b)));
+            break;
+          }
+          case Operation::power : {
+            // Power rule on the base, generalized chain rule on the exponent.
+            // Like ADValue::power, both are 0 for a zero base: a power of 0
+            // is 0, and a^0 is 0 there and 1 elsewhere, so the log is taken
+            // of a + (1 - a^0), which is 1 instead of 0 for a zero base.
+            int one = rewriter.ConstantNode(1);
+            int power = emit(Operation::power, a,
+                             emit(Operation::subtraction, b, one));
+            int nonzero = emit(Operation::power, a, rewriter.ConstantNode(0));
+            int base = emit(Operation::addition, a,
+                            emit(Operation::subtraction, one, nonzero));
+            d = add(scale(da, emit(Operation::multiplication, b, power)),
+                    scale(db, emit(Operation::multiplication, value,
+                                   ln(base))));
+            break;
+          }
+          case Operation::sin : {
+            d = scale(da, emit(Operation::cos, a, -1));
+            break;
+          }
+          case Operation::cos : {
+            d = negate(scale(da, emit(Operation::sin, a, -1)));
+            break;
+          }
+          case Operation::tan : {
+            int c = emit(Operation::cos, a, -1);
+            d = divide(da, emit(Operation::multiplication, c, c));
+            break;
+          }
+          case Operation::exp : d = scale(da, value); break;
+          case Operation::arcsin :
+          case Operation::arccos : {
+            int root = emit(Operation::sqrt, emit(Operation::subtraction,
+                rewriter.ConstantNode(1),
+                emit(Operation::multiplication, a, a)), -1);
+            d = divide(da, root);
+            if (ins.op == Operation::arccos) {
+                d = negate(d);
+            }
+            break;
+          }
+          case Operation::arctan : {
+            d = divide(da, emit(Operation::addition, rewriter.ConstantNode(1),
+                                emit(Operation::multiplication, a, a)));
+            break;
+          }
+          case Operation::sinh : {
+            d = scale(da, emit(Operation::cosh, a, -1));
+            break;
+          }
+          case Operation::cosh : {
+            d = scale(da, emit(Operation::sinh, a, -1));
+            break;
+          }
+          case Operation::tanh : {
+            int c = emit(Operation::cosh, a, -1);
+            d = divide(da, emit(Operation::multiplication, c, c));
+            break;
+          }
+          case Operation::logistic : {
+            // exp(a) / (1 + exp(a))^2
+            int e = emit(Operation::exp, a, -1);
+            int t = emit(Operation::addition, rewriter.ConstantNode(1), e);
+            d = scale(da, emit(Operation::division, e,
+                               emit(Operation::multiplication, t, t)));
+            break;
+          }
+          case Operation::log : {
+            // The base is a constant, as in ADValue::ADlog.
+            d = divide(da, emit(Operation::multiplication, a, ln(b)));
+            break;
+          }
+          case Operation::sqrt : {
+            d = divide(scale(da, rewriter.ConstantNode(0.5)), value);
+            break;
+          }
+          case Operation::fma : {
+            d = add(add(scale(da, b), scale(db, a)), dc);
+            break;
+          }
+          case Operation::square : {
+            d = scale(da, emit(Operation::multiplication,
+                               rewriter.ConstantNode(2), a));
+            break;
+          }
+          case Operation::reciprocal : {
+            d = negate(divide(da, emit(Operation::multiplication, a, a)));
+            break;
+          }
+          case Operation::ipow : {
+            // The exponent is a constant integer n, so n-1 is one too.
+            int power = rewriter.IsConstant(ins.rhs) ?
+                rewriter.EmitNode(Operation::ipow, a, rewriter.ConstantNode(
+                    rewriter.Value(ins.rhs) - 1)) :
+                emit(Operation::power, a, emit(Operation::subtraction, b,
+                                               rewriter.ConstantNode(1)));
+            d = scale(da, emit(Operation::multiplication, b, power));
+            break;
+          }
+          case Operation::expneg : d = negate(scale(da, value)); break;
+          case Operation::loglogistic : {
+            // 1 / ((1 + exp(a)) * ln(base))
+            int t = emit(Operation::addition, rewriter.ConstantNode(1),
+                         emit(Operation::exp, a, -1));
+            d = divide(da, emit(Operation::multiplication, t, ln(b)));
+            break;
+          }
+        }
+        tangent[ins.dst] = d;
+    }
+    int output = tangent[tape.Output()];
+    rewriter.Build(output < 0 ? rewriter.ConstantNode(0) : output, derivative);
+    OptimizeTape(derivative);
+}
+
+template <class T>
+void GradientTapes(const Tape<T>& tape, std::vector<Tape<T>>& partials) {
+    partials.resize(tape.Variables().size());
+    for (int i = 0; i < partials.size(); ++i) {
+        DifferentiateTape(tape, i, partials[i]);
+    }
+}
+
+#endif /* TAPEDERIVATIVE_H */
@@ -0,0 +1,544 @@
+/**
+ * @file TapeFile.h
+ */
+
+#ifndef TAPEFILE_H
+#define TAPEFILE_H
+
+/* header files */
+#include "MappedFile.hpp"
+#include "Parser.hpp"
+#include "StringView.hpp"
+#include "Tape.hpp"
+
+/* system header files */
+#ifndef DOXYGEN_IGNORE
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#endif
+
+// Instructions are stored as they are laid out in memory, so the format
+// depends on this layout. Changing it requires a new kTapeFileVersion.
+static_assert(sizeof(Instruction) == 5 * sizeof(int32_t),
+              "Instruction must be five packed 32 bit integers");
+static_assert(sizeof(Operation) == sizeof(int32_t),
+              "Operation must be stored as a 32 bit integer");
+
+// First bytes of every tape file.
+const char kTapeFileMagic[8] = {'A', 'D', 'T', 'A', 'P', 'E', '\0', '\0'};
+
+// Version of the layout below. Files of any other version are rejected.
+const uint32_t kTapeFileVersion = 1;
+
+// Written in the byte order of the machine saving the file, so a file saved
+// on a machine of the other byte order is recognised and rejected.
+const uint32_t kTapeFileByteOrder = 0x01020304;
+
+// Every section starts at a multiple of this, so that constants and
+// instructions can be read in place from a page aligned mapping.
+const size_t kTapeFileAlignment = 16;
+
+// Header at the start of a tape file, followed by the directory.
+struct TapeFileHeader {
+  char magic[8];
+  uint32_t version;
+  // sizeof(T) of the constants, so a float file is not read as double.
+  uint32_t value_size;
+  uint32_t byte_order;
+  uint32_t num_tapes;
+  uint64_t reserved;
+};
+
+// Directory entry of one tape. Offsets are in bytes from the start of the
+// file. The names section holds num_variables uint32 end offsets followed by
+// the characters of the names, so name i is chars[ends[i - 1], ends[i]).
+struct TapeFileEntry {
+  uint64_t key_offset;
+  uint64_t key_size;
+  uint64_t names_offset;
+  uint64_t constants_offset;
+  uint64_t instructions_offset;
+  uint32_t num_variables;
+  uint32_t num_constants;
+  uint32_t num_instructions;
+  int32_t output;
+  uint32_t num_slots;
+  // Bit 0: the tape reuses slots (see Tape::ReuseSlots).
+  uint32_t flags;
+};
+
+/**
+ * Saves compiled tapes to a tape file, which TapeFile loads without parsing
+ * or optimizing them again. A file holds any number of tapes, each under a
+ * key (typically the equation it was compiled from), and is only valid on
+ * machines with the same byte order and the same value type T.
+ *
+ * @param path: the path of the file, replaced if it exists.
+ * @param tapes: the key and tape of each entry. Keys must be distinct.
+ * @returns: an invalid_argument status if a key is repeated or the file
+ * cannot be written.
+ */
+template <class T>
+Status SaveTapes(const std::string& path,
+                 const std::vector<std::pair<std::string, const Tape<T>*>>&
+                     tapes);
+
+/**
+ * The MappedTape class is one tape of a TapeFile. Its constants, instructions
+ * and names are read in place from the file, so it is only valid while the
+ * TapeFile that returned it is open.
+ */
+template <class T>
+class MappedTape {
+  private:
+    template <class U>
+    friend class TapeFile;
+
+    // Key the tape was saved under.
+    StringView key_;
+
+    // End offset of each name within names_.
+    const uint32_t* name_ends_ = nullptr;
+    const char* names_ = nullptr;
+
+    // The tape, pointing into the file.
+    TapeView<T> view_;
+
+  public:
+    MappedTape() {}
+
+    /* getters */
+    StringView Key() const { return key_; }
+    const TapeView<T>& View() const { return view_; }
+    int NumVariables() const { return view_.NumVariables(); }
+
+    /**
+     * Name of a variable of the tape.
+     *
+     * @param i: the variable, less than NumVariables().
+     * @returns: a view of the name, pointing into the file.
+     */
+    StringView Variable(int i) const {
+        uint32_t begin = i == 0 ? 0 : name_ends_[i - 1];
+        return StringView(names_ + begin, name_ends_[i] - begin);
+    }
+
+    /**
+     * Maps each variable of the tape to its position in a list of names, as
+     * Tape::ResolveVariables.
+     *
+     * @param names: the names provided by the caller (e.g., seed names).
+     * @param index: set so that variable i of the tape is names[index[i]].
+     * @returns: a parse_error status naming the first missing variable.
+     */
+    Status ResolveVariables(const std::vector<std::string>& names,
+                            std::vector<int>& index) const;
+
+    /**
+     * Copies the tape out of the file, e.g., to keep it after the file is
+     * closed.
+     *
+     * @param tape: replaced by the copy.
+     */
+    void CopyTo(Tape<T>& tape) const;
+};
+
+/**
+ * The TapeFile class opens a file written by SaveTapes. The file is mapped
+ * into memory and checked once when it is opened, after which every tape is
+ * evaluated straight from the mapping: nothing is parsed, copied or
+ * optimized, so opening even a large file costs little more than reading its
+ * directory. A file that is truncated, corrupt, of another version, or saved
+ * with another value type is rejected with an invalid_argument status rather
+ * than read out of bounds.
+ *
+ * Example usage:
+ *
+ * TapeFile<double> file;
+ * assert(file.Open("tapes.bin").code == ReturnCode::success);
+ * const MappedTape<double>* tape = file.Find("((x^2)+(sin(y)))");
+ * std::vector<double> slots = {1.5, 2.0};
+ * double value = tape->View().Primal(slots);
+ */
+template <class T>
+class TapeFile {
+  private:
+    // The contents of the file.
+    MappedFile file_;
+
+    // The tapes, sorted by key.
+    std::vector<MappedTape<T>> tapes_;
+
+    /**
+     * Checks one directory entry and sets up its tape.
+     *
+     * @param entry: the entry.
+     * @param tape: set to the tape.
+     * @returns: a status describing the first problem found.
+     */
+    Status ReadEntry(const TapeFileEntry& entry, MappedTape<T>& tape) const;
+
+    /**
+     * Gets a pointer to a section of the file after checking that it lies
+     * within the file and is aligned for its type.
+     *
+     * @param offset: the offset of the section.
+     * @param count: the number of elements in the section.
+     * @param section: set to the start of the section.
+     * @returns: false if the section is out of bounds or misaligned.
+     */
+    template <class U>
+    bool Section(uint64_t offset, uint64_t count, const U*& section) const;
+
+  public:
+    TapeFile() {}
+
+    /**
+     * Opens a tape file, replacing any file opened before. Tapes returned
+     * before are invalidated.
+     *
+     * @param path: the path of the file.
+     * @returns: an invalid_argument status if the file cannot be read or is
+     * not a valid tape file for T.
+     */
+    Status Open(const std::string& path);
+
+    /* getters */
+    int NumTapes() const { return tapes_.size(); }
+    const MappedTape<T>& Get(int i) const { return tapes_[i]; }
+    bool IsMapped() const { return file_.IsMapped(); }
+
+    /**
+     * Finds the tape saved under a key.
+     *
+     * @param key: the key (e.g., the equation).
+     * @returns: the tape, or null if the file has no such key.
+     */
+    const MappedTape<T>* Find(StringView key) const;
+};
+
+
+/* Implementation SaveTapes */
+
+/**
+ * Pads a buffer with zeros to the next multiple of kTapeFileAlignment.
+ *
+ * @param buffer: the buffer.
+ * @returns: the padded size, where the next section starts.
+ */
+inline uint64_t AlignTapeFile(std::string& buffer) {
+    size_t padding = (kTapeFileAlignment -
+                      buffer.size() % kTapeFileAlignment) % kTapeFileAlignment;
+    buffer.append(padding, '\0');
+    return buffer.size();
+}
+
+template <class T>
+Status SaveTapes(const std::string& path,
+                 const std::vector<std::pair<std::string, const Tape<T>*>>&
+                     tapes) {
+    static_assert(std::is_arithmetic<T>::value,
+                  "Tape files store values as raw bytes");
+    Status status;
+    // Sorted by key, so that TapeFile::Find is a binary search.
+    std::vector<std::pair<std::string, const Tape<T>*>> sorted(tapes);
+    std::sort(sorted.begin(), sorted.end(),
+              [](const std::pair<std::string, const Tape<T>*>& a,
+                 const std::pair<std::string, const Tape<T>*>& b) {
+                  return a.first < b.first;
+              });
+    for (int i = 1; i < sorted.size(); ++i) {
+        if (sorted[i].first == sorted[i - 1].first) {
+            status.code = ReturnCode::invalid_argument;
+            status.message = "Repeated key: " + sorted[i].first;
+            return status;
+        }
+    }
+
+    TapeFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kTapeFileMagic, sizeof(header.magic));
+    header.version = kTapeFileVersion;
+    header.value_size = sizeof(T);
+    header.byte_order = kTapeFileByteOrder;
+    header.num_tapes = sorted.size();
+
+    // The sections follow the header and the directory, which is filled in
+    // last once the offsets are known.
+    std::string buffer(sizeof(TapeFileHeader) +
+                       sorted.size() * sizeof(TapeFileEntry), '\0');
+    std::vector<TapeFileEntry> directory(sorted.size());
+    for (int i = 0; i < sorted.size(); ++i) {
+        const std::string& key = sorted[i].first;
+        const Tape<T>& tape = *sorted[i].second;
+        TapeFileEntry& entry = directory[i];
+        memset(&entry, 0, sizeof(entry));
+
+        entry.key_offset = AlignTapeFile(buffer);
+        entry.key_size = key.size();
+        buffer += key;
+
+        entry.names_offset = AlignTapeFile(buffer);
+        entry.num_variables = tape.Variables().size();
+        uint32_t end = 0;
+        for (const std::string& name : tape.Variables()) {
+            end += name.size();
+            buffer.append(reinterpret_cast<const char*>(&end), sizeof(end));
+        }
+        for (const std::string& name : tape.Variables()) {
+            buffer += name;
+        }
+
+        entry.constants_offset = AlignTapeFile(buffer);
+        entry.num_constants = tape.Constants().size();
+        buffer.append(reinterpret_cast<const char*>(tape.Constants().data()),
+                      tape.Constants().size() * sizeof(T));
+
+        entry.instructions_offset = AlignTapeFile(buffer);
+        entry.num_instructions = tape.Instructions().size();
+        buffer.append(
+            reinterpret_cast<const char*>(tape.Instructions().data()),
+            tape.Instructions().size() * sizeof(Instruction));
+
+        entry.output = tape.Output();
+        entry.num_slots = tape.NumSlots();
+        entry.flags = tape.ReusesSlots() ? 1 : 0;
+    }
+    memcpy(&buffer[0], &header, sizeof(header));
+    if (!directory.empty()) {
+        memcpy(&buffer[sizeof(header)], directory.data(),
+               directory.size() * sizeof(TapeFileEntry));
+    }
+
+    std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+    file.write(buffer.data(), buffer.size());
+    if (!file) {
+        status.code = ReturnCode::invalid_argument;
+        status.message = "Cannot write file: " + path;
+    }
+    return status;
+}
+
+
+/* Implementation MappedTape */
+
+template <class T>
+Status MappedTape<T>::ResolveVariables(const std::vector<std::string>& names,
+                                       std::vector<int>& index) const {
+    Status status;
+    index.assign(NumVariables(), -1);
+    for (int i = 0; i < NumVariables(); ++i) {
+        StringView variable = Variable(i);
+        for (int j = 0; j < names.size(); ++j) {
+            if (StringView(names[j]) == variable) {
+                index[i] = j;
+                break;
+            }
+        }
+        if (index[i] < 0) {
+            status.code = ReturnCode::parse_error;
+            status.message = "Key not found: " + variable.ToString();
+            return status;
+        }
+    }
+    return status;
+}
+
+template <class T>
+void MappedTape<T>::CopyTo(Tape<T>& tape) const {
+    tape.variables_.clear();
+    for (int i = 0; i < NumVariables(); ++i) {
+        tape.variables_.push_back(Variable(i).ToString());
+    }
+    tape.constants_.assign(view_.Constants(),
+                           view_.Constants() + view_.NumConstants());
+    tape.instructions_.assign(view_.Instructions(),
+                              view_.Instructions() + view_.NumInstructions());
+    tape.output_ = view_.Output();
+    tape.num_slots_ = view_.NumSlots();
+    tape.reuses_slots_ = view_.ReusesSlots();
+}
+
+
+/* Implementation TapeFile */
+
+/**
+ * Orders keys as std::string does, byte by byte and then by length.
+ *
+ * @param lhs: the first key.
+ * @param rhs: the second key.
+ * @returns: negative, zero or positive as lhs is before, equal to or after rhs.
+ */
+inline int CompareTapeKeys(StringView lhs, StringView rhs) {
+    size_t size = std::min(lhs.size(), rhs.size());
+    int compare = size == 0 ? 0 : memcmp(lhs.data(), rhs.data(), size);
+    if (compare != 0) {
+        return compare;
+    }
+    return lhs.size() < rhs.size() ? -1 : lhs.size() > rhs.size() ? 1 : 0;
+}
+
+template <class T>
+template <class U>
+bool TapeFile<T>::Section(uint64_t offset, uint64_t count,
+                          const U*& section) const {
+    if (offset > file_.size() || count > (file_.size() - offset) / sizeof(U)) {
+        return false;
+    }
+    section = reinterpret_cast<const U*>(file_.data() + offset);
+    return reinterpret_cast<uintptr_t>(section) % alignof(U) == 0;
+}
+
+template <class T>
+Status TapeFile<T>::ReadEntry(const TapeFileEntry& entry,
+                              MappedTape<T>& tape) const {
+    Status status;
+    status.code = ReturnCode::invalid_argument;
+    const char* key;
+    const uint32_t* name_ends;
+    const char* names;
+    const T* constants;
+    const Instruction* instructions;
+    if (!Section(entry.key_offset, entry.key_size, key) ||
+        !Section(entry.names_offset, entry.num_variables, name_ends) ||
+        !Section(entry.constants_offset, entry.num_constants, constants) ||
+        !Section(entry.instructions_offset, entry.num_instructions,
+                 instructions)) {
+        status.message = "Invalid tape file: section out of bounds";
+        return status;
+    }
+    uint64_t names_size = entry.num_variables == 0 ? 0 :
+        name_ends[entry.num_variables - 1];
+    if (!Section(entry.names_offset + entry.num_variables * sizeof(uint32_t),
+                 names_size, names)) {
+        status.message = "Invalid tape file: section out of bounds";
+        return status;
+    }
+    for (uint32_t i = 1; i < entry.num_variables; ++i) {
+        if (name_ends[i] < name_ends[i - 1]) {
+            status.message = "Invalid tape file: bad variable names";
+            return status;
+        }
+    }
+
+    // Every slot an instruction touches must exist, and results must not
+    // overwrite variables or constants, so that evaluation stays in bounds.
+    int64_t num_slots = entry.num_slots;
+    int64_t first_result = static_cast<int64_t>(entry.num_variables) +
+                           entry.num_constants;
+    if (num_slots > INT32_MAX || num_slots < first_result ||
+        entry.output < 0 || entry.output >= num_slots ||
+        (entry.flags & ~1u) != 0) {
+        status.message = "Invalid tape file: bad slot layout";
+        return status;
+    }
+    for (uint32_t i = 0; i < entry.num_instructions; ++i) {
+        const Instruction& ins = instructions[i];
+        int op = static_cast<int>(ins.op);
+        if (op < static_cast<int>(Operation::addition) ||
+            op > static_cast<int>(Operation::loglogistic) ||
+            ins.dst < first_result || ins.dst >= num_slots ||
+            ins.lhs < 0 || ins.lhs >= num_slots ||
+            ins.rhs < -1 || ins.rhs >= num_slots ||
+            ins.third < -1 || ins.third >= num_slots) {
+            status.message = "Invalid tape file: bad instruction";
+            return status;
+        }
+    }
+
+    tape.key_ = StringView(key, entry.key_size);
+    tape.name_ends_ = name_ends;
+    tape.names_ = names;
+    tape.view_ = TapeView<T>(entry.num_variables, constants,
+                             entry.num_constants, instructions,
+                             entry.num_instructions, entry.output,
+                             entry.num_slots, (entry.flags & 1) != 0);
+    status.code = ReturnCode::success;
+    return status;
+}
+
+template <class T>
+Status TapeFile<T>::Open(const std::string& path) {
+    tapes_.clear();
+    Status status = file_.Open(path);
+    if (status.code != ReturnCode::success) {
+        return status;
+    }
+    status.code = ReturnCode::invalid_argument;
+    TapeFileHeader header;
+    if (file_.size() < sizeof(header)) {
+        status.message = "Invalid tape file: truncated header";
+        return status;
+    }
+    memcpy(&header, file_.data(), sizeof(header));
+    if (memcmp(header.magic, kTapeFileMagic, sizeof(header.magic)) != 0) {
+        status.message = "Invalid tape file: bad magic";
+        return status;
+    }
+    if (header.byte_order != kTapeFileByteOrder) {
+        status.message = "Invalid tape file: other byte order";
+        return status;
+    }
+    if (header.version != kTapeFileVersion) {
+        status.message = "Invalid tape file: unsupported version " +
+                         std::to_string(header.version);
+        return status;
+    }
+    if (header.value_size != sizeof(T)) {
+        status.message = "Invalid tape file: saved with values of " +
+                         std::to_string(header.value_size) + " bytes";
+        return status;
+    }
+    if (header.num_tapes >
+        (file_.size() - sizeof(header)) / sizeof(TapeFileEntry)) {
+        status.message = "Invalid tape file: truncated directory";
+        return status;
+    }
+
+    std::vector<MappedTape<T>> tapes(header.num_tapes);
+    for (uint32_t i = 0; i < header.num_tapes; ++i) {
+        TapeFileEntry entry;
+        memcpy(&entry,
+               file_.data() + sizeof(header) + i * sizeof(TapeFileEntry),
+               sizeof(entry));
+        Status entry_status = ReadEntry(entry, tapes[i]);
+        if (entry_status.code != ReturnCode::success) {
+            return entry_status;
+        }
+        if (i > 0 &&
+            CompareTapeKeys(tapes[i - 1].Key(), tapes[i].Key()) >= 0) {
+            status.message = "Invalid tape file: keys out of order";
+            return status;
+        }
+    }
+    tapes_.swap(tapes);
+    status.code = ReturnCode::success;
+    return status;
+}
+
+template <class T>
+const MappedTape<T>* TapeFile<T>::Find(StringView key) const {
+    int low = 0;
+    int high = tapes_.size();
+    while (low < high) {
+        int mid = (low + high) / 2;
+        int compare = CompareTapeKeys(tapes_[mid].Key(), key);
+        if (compare == 0) {
+            return &tapes_[mid];
+        }
+        if (compare < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return nullptr;
+}
+
+#endif /* TAPEFILE_H */
@@ -0,0 +1,839 @@
+/**
+ * @file TapePasses.h
+ */
+
+#ifndef TAPEPASSES_H
+#define TAPEPASSES_H
+
+/* header files */
+#include "ADNode.hpp"
+#include "Tape.hpp"
+
+/* system header files */
+#ifndef DOXYGEN_IGNORE
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <math.h>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#endif
+
+// Largest integer exponent that StrengthReduce expands into multiplications.
+const int kMaxReducedPower = 16;
+
+// Number of instructions of a tape before and after optimization.
+struct OptimizeStats {
+  int ops_before = 0;
+  int ops_after = 0;
+};
+
+/**
+ * The TapeRewriter rebuilds a tape one instruction at a time. A pass walks the
+ * instructions of the old tape in order and, for each one, either re-emits it,
+ * replaces it with other instructions, forwards it to an existing value or
+ * turns it into a constant. Variables keep their slots and order, while
+ * constants are only created when a surviving instruction reads them, so
+ * constants that are folded away disappear from the pool.
+ *
+ * Example usage: copy every instruction, then replace the old tape.
+ *
+ * TapeRewriter<double> rewriter(tape);
+ * for (const Instruction& ins : tape.Instructions()) {
+ *     rewriter.Emit(ins);
+ * }
+ * rewriter.Build(tape);
+ */
+template <class T>
+class TapeRewriter {
+  private:
+    // Slot of the output in the old tape.
+    int output_;
+
+    TapeBuilder<T> builder_;
+
+    // Node id of the value of every old slot, -1 if not created yet.
+    std::vector<int> node_;
+
+    // Whether each old slot holds a known constant, and its value.
+    std::vector<bool> constant_;
+    std::vector<T> value_;
+
+  public:
+    /**
+     * Constructor. Creates the variables of the old tape.
+     *
+     * @param tape: the tape to rewrite.
+     */
+    explicit TapeRewriter(const Tape<T>& tape);
+
+    /* getters */
+    bool IsConstant(int slot) const { return slot >= 0 && constant_[slot]; }
+    T Value(int slot) const { return value_[slot]; }
+
+    /**
+     * Gets the node of the current value of an old slot, creating the
+     * constant if needed.
+     *
+     * @param slot: a slot of the old tape.
+     * @returns: the node id in the new tape.
+     */
+    int Node(int slot);
+
+    /**
+     * Gets the node of a constant, creating it if needed.
+     *
+     * @param value: the constant value.
+     * @returns: the node id in the new tape.
+     */
+    int ConstantNode(T value) { return builder_.Constant(value); }
+
+    /**
+     * Copies an instruction of the old tape.
+     *
+     * @param ins: the instruction.
+     */
+    void Emit(const Instruction& ins) {
+        SetNode(ins.dst, builder_.Emit(
+            ins.op, Node(ins.lhs), ins.rhs < 0 ? -1 : Node(ins.rhs),
+            ins.third < 0 ? -1 : Node(ins.third)));
+    }
+
+    /**
+     * Emits a new instruction on nodes of the new tape.
+     *
+     * @param op: the operation to apply.
+     * @param lhs: node id of the main operand.
+     * @param rhs: node id of the auxilary operand, -1 for unary ops.
+     * @param third: node id of the addend of fma, -1 for other ops.
+     * @returns: the node id of the result.
+     */
+    int EmitNode(Operation op, int lhs, int rhs = -1, int third = -1) {
+        return builder_.Emit(op, lhs, rhs, third);
+    }
+
+    /**
+     * Sets the value of an old slot to a node of the new tape.
+     *
+     * @param slot: a slot of the old tape.
+     * @param node: the node id holding its value.
+     */
+    void SetNode(int slot, int node) {
+        node_[slot] = node;
+        constant_[slot] = false;
+    }
+
+    /**
+     * Sets the value of an old slot to a constant.
+     *
+     * @param slot: a slot of the old tape.
+     * @param value: the constant value.
+     */
+    void SetConstant(int slot, T value) {
+        node_[slot] = -1;
+        constant_[slot] = true;
+        value_[slot] = value;
+    }
+
+    /**
+     * Makes an old slot hold the same value as another one.
+     *
+     * @param slot: the slot to forward.
+     * @param source: the slot holding the value.
+     */
+    void Alias(int slot, int source) {
+        node_[slot] = node_[source];
+        constant_[slot] = constant_[source];
+        value_[slot] = value_[source];
+    }
+
+    /**
+     * Builds the rewritten tape, replacing the contents of tape.
+     *
+     * @param tape: the tape to fill. May be the tape being rewritten.
+     */
+    void Build(Tape<T>& tape) {
+        builder_.Build(Node(output_), tape);
+    }
+
+    /**
+     * Builds the rewritten tape with another output than the old one.
+     *
+     * @param node: node id of the new output.
+     * @param tape: the tape to fill. May be the tape being rewritten.
+     */
+    void Build(int node, Tape<T>& tape) {
+        builder_.Build(node, tape);
+    }
+};
+
+/**
+ * Constant folding and algebraic simplification. Instructions whose operands
+ * are all constants are evaluated (unless the result is not finite), and the
+ * identities x+0, 0+x, x-0, x*1, 1*x, x/1 and x^1 are forwarded to x. The
+ * only observable change is the derivative of x^1 at x = 0, which is 1 where
+ * ADValue::power reports 0 for a zero base.
+ *
+ * @param tape: the tape to rewrite.
+ */
+template <class T>
+void FoldConstants(Tape<T>& tape);
+
+/**
+ * Strength reduction. Powers with a constant integer exponent between 2 and
+ * kMaxReducedPower are expanded into multiplications by repeated squaring,
+ * e.g., x^2 becomes x*x.
+ *
+ * @param tape: the tape to rewrite.
+ */
+template <class T>
+void StrengthReduce(Tape<T>& tape);
+
+/**
+ * Common subexpression elimination. Instructions applying the same operation
+ * to the same operands are computed once. Operands of addition and
+ * multiplication are compared in either order.
+ *
+ * @param tape: the tape to rewrite.
+ */
+template <class T>
+void EliminateCommonSubexpressions(Tape<T>& tape);
+
+/**
+ * Operation fusion. Rewrites common patterns into the fused ops of the
+ * Operation enum, each evaluated by a single kernel:
+ *  - (a*b)+c and c+(a*b) to fma(a, b, c),
+ *  - x*x to square(x),
+ *  - 1/x to reciprocal(x),
+ *  - x^n for a constant integer n to ipow(x, n),
+ *  - exp(0-x) to expneg(x),
+ *  - log_b(logistic(x)) to loglogistic(x, b).
+ * An instruction is only absorbed into another one if that is its only
+ * reader. Absorbed instructions are removed.
+ *
+ * @param tape: the tape to rewrite.
+ */
+template <class T>
+void FuseOperations(Tape<T>& tape);
+
+/**
+ * Dead code elimination. Removes instructions that the output does not depend
+ * on, together with the constants only they read.
+ *
+ * @param tape: the tape to rewrite.
+ */
+template <class T>
+void EliminateDeadCode(Tape<T>& tape);
+
+/**
+ * Runs FoldConstants, StrengthReduce, EliminateCommonSubexpressions and
+ * EliminateDeadCode. The result evaluates to the same value and derivatives
+ * as the original tape (up to rounding, and the x^1 case noted in
+ * FoldConstants).
+ *
+ * @param tape: the tape to optimize.
+ * @returns: the number of instructions before and after.
+ */
+template <class T>
+OptimizeStats OptimizeTape(Tape<T>& tape);
+
+/**
+ * Canonical form. Rebuilds the tape so that equations that differ only in the
+ * order of commutative operands (e.g., (x+y) and (y+x)), in parentheses or in
+ * the spelling of a constant compile to the same tape. Variables are sorted by
+ * name, constants are normalized (-0 becomes 0), the operands of addition,
+ * multiplication and the product of fma are ordered by their structural hash,
+ * and instructions are laid out in post-order from the output. Structurally
+ * identical subexpressions are merged and unreachable instructions dropped.
+ * Swapping the operands of a commutative op is exact, so values and
+ * derivatives are unchanged.
+ *
+ * @param tape: the tape to rewrite. It may reuse slots, the result does not.
+ */
+template <class T>
+void Canonicalize(Tape<T>& tape);
+
+// A 128 bit structural hash (see HashTape).
+struct Hash128 {
+  uint64_t high = 0;
+  uint64_t low = 0;
+};
+
+inline bool operator==(const Hash128& lhs, const Hash128& rhs) {
+    return lhs.high == rhs.high && lhs.low == rhs.low;
+}
+
+inline bool operator!=(const Hash128& lhs, const Hash128& rhs) {
+    return !(lhs == rhs);
+}
+
+inline bool operator<(const Hash128& lhs, const Hash128& rhs) {
+    return lhs.high < rhs.high || (lhs.high == rhs.high && lhs.low < rhs.low);
+}
+
+// Hash of a Hash128, to key unordered containers.
+struct Hash128Hasher {
+  size_t operator()(const Hash128& hash) const {
+      return static_cast<size_t>(hash.low);
+  }
+};
+
+/**
+ * Structural hash of every value of a tape, indexed by value: variables,
+ * then constants, then the result of each instruction. The hash of a value
+ * depends only on the expression computing it, i.e., on the names of the
+ * variables, the constants and the operations, not on slot numbers or on the
+ * order of the operands of commutative ops. It is computed with fixed integer
+ * mixing, so it is the same across runs, builds and platforms of the same
+ * byte order.
+ *
+ * @param tape: the tape.
+ * @returns: the hash of each value.
+ */
+template <class T>
+std::vector<Hash128> StructuralHashes(const Tape<T>& tape);
+
+/**
+ * Structural hash of a tape: the hash of its output (see StructuralHashes)
+ * combined with its sorted variable names. Tapes computing the same
+ * expression up to the order of commutative operands, e.g., the tapes of
+ * "((x+y)*2)" and "(2*(y+x))", have the same hash, so it can key caches of
+ * compiled tapes. Distinct expressions collide with negligible probability.
+ *
+ * @param tape: the tape.
+ * @returns: the hash.
+ */
+template <class T>
+Hash128 HashTape(const Tape<T>& tape);
+
+
+/* Implementation TapeRewriter */
+
+template <class T>
+TapeRewriter<T>::TapeRewriter(const Tape<T>& tape)
+    : output_(tape.Output()),
+      node_(tape.NumSlots(), -1),
+      constant_(tape.NumSlots(), false),
+      value_(tape.NumSlots(), 0) {
+    int num_variables = tape.Variables().size();
+    for (int i = 0; i < num_variables; ++i) {
+        node_[i] = builder_.Variable(tape.Variables()[i]);
+    }
+    for (int j = 0; j < tape.Constants().size(); ++j) {
+        SetConstant(num_variables + j, tape.Constants()[j]);
+    }
+}
+
+template <class T>
+int TapeRewriter<T>::Node(int slot) {
+    if (constant_[slot] && node_[slot] < 0) {
+        node_[slot] = builder_.Constant(value_[slot]);
+    }
+    return node_[slot];
+}
+
+
+/* Implementation passes */
+
+template <class T>
+void FoldConstants(Tape<T>& tape) {
+    TapeRewriter<T> rewriter(tape);
+    for (const Instruction& ins : tape.Instructions()) {
+        bool lhs_constant = rewriter.IsConstant(ins.lhs);
+        bool rhs_constant = ins.rhs < 0 || rewriter.IsConstant(ins.rhs);
+        bool third_constant = ins.third < 0 || rewriter.IsConstant(ins.third);
+        if (lhs_constant && rhs_constant && third_constant) {
+            T rhs = ins.rhs < 0 ? 0 : rewriter.Value(ins.rhs);
+            T third = ins.third < 0 ? 0 : rewriter.Value(ins.third);
+            T value = PrimalOperation(ins.op, rewriter.Value(ins.lhs), rhs,
+                                      third);
+            // Keep NaN and inf on the tape, they cannot key the constant pool.
+            if (isfinite(value)) {
+                rewriter.SetConstant(ins.dst, value);
+                continue;
+            }
+        }
+        // Identities whose value and derivatives are those of x.
+        int identity = -1;
+        switch (ins.op) {
+          case Operation::addition : {
+            if (rhs_constant && rewriter.Value(ins.rhs) == 0) {
+                identity = ins.lhs;
+            } else if (lhs_constant && rewriter.Value(ins.lhs) == 0) {
+                identity = ins.rhs;
+            }
+            break;
+          }
+          case Operation::multiplication : {
+            if (rhs_constant && rewriter.Value(ins.rhs) == 1) {
+                identity = ins.lhs;
+            } else if (lhs_constant && rewriter.Value(ins.lhs) == 1) {
+                identity = ins.rhs;
+            }
+            break;
+          }
+          case Operation::subtraction :
+          case Operation::division :
+          case Operation::power : {
+            T neutral = ins.op == Operation::subtraction ? 0 : 1;
+            if (rhs_constant && rewriter.Value(ins.rhs) == neutral) {
+                identity = ins.lhs;
+            }
+            break;
+          }
+          default :
+            break;
+        }
+        if (identity >= 0) {
+            rewriter.Alias(ins.dst, identity);
+        } else {
+            rewriter.Emit(ins);
+        }
+    }
+    rewriter.Build(tape);
+}
+
+template <class T>
+void StrengthReduce(Tape<T>& tape) {
+    TapeRewriter<T> rewriter(tape);
+    for (const Instruction& ins : tape.Instructions()) {
+        if (ins.op != Operation::power || !rewriter.IsConstant(ins.rhs) ||
+            rewriter.IsConstant(ins.lhs)) {
+            rewriter.Emit(ins);
+            continue;
+        }
+        T exponent = rewriter.Value(ins.rhs);
+        int n = exponent >= 2 && exponent <= kMaxReducedPower ? exponent : 0;
+        if (n == 0 || n != exponent) {
+            rewriter.Emit(ins);
+            continue;
+        }
+        // Repeated squaring. base holds x^(2^k) and result the product of
+        // the powers for the bits of n seen so far.
+        int base = rewriter.Node(ins.lhs);
+        int result = -1;
+        while (true) {
+            if (n & 1) {
+                result = result < 0 ? base : rewriter.EmitNode(
+                    Operation::multiplication, result, base);
+            }
+            n >>= 1;
+            if (n == 0) {
+                break;
+            }
+            base = rewriter.EmitNode(Operation::multiplication, base, base);
+        }
+        rewriter.SetNode(ins.dst, result);
+    }
+    rewriter.Build(tape);
+}
+
+template <class T>
+void EliminateCommonSubexpressions(Tape<T>& tape) {
+    TapeRewriter<T> rewriter(tape);
+    // Node of the first instruction computing each (op, operands) on nodes.
+    std::unordered_map<std::tuple<Operation, int, int, int>, int, OperandsHash>
+        computed(tape.Instructions().size());
+    for (const Instruction& ins : tape.Instructions()) {
+        int lhs = rewriter.Node(ins.lhs);
+        int rhs = ins.rhs < 0 ? -1 : rewriter.Node(ins.rhs);
+        int third = ins.third < 0 ? -1 : rewriter.Node(ins.third);
+        if ((ins.op == Operation::addition ||
+             ins.op == Operation::multiplication ||
+             ins.op == Operation::fma) && rhs < lhs) {
+            std::swap(lhs, rhs);
+        }
+        std::tuple<Operation, int, int, int> key(ins.op, lhs, rhs, third);
+        auto it = computed.find(key);
+        if (it != computed.end()) {
+            rewriter.SetNode(ins.dst, it->second);
+        } else {
+            rewriter.Emit(ins);
+            computed[key] = rewriter.Node(ins.dst);
+        }
+    }
+    rewriter.Build(tape);
+}
+
+template <class T>
+void FuseOperations(Tape<T>& tape) {
+    const std::vector<Instruction>& instructions = tape.Instructions();
+    int n = instructions.size();
+    // Instruction that wrote the current value of each slot (-1 for inputs),
+    // tracked in order so that tapes which reuse slots are handled too.
+    std::vector<int> def(tape.NumSlots(), -1);
+    // Instruction that defined the lhs and rhs of each instruction, and the
+    // number of reads of each result.
+    std::vector<int> lhs_def(n);
+    std::vector<int> rhs_def(n);
+    std::vector<int> uses(n, 0);
+    for (int i = 0; i < n; ++i) {
+        const Instruction& ins = instructions[i];
+        lhs_def[i] = def[ins.lhs];
+        rhs_def[i] = ins.rhs < 0 ? -1 : def[ins.rhs];
+        for (int operand : { ins.lhs, ins.rhs, ins.third }) {
+            if (operand >= 0 && def[operand] >= 0) {
+                ++uses[def[operand]];
+            }
+        }
+        def[ins.dst] = i;
+    }
+    if (def[tape.Output()] >= 0) {
+        ++uses[def[tape.Output()]];
+    }
+    // Whether instruction p is an op read only once, so it can be absorbed.
+    auto absorbable = [&](int p, Operation op) {
+        return p >= 0 && uses[p] == 1 && instructions[p].op == op;
+    };
+
+    TapeRewriter<T> rewriter(tape);
+    // Nodes of the lhs and rhs of each instruction when it was reached.
+    std::vector<int> lhs_node(n);
+    std::vector<int> rhs_node(n, -1);
+    for (int i = 0; i < n; ++i) {
+        const Instruction& ins = instructions[i];
+        lhs_node[i] = rewriter.Node(ins.lhs);
+        if (ins.rhs >= 0) {
+            rhs_node[i] = rewriter.Node(ins.rhs);
+        }
+        int node = -1;
+        switch (ins.op) {
+          case Operation::addition : {
+            if (absorbable(lhs_def[i], Operation::multiplication)) {
+                int p = lhs_def[i];
+                node = rewriter.EmitNode(Operation::fma, lhs_node[p],
+                                         rhs_node[p], rhs_node[i]);
+            } else if (absorbable(rhs_def[i], Operation::multiplication)) {
+                int p = rhs_def[i];
+                node = rewriter.EmitNode(Operation::fma, lhs_node[p],
+                                         rhs_node[p], lhs_node[i]);
+            }
+            break;
+          }
+          case Operation::multiplication : {
+            if (lhs_node[i] == rhs_node[i]) {
+                node = rewriter.EmitNode(Operation::square, lhs_node[i]);
+            }
+            break;
+          }
+          case Operation::division : {
+            if (rewriter.IsConstant(ins.lhs) && rewriter.Value(ins.lhs) == 1) {
+                node = rewriter.EmitNode(Operation::reciprocal, rhs_node[i]);
+            }
+            break;
+          }
+          case Operation::power : {
+            if (rewriter.IsConstant(ins.rhs) && !rewriter.IsConstant(ins.lhs) &&
+                floor(rewriter.Value(ins.rhs)) == rewriter.Value(ins.rhs)) {
+                node = rewriter.EmitNode(Operation::ipow, lhs_node[i],
+                                         rhs_node[i]);
+            }
+            break;
+          }
+          case Operation::exp : {
+            int p = lhs_def[i];
+            if (absorbable(p, Operation::subtraction) &&
+                rewriter.IsConstant(instructions[p].lhs) &&
+                rewriter.Value(instructions[p].lhs) == 0) {
+                node = rewriter.EmitNode(Operation::expneg, rhs_node[p]);
+            }
+            break;
+          }
+          case Operation::log : {
+            int p = lhs_def[i];
+            if (absorbable(p, Operation::logistic)) {
+                node = rewriter.EmitNode(Operation::loglogistic, lhs_node[p],
+                                         rhs_node[i]);
+            }
+            break;
+          }
+          default :
+            break;
+        }
+        if (node >= 0) {
+            rewriter.SetNode(ins.dst, node);
+        } else {
+            rewriter.Emit(ins);
+        }
+    }
+    rewriter.Build(tape);
+    // The absorbed instructions no longer have readers.
+    EliminateDeadCode(tape);
+}
+
+template <class T>
+void EliminateDeadCode(Tape<T>& tape) {
+    const std::vector<Instruction>& instructions = tape.Instructions();
+    // Walk backwards from the output. This also works when slots are reused,
+    // since a write ends the live range of its slot.
+    std::vector<bool> live(tape.NumSlots(), false);
+    std::vector<bool> keep(instructions.size(), false);
+    live[tape.Output()] = true;
+    for (int i = instructions.size() - 1; i >= 0; --i) {
+        const Instruction& ins = instructions[i];
+        if (!live[ins.dst]) {
+            continue;
+        }
+        keep[i] = true;
+        live[ins.dst] = false;
+        live[ins.lhs] = true;
+        if (ins.rhs >= 0) {
+            live[ins.rhs] = true;
+        }
+        if (ins.third >= 0) {
+            live[ins.third] = true;
+        }
+    }
+    TapeRewriter<T> rewriter(tape);
+    for (int i = 0; i < instructions.size(); ++i) {
+        if (keep[i]) {
+            rewriter.Emit(instructions[i]);
+        }
+    }
+    rewriter.Build(tape);
+}
+
+template <class T>
+OptimizeStats OptimizeTape(Tape<T>& tape) {
+    OptimizeStats stats;
+    stats.ops_before = tape.Instructions().size();
+    FoldConstants(tape);
+    StrengthReduce(tape);
+    EliminateCommonSubexpressions(tape);
+    EliminateDeadCode(tape);
+    stats.ops_after = tape.Instructions().size();
+    return stats;
+}
+
+/* Implementation structural hashing */
+
+/**
+ * Finalizer of MurmurHash3, a fixed bijective mix of 64 bits.
+ *
+ * @param x: the bits to mix.
+ * @returns: the mixed bits.
+ */
+inline uint64_t MixHash64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+/**
+ * Appends a word to a hash.
+ *
+ * @param hash: the hash to update.
+ * @param word: the word.
+ */
+inline void AppendHash(Hash128& hash, uint64_t word) {
+    hash.low = MixHash64(hash.low ^ word) + hash.high;
+    hash.high = MixHash64(hash.high + word * 0x9e3779b97f4a7c15ULL) ^ hash.low;
+}
+
+/**
+ * Appends a string to a hash, length first so that concatenations differ.
+ *
+ * @param hash: the hash to update.
+ * @param str: the string.
+ */
+inline void AppendHash(Hash128& hash, const std::string& str) {
+    AppendHash(hash, str.size());
+    for (size_t i = 0; i < str.size(); i += 8) {
+        uint64_t word = 0;
+        for (size_t j = i; j < i + 8 && j < str.size(); ++j) {
+            word = (word << 8) | static_cast<unsigned char>(str[j]);
+        }
+        AppendHash(hash, word);
+    }
+}
+
+/**
+ * Normalizes a constant so that equal values have the same bits.
+ *
+ * @param value: the constant.
+ * @returns: the constant, with -0 replaced by 0.
+ */
+template <class T>
+T NormalizeConstant(T value) {
+    return value == 0 ? T(0) : value;
+}
+
+/**
+ * Value ids of the operands of every instruction of a tape, following slot
+ * reuse. Value ids number variables, then constants, then the result of each
+ * instruction, as in StructuralHashes.
+ *
+ * @param tape: the tape.
+ * @param operands: set to the value ids of lhs, rhs and third of every
+ * instruction, -1 where absent.
+ * @returns: the value id of the output.
+ */
+template <class T>
+int TapeValueIds(const Tape<T>& tape,
+                 std::vector<std::tuple<int, int, int>>& operands) {
+    int num_inputs = tape.Variables().size() + tape.Constants().size();
+    // Value currently held by every slot.
+    std::vector<int> value(tape.NumSlots(), -1);
+    for (int i = 0; i < num_inputs; ++i) {
+        value[i] = i;
+    }
+    operands.clear();
+    for (int i = 0; i < tape.Instructions().size(); ++i) {
+        const Instruction& ins = tape.Instructions()[i];
+        operands.emplace_back(value[ins.lhs],
+                              ins.rhs < 0 ? -1 : value[ins.rhs],
+                              ins.third < 0 ? -1 : value[ins.third]);
+        value[ins.dst] = num_inputs + i;
+    }
+    return value[tape.Output()];
+}
+
+template <class T>
+std::vector<Hash128> StructuralHashes(const Tape<T>& tape) {
+    std::vector<std::tuple<int, int, int>> operands;
+    TapeValueIds(tape, operands);
+    std::vector<Hash128> hashes;
+    for (const std::string& name : tape.Variables()) {
+        Hash128 hash;
+        AppendHash(hash, 1);
+        AppendHash(hash, name);
+        hashes.push_back(hash);
+    }
+    for (T constant : tape.Constants()) {
+        Hash128 hash;
+        AppendHash(hash, 2);
+        // The bytes of the value, so that constants hash exactly.
+        T normalized = NormalizeConstant(constant);
+        const unsigned char* bytes =
+            reinterpret_cast<const unsigned char*>(&normalized);
+        for (size_t i = 0; i < sizeof(T); i += 8) {
+            uint64_t word = 0;
+            memcpy(&word, bytes + i, std::min<size_t>(8, sizeof(T) - i));
+            AppendHash(hash, word);
+        }
+        hashes.push_back(hash);
+    }
+    for (int i = 0; i < tape.Instructions().size(); ++i) {
+        Operation op = tape.Instructions()[i].op;
+        Hash128 lhs = hashes[std::get<0>(operands[i])];
+        Hash128 rhs;
+        if (std::get<1>(operands[i]) >= 0) {
+            rhs = hashes[std::get<1>(operands[i])];
+        }
+        if ((op == Operation::addition || op == Operation::multiplication ||
+             op == Operation::fma) && rhs < lhs) {
+            std::swap(lhs, rhs);
+        }
+        Hash128 hash;
+        AppendHash(hash, 3);
+        AppendHash(hash, static_cast<uint64_t>(op));
+        AppendHash(hash, lhs.high);
+        AppendHash(hash, lhs.low);
+        AppendHash(hash, rhs.high);
+        AppendHash(hash, rhs.low);
+        if (std::get<2>(operands[i]) >= 0) {
+            Hash128 third = hashes[std::get<2>(operands[i])];
+            AppendHash(hash, third.high);
+            AppendHash(hash, third.low);
+        }
+        hashes.push_back(hash);
+    }
+    return hashes;
+}
+
+template <class T>
+Hash128 HashTape(const Tape<T>& tape) {
+    std::vector<std::tuple<int, int, int>> operands;
+    int output = TapeValueIds(tape, operands);
+    std::vector<std::string> names(tape.Variables());
+    std::sort(names.begin(), names.end());
+    Hash128 hash;
+    AppendHash(hash, 4);
+    for (const std::string& name : names) {
+        AppendHash(hash, name);
+    }
+    Hash128 value = StructuralHashes(tape)[output];
+    AppendHash(hash, value.high);
+    AppendHash(hash, value.low);
+    return hash;
+}
+
+template <class T>
+void Canonicalize(Tape<T>& tape) {
+    std::vector<std::tuple<int, int, int>> operands;
+    int output = TapeValueIds(tape, operands);
+    std::vector<Hash128> hashes = StructuralHashes(tape);
+    int num_variables = tape.Variables().size();
+    int num_inputs = num_variables + tape.Constants().size();
+
+    TapeBuilder<T> builder;
+    builder.SetHashConsing(true);
+    // Node of every value, -1 until it is emitted.
+    std::vector<int> node(hashes.size(), -1);
+    std::vector<std::string> names(tape.Variables());
+    std::sort(names.begin(), names.end());
+    for (const std::string& name : names) {
+        builder.Variable(name);
+    }
+    for (int i = 0; i < num_variables; ++i) {
+        node[i] = builder.Variable(tape.Variables()[i]);
+    }
+
+    // Canonical order of the operands of an instruction.
+    auto ordered = [&](int i) {
+        std::tuple<int, int, int> ops = operands[i];
+        Operation op = tape.Instructions()[i].op;
+        if ((op == Operation::addition || op == Operation::multiplication ||
+             op == Operation::fma) &&
+            hashes[std::get<1>(ops)] < hashes[std::get<0>(ops)]) {
+            std::swap(std::get<0>(ops), std::get<1>(ops));
+        }
+        return ops;
+    };
+
+    // Iterative post-order walk from the output, so that deep tapes do not
+    // exhaust the stack. Each entry is a value and whether its operands have
+    // been pushed.
+    std::vector<std::pair<int, bool>> stack = { { output, false } };
+    while (!stack.empty()) {
+        int value = stack.back().first;
+        bool expanded = stack.back().second;
+        if (node[value] >= 0) {
+            stack.pop_back();
+            continue;
+        }
+        if (value < num_inputs) {
+            node[value] = builder.Constant(NormalizeConstant(
+                tape.Constants()[value - num_variables]));
+            stack.pop_back();
+            continue;
+        }
+        int i = value - num_inputs;
+        std::tuple<int, int, int> ops = ordered(i);
+        if (!expanded) {
+            stack.back().second = true;
+            // Pushed in reverse so that lhs is emitted first.
+            for (int operand : { std::get<2>(ops), std::get<1>(ops),
+                                 std::get<0>(ops) }) {
+                if (operand >= 0 && node[operand] < 0) {
+                    stack.emplace_back(operand, false);
+                }
+            }
+            continue;
+        }
+        stack.pop_back();
+        node[value] = builder.Emit(
+            tape.Instructions()[i].op, node[std::get<0>(ops)],
+            std::get<1>(ops) < 0 ? -1 : node[std::get<1>(ops)],
+            std::get<2>(ops) < 0 ? -1 : node[std::get<2>(ops)]);
+    }
+    builder.Build(node[output], tape);
+}
+
+#endif /* TAPEPASSES_H */
@@ -0,0 +1,462 @@
+/**
+ * @file TaylorValue.h
+ */
+
+#ifndef TAYLORVALUE_H
+#define TAYLORVALUE_H
+
+/* header files */
+#include "ADNode.hpp"
+
+/* system header files */
+#ifndef DOXYGEN_IGNORE
+# include <array>
+# include <math.h>
+# include <stdexcept>
+#endif
+
+
+/**
+ * The TaylorValue class represents a truncated Taylor polynomial
+ * c[0] + c[1] t + ... + c[K] t^K of a function along a direction, so that
+ * the j-th directional derivative is j! * c[j]. It provides the same operator
+ * interface as ADValue so it can be evaluated through a compiled Tape. Each
+ * operation propagates all K+1 coefficients with the usual recurrences, which
+ * costs O(K^2) per operation instead of the exponential cost of nesting
+ * first order values K times.
+ */
+template <class T, int K>
+class TaylorValue {
+  private:
+    typedef std::array<T, K + 1> Coefficients;
+
+    // Taylor coefficients.
+    Coefficients c;
+
+    /**
+     * Solves f' = g(f) a' for f, where g(f) = alpha + beta f + gamma f^2.
+     * This covers exp (g = f), tan (g = 1 + f^2), tanh (g = 1 - f^2) and
+     * logistic (g = f - f^2).
+     *
+     * @param a: coefficients of the argument.
+     * @param f0: the value of the function at a[0].
+     * @returns: the coefficients of f.
+     */
+    static Coefficients Riccati(const Coefficients& a, T f0,
+                                T alpha, T beta, T gamma);
+
+    /* Series helpers. */
+    static Coefficients Mul(const Coefficients& a, const Coefficients& b);
+    static Coefficients Div(const Coefficients& a, const Coefficients& b);
+    static Coefficients Sqrt(const Coefficients& a);
+    static Coefficients Log(const Coefficients& a);
+    static Coefficients Exp(const Coefficients& a);
+
+    /**
+     * Computes f with f' = w / d for an inverse trigonometric function, where
+     * w is the series of the derivative of the argument.
+     *
+     * @param a: coefficients of the argument.
+     * @param d: the denominator series.
+     * @param f0: the value of the function at a[0].
+     * @returns: the coefficients of f.
+     */
+    static Coefficients Integrate(const Coefficients& a,
+                                  const Coefficients& d, T f0);
+
+    /**
+     * Computes sin and cos (or sinh and cosh) of a series together.
+     *
+     * @param a: coefficients of the argument.
+     * @param hyperbolic: true for sinh/cosh.
+     * @param s: set to the coefficients of sin(a) (or sinh(a)).
+     * @param co: set to the coefficients of cos(a) (or cosh(a)).
+     */
+    static void SinCos(const Coefficients& a, bool hyperbolic,
+                       Coefficients& s, Coefficients& co);
+
+    /**
+     * Whether only the constant coefficient is nonzero.
+     */
+    bool IsConstant() const;
+
+    explicit TaylorValue(const Coefficients& coeffs) : c(coeffs) {}
+
+  public:
+    /**
+     * Default constructor. Zero polynomial.
+     */
+    TaylorValue() { c.fill(0); }
+
+    /**
+     * Constant constructor.
+     *
+     * @param: val: the value.
+     */
+    explicit TaylorValue(T val) { c.fill(0); c[0] = val; }
+
+    /**
+     * Constructor for a seed variable x + t * direction.
+     *
+     * @param: val: the value.
+     * @param: direction: the component of the direction for this variable.
+     */
+    TaylorValue(T val, T direction) {
+        c.fill(0);
+        c[0] = val;
+        if (K > 0) {
+            c[1] = direction;
+        }
+    }
+
+    /* getters */
+    T val() const { return c[0]; };
+    T coeff(int j) const { return c[j]; };
+
+    /**
+     * The j-th derivative along the direction, j! * coeff(j).
+     */
+    T derivative(int j) const {
+        T factorial = 1;
+        for (int i = 2; i <= j; ++i) {
+            factorial *= i;
+        }
+        return factorial * c[j];
+    }
+
+    /* operators, see ADValue for documentation */
+    TaylorValue<T, K> operator+(const TaylorValue<T, K> &other) const;
+    TaylorValue<T, K> operator-(const TaylorValue<T, K> &other) const;
+    TaylorValue<T, K> power(const TaylorValue<T, K> &other) const;
+    TaylorValue<T, K> ADmul(const TaylorValue<T, K> &other) const;
+    TaylorValue<T, K> ADdiv(const TaylorValue<T, K> &other) const;
+    TaylorValue<T, K> ADexp() const;
+    TaylorValue<T, K> ADsin() const;
+    TaylorValue<T, K> ADcos() const;
+    TaylorValue<T, K> ADtan() const;
+    TaylorValue<T, K> ADarcsin() const;
+    TaylorValue<T, K> ADarccos() const;
+    TaylorValue<T, K> ADarctan() const;
+    TaylorValue<T, K> ADsinh() const;
+    TaylorValue<T, K> ADcosh() const;
+    TaylorValue<T, K> ADtanh() const;
+    TaylorValue<T, K> ADlogistic() const;
+    TaylorValue<T, K> ADlog(const TaylorValue<T, K> &other) const;
+    TaylorValue<T, K> ADsqrt() const;
+
+    /* fused operators, composed from the ones above */
+    TaylorValue<T, K> ADfma(const TaylorValue<T, K> &other,
+                            const TaylorValue<T, K> &addend) const {
+        return ADmul(other) + addend;
+    }
+    TaylorValue<T, K> ADsquare() const { return ADmul(*this); }
+    TaylorValue<T, K> ADreciprocal() const {
+        return TaylorValue<T, K>(1).ADdiv(*this);
+    }
+    TaylorValue<T, K> ADipow(const TaylorValue<T, K> &other) const {
+        return power(other);
+    }
+    TaylorValue<T, K> ADexpneg() const {
+        return (TaylorValue<T, K>() - *this).ADexp();
+    }
+    TaylorValue<T, K> ADloglogistic(const TaylorValue<T, K> &other) const {
+        return ADlogistic().ADlog(other);
+    }
+};
+
+// Implementation
+
+template <class T, int K>
+bool TaylorValue<T, K>::IsConstant() const {
+    for (int j = 1; j <= K; ++j) {
+        if (c[j] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <class T, int K>
+typename TaylorValue<T, K>::Coefficients TaylorValue<T, K>::Mul(
+    const Coefficients& a, const Coefficients& b) {
+    Coefficients r;
+    // Cauchy product.
+    for (int j = 0; j <= K; ++j) {
+        r[j] = 0;
+        for (int i = 0; i <= j; ++i) {
+            r[j] += a[i] * b[j - i];
+        }
+    }
+    return r;
+}
+
+template <class T, int K>
+typename TaylorValue<T, K>::Coefficients TaylorValue<T, K>::Div(
+    const Coefficients& a, const Coefficients& b) {
+    Coefficients r;
+    r[0] = b[0] == 0 ? NAN : a[0] / b[0];
+    // Solve r * b = a for the next coefficient.
+    for (int j = 1; j <= K; ++j) {
+        T sum = a[j];
+        for (int i = 1; i <= j; ++i) {
+            sum -= b[i] * r[j - i];
+        }
+        r[j] = sum / b[0];
+    }
+    return r;
+}
+
+template <class T, int K>
+typename TaylorValue<T, K>::Coefficients TaylorValue<T, K>::Sqrt(
+    const Coefficients& a) {
+    Coefficients r;
+    r[0] = sqrt(a[0]);
+    // Solve r * r = a for the next coefficient.
+    for (int j = 1; j <= K; ++j) {
+        T sum = a[j];
+        for (int i = 1; i < j; ++i) {
+            sum -= r[i] * r[j - i];
+        }
+        r[j] = sum / (2 * r[0]);
+    }
+    return r;
+}
+
+template <class T, int K>
+typename TaylorValue<T, K>::Coefficients TaylorValue<T, K>::Log(
+    const Coefficients& a) {
+    Coefficients r;
+    r[0] = log(a[0]);
+    // From a * r' = a'.
+    for (int j = 1; j <= K; ++j) {
+        T sum = 0;
+        for (int i = 1; i < j; ++i) {
+            sum += i * r[i] * a[j - i];
+        }
+        r[j] = (a[j] - sum / j) / a[0];
+    }
+    return r;
+}
+
+template <class T, int K>
+typename TaylorValue<T, K>::Coefficients TaylorValue<T, K>::Exp(
+    const Coefficients& a) {
+    return Riccati(a, exp(a[0]), 0, 1, 0);
+}
+
+template <class T, int K>
+typename TaylorValue<T, K>::Coefficients TaylorValue<T, K>::Riccati(
+    const Coefficients& a, T f0, T alpha, T beta, T gamma) {
+    Coefficients f;
+    Coefficients g;
+    f[0] = f0;
+    for (int j = 1; j <= K; ++j) {
+        // g[j-1] only needs f up to j-1.
+        int m = j - 1;
+        T square = 0;
+        for (int k = 0; k <= m; ++k) {
+            square += f[k] * f[m - k];
+        }
+        g[m] = (m == 0 ? alpha : 0) + beta * f[m] + gamma * square;
+        T sum = 0;
+        for (int i = 1; i <= j; ++i) {
+            sum += i * a[i] * g[j - i];
+        }
+        f[j] = sum / j;
+    }
+    return f;
+}
+
+template <class T, int K>
+typename TaylorValue<T, K>::Coefficients TaylorValue<T, K>::Integrate(
+    const Coefficients& a, const Coefficients& d, T f0) {
+    // Series of a'.
+    Coefficients da;
+    for (int m = 0; m < K; ++m) {
+        da[m] = (m + 1) * a[m + 1];
+    }
+    da[K] = 0;
+    Coefficients w = Div(da, d);
+    Coefficients f;
+    f[0] = f0;
+    for (int j = 1; j <= K; ++j) {
+        f[j] = w[j - 1] / j;
+    }
+    return f;
+}
+
+template <class T, int K>
+void TaylorValue<T, K>::SinCos(const Coefficients& a, bool hyperbolic,
+                               Coefficients& s, Coefficients& co) {
+    s[0] = hyperbolic ? sinh(a[0]) : sin(a[0]);
+    co[0] = hyperbolic ? cosh(a[0]) : cos(a[0]);
+    // s' = co a', co' = -s a' (or +s a' for the hyperbolic case).
+    T sign = hyperbolic ? 1 : -1;
+    for (int j = 1; j <= K; ++j) {
+        T sum_s = 0;
+        T sum_c = 0;
+        for (int i = 1; i <= j; ++i) {
+            sum_s += i * a[i] * co[j - i];
+            sum_c += i * a[i] * s[j - i];
+        }
+        s[j] = sum_s / j;
+        co[j] = sign * sum_c / j;
+    }
+}
+
+template <class T, int K>
+TaylorValue<T, K> TaylorValue<T, K>::operator+(
+    const TaylorValue<T, K> &other) const {
+    Coefficients r;
+    for (int j = 0; j <= K; ++j) {
+        r[j] = c[j] + other.c[j];
+    }
+    return TaylorValue<T, K>(r);
+}
+
+template <class T, int K>
+TaylorValue<T, K> TaylorValue<T, K>::operator-(
+    const TaylorValue<T, K> &other) const {
+    Coefficients r;
+    for (int j = 0; j <= K; ++j) {
+        r[j] = c[j] - other.c[j];
+    }
+    return TaylorValue<T, K>(r);
+}
+
+template <class T, int K>
+TaylorValue<T, K> TaylorValue<T, K>::ADmul(
+    const TaylorValue<T, K> &other) const {
+    return TaylorValue<T, K>(Mul(c, other.c));
+}
+
+template <class T, int K>
+TaylorValue<T, K> TaylorValue<T, K>::ADdiv(
+    const TaylorValue<T, K> &other) const {
+    return TaylorValue<T, K>(Div(c, other.c));
+}
+
+template <class T, int K>
+TaylorValue<T, K> TaylorValue<T, K>::power(
+    const TaylorValue<T, K> &other) const {
+    // Same convention as ADValue::power.
+    if (c[0] == 0) {
+        return TaylorValue<T, K>();
+    }
+    if (!other.IsConstant()) {
+        if (c[0] < 0) {
+            throw std::logic_error("Derivative not defined or complex.");
+        }
+        // a^b = exp(b log(a)).
+        return TaylorValue<T, K>(Exp(Mul(other.c, Log(c))));
+    }
+    // Constant exponent r, from a * p' = r * a' * p.
+    T r = other.c[0];
+    Coefficients p;
+    p[0] = pow(c[0], r);
+    for (int j = 1; j <= K; ++j) {
+        T sum = 0;
+        for (int i = 1; i <= j; ++i) {
+            sum += (r * i - (j - i)) * c[i] * p[j - i];
+        }
+        p[j] = sum / (j * c[0]);
+    }
+    return TaylorValue<T, K>(p);
+}
+
+template <class T, int K>
+TaylorValue<T, K> TaylorValue<T, K>::ADexp() const {
+    return TaylorValue<T, K>(Exp(c));
+}
+
+template <class T, int K>
+TaylorValue<T, K> TaylorValue<T, K>::ADsin() const {
+    Coefficients s, co;
+    SinCos(c, false, s, co);
+    return TaylorValue<T, K>(s);
+}
+
+template <class T, int K>
+TaylorValue<T, K> TaylorValue<T, K>::ADcos() const {
+    Coefficients s, co;
+    SinCos(c, false, s, co);
+    return TaylorValue<T, K>(co);
+}
+
+template <class T, int K>
+TaylorValue<T, K> TaylorValue<T, K>::ADtan() const {
+    return TaylorValue<T, K>(Riccati(c, tan(c[0]), 1, 0, 1));
+}
+
+template <class T, int K>
+TaylorValue<T, K> TaylorValue<T, K>::ADarcsin() const {
+    // arcsin' = a' / sqrt(1 - a^2).
+    Coefficients one_minus_sq = Mul(c, c);
+    for (int j = 0; j <= K; ++j) {
+        one_minus_sq[j] = (j == 0 ? 1 : 0) - one_minus_sq[j];
+    }
+    return TaylorValue<T, K>(Integrate(c, Sqrt(one_minus_sq), asin(c[0])));
+}
+
+template <class T, int K>
+TaylorValue<T, K> TaylorValue<T, K>::ADarccos() const {
+    // arccos = pi/2 - arcsin.
+    Coefficients r = ADarcsin().c;
+    r[0] = acos(c[0]);
+    for (int j = 1; j <= K; ++j) {
+        r[j] = -r[j];
+    }
+    return TaylorValue<T, K>(r);
+}
+
+template <class T, int K>
+TaylorValue<T, K> TaylorValue<T, K>::ADarctan() const {
+    // arctan' = a' / (1 + a^2).
+    Coefficients one_plus_sq = Mul(c, c);
+    one_plus_sq[0] += 1;
+    return TaylorValue<T, K>(Integrate(c, one_plus_sq, atan(c[0])));
+}
+
+template <class T, int K>
+TaylorValue<T, K> TaylorValue<T, K>::ADsinh() const {
+    Coefficients s, co;
+    SinCos(c, true, s, co);
+    return TaylorValue<T, K>(s);
+}
+
+template <class T, int K>
+TaylorValue<T, K> TaylorValue<T, K>::ADcosh() const {
+    Coefficients s, co;
+    SinCos(c, true, s, co);
+    return TaylorValue<T, K>(co);
+}
+
+template <class T, int K>
+TaylorValue<T, K> TaylorValue<T, K>::ADtanh() const {
+    return TaylorValue<T, K>(Riccati(c, tanh(c[0]), 1, 0, -1));
+}
+
+template <class T, int K>
+TaylorValue<T, K> TaylorValue<T, K>::ADlogistic() const {
+    T f0 = exp(c[0]) / (1 + exp(c[0]));
+    return TaylorValue<T, K>(Riccati(c, f0, 0, 1, -1));
+}
+
+template <class T, int K>
+TaylorValue<T, K> TaylorValue<T, K>::ADlog(
+    const TaylorValue<T, K> &other) const {
+    // As in ADValue::ADlog the base is treated as a constant.
+    Coefficients r = Log(c);
+    T log_base = log(other.c[0]);
+    for (int j = 0; j <= K; ++j) {
+        r[j] /= log_base;
+    }
+    return TaylorValue<T, K>(r);
+}
+
+template <class T, int K>
+TaylorValue<T, K> TaylorValue<T, K>::ADsqrt() const {
+    return TaylorValue<T, K>(Sqrt(c));
+}
+
+#endif /* TAYLORVALUE_H */
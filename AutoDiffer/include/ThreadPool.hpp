@@ -0,0 +1,122 @@
+/**
+ * @file ThreadPool.h
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+/* system header files */
+#ifndef DOXYGEN_IGNORE
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#endif
+
+/**
+ * The ThreadPool class runs tasks on a fixed set of worker threads, started
+ * once, so submitting work does not pay for creating a thread. Tasks are run
+ * in the order they were submitted. The destructor finishes every task
+ * submitted so far before joining the workers.
+ *
+ * Example usage:
+ *
+ * ThreadPool pool(4);
+ * pool.Submit([] { std::cout << "on a worker" << std::endl; });
+ */
+class ThreadPool {
+  private:
+    // State shared with the workers, so a worker that outlives the pool
+    // (see the destructor) can still finish its loop.
+    struct State {
+      std::deque<std::function<void()>> tasks;
+      std::mutex mutex;
+      std::condition_variable available;
+      bool stopping = false;
+    };
+
+    std::shared_ptr<State> state_;
+    std::vector<std::thread> workers_;
+
+    /**
+     * Runs tasks until the pool is destroyed and the queue is empty.
+     *
+     * @param state: the state of the pool.
+     */
+    static void WorkerLoop(std::shared_ptr<State> state) {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(state->mutex);
+                state->available.wait(lock, [&state] {
+                    return state->stopping || !state->tasks.empty();
+                });
+                if (state->tasks.empty()) {
+                    return;
+                }
+                task = std::move(state->tasks.front());
+                state->tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+  public:
+    /**
+     * Constructor. Starts the workers.
+     *
+     * @param num_threads: the number of workers, at least 1.
+     */
+    explicit ThreadPool(int num_threads)
+        : state_(std::make_shared<State>()) {
+        for (int i = 0; i < std::max(1, num_threads); ++i) {
+            workers_.push_back(std::thread(&ThreadPool::WorkerLoop, state_));
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Destructor. Waits for every submitted task to finish. When it runs on
+     * one of the workers, e.g., because a task held the last reference to
+     * the pool, that worker is detached instead of joined and finishes the
+     * remaining tasks with the others.
+     */
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            state_->stopping = true;
+        }
+        state_->available.notify_all();
+        for (std::thread& worker : workers_) {
+            if (worker.get_id() == std::this_thread::get_id()) {
+                worker.detach();
+            } else {
+                worker.join();
+            }
+        }
+    }
+
+    /* getters */
+    int NumThreads() const { return workers_.size(); }
+
+    /**
+     * Queues a task to run on one of the workers. Tasks must not throw.
+     *
+     * @param task: the task.
+     */
+    void Submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            state_->tasks.push_back(std::move(task));
+        }
+        state_->available.notify_one();
+    }
+};
+
+#endif /* THREADPOOL_H */
@@ -0,0 +1,277 @@
+/**
+ * @file Workspace.h
+ */
+
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+/* header files */
+#include "ADNode.hpp"
+#include "ADValue.hpp"
+#include "Parser.hpp"
+#include "Tape.hpp"
+
+/* system header files */
+#ifndef DOXYGEN_IGNORE
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#endif
+
+/**
+ * The Workspace class derives compiled tapes in buffers it keeps between
+ * calls: a register file with the value of each slot, an arena with the
+ * derivatives of each slot, and scratch for resolving variables. They grow
+ * to fit the largest tape and seed width seen so far and are never shrunk, so
+ * once a worker has seen its largest item, deriving allocates nothing but the
+ * returned ADValue. Instead of building an ADValue per operation, every
+ * instruction updates the derivatives of its slot in place from the local
+ * partials of PartialOperation, i.e., the rules of the ADValue operators.
+ *
+ * A Workspace must only be used by one thread at a time; give each worker its
+ * own (see AutoDiffer::DeriveCompiled).
+ *
+ * Example usage:
+ *
+ * Tape<double> tape;
+ * tape.Compile("((x^2)*(sin(y)))");
+ * Workspace<double> workspace;
+ * std::vector<std::pair<std::string, ADValue<double>>> seeds = {
+ *     { "x", ADValue<double>(1.5, {1, 0}) },
+ *     { "y", ADValue<double>(2.0, {0, 1}) },
+ * };
+ * std::pair<Status, ADValue<double>> result = workspace.Derive(tape, seeds);
+ */
+template <class T>
+class Workspace {
+  private:
+    // Value of each slot.
+    std::vector<T> values_;
+
+    // Derivatives of each slot, width entries per slot.
+    std::vector<T> tangents_;
+
+    // Scratch for ResolveVariables.
+    std::vector<std::string> names_;
+    std::vector<int> index_;
+
+    // Number of times values_ or tangents_ had to grow.
+    int num_growths_ = 0;
+
+    /**
+     * Sizes the buffers for a tape, keeping their capacity.
+     *
+     * @param num_slots: the slots of the tape.
+     * @param width: the number of derivatives.
+     */
+    void Resize(int num_slots, int width) {
+        size_t num_tangents = static_cast<size_t>(num_slots) * width;
+        if (num_slots > values_.capacity() ||
+            num_tangents > tangents_.capacity()) {
+            ++num_growths_;
+        }
+        values_.resize(num_slots);
+        tangents_.resize(num_tangents);
+    }
+
+    /**
+     * Runs a tape whose variables are in place, as DeriveInto.
+     *
+     * @param view: the tape.
+     * @param width: the number of derivatives.
+     * @param value, derivs, stride: as DeriveInto.
+     */
+    void Propagate(const TapeView<T>& view, int width, T& value, T* derivs,
+                   int stride);
+
+  public:
+    Workspace() {}
+
+    /* getters */
+    int NumGrowths() const { return num_growths_; }
+
+    /**
+     * Gets the bytes held by the register file and derivative arena.
+     *
+     * @returns: the bytes.
+     */
+    size_t CapacityBytes() const {
+        return (values_.capacity() + tangents_.capacity()) * sizeof(T);
+    }
+
+    /**
+     * Derives a tape at the given seeds, as Derive does with a Parser.
+     *
+     * @param tape: the tape. It may reuse slots.
+     * @param seeds: the name, value and derivatives of every variable of the
+     * tape. All must have the same number of derivatives.
+     * @returns: a Status and an ADValue with the value and derivatives of the
+     * output. If the Status is not success, the ADValue should not be used.
+     * Throws a logic_error where ADValue does (a power of a negative base
+     * with a varying exponent).
+     */
+    std::pair<Status,ADValue<T>> Derive(
+        const Tape<T>& tape,
+        const std::vector<std::pair<std::string, ADValue<T>>>& seeds);
+    /**
+     * Derives a tape at the given seeds, as Derive, writing the output to
+     * caller provided memory instead of a new ADValue.
+     *
+     * @param tape: the tape. It may reuse slots.
+     * @param seeds: the seeds, as Derive.
+     * @param value: set to the value of the output.
+     * @param derivs: the derivatives of the output are written to derivs[0],
+     * derivs[stride], ..., one per derivative of the seeds.
+     * @param stride: the distance between two derivatives in derivs.
+     * @returns: a Status. If it is not success, nothing is written.
+     */
+    Status DeriveInto(
+        const Tape<T>& tape,
+        const std::vector<std::pair<std::string, ADValue<T>>>& seeds,
+        T& value, T* derivs, int stride);
+
+    /**
+     * Derives a tape at a point with unit seeds, as DeriveInto where the
+     * seed of variable j has a derivative of 1 at j and 0 elsewhere, without
+     * building the seeds or resolving names.
+     *
+     * @param tape: the tape. It may reuse slots.
+     * @param index: variable i of the tape is point[index[i]], as set by
+     * tape.ResolveVariables.
+     * @param point: the value of each variable.
+     * @param width: the number of variables, and of derivatives. Every entry
+     * of index must be less than width.
+     * @param value, derivs, stride: as DeriveInto.
+     * @returns: success.
+     */
+    Status DerivePoint(const Tape<T>& tape, const std::vector<int>& index,
+                       const T* point, int width, T& value, T* derivs,
+                       int stride);
+};
+
+
+/* Implementation Workspace */
+
+template <class T>
+std::pair<Status,ADValue<T>> Workspace<T>::Derive(
+    const Tape<T>& tape,
+    const std::vector<std::pair<std::string, ADValue<T>>>& seeds) {
+    T value = 0;
+    std::vector<T> derivs(seeds.empty() ? 0 : seeds[0].second.dvals().size());
+    Status status = DeriveInto(tape, seeds, value, derivs.data(), 1);
+    if (status.code != ReturnCode::success) {
+        return std::pair<Status,ADValue<T>>(status, ADValue<T>(0,0));
+    }
+    return std::pair<Status,ADValue<T>>(
+        status, ADValue<T>(value, std::move(derivs)));
+}
+
+template <class T>
+Status Workspace<T>::DeriveInto(
+    const Tape<T>& tape,
+    const std::vector<std::pair<std::string, ADValue<T>>>& seeds,
+    T& value, T* derivs, int stride) {
+    Status status;
+    int width = seeds.empty() ? 0 : seeds[0].second.dvals().size();
+    names_.resize(seeds.size());
+    for (int j = 0; j < seeds.size(); ++j) {
+        if (seeds[j].second.dvals().size() != width) {
+            status.code = ReturnCode::invalid_argument;
+            status.message = "Seeds have different numbers of derivatives";
+            return status;
+        }
+        names_[j] = seeds[j].first;
+    }
+    status = tape.ResolveVariables(names_, index_);
+    if (status.code != ReturnCode::success) {
+        return status;
+    }
+
+    TapeView<T> view = tape.View();
+    Resize(view.NumSlots(), width);
+    for (int i = 0; i < index_.size(); ++i) {
+        const ADValue<T>& seed = seeds[index_[i]].second;
+        values_[i] = seed.val();
+        std::copy(seed.dvals().begin(), seed.dvals().end(),
+                  tangents_.begin() + static_cast<size_t>(i) * width);
+    }
+    Propagate(view, width, value, derivs, stride);
+    return status;
+}
+
+template <class T>
+Status Workspace<T>::DerivePoint(
+    const Tape<T>& tape, const std::vector<int>& index, const T* point,
+    int width, T& value, T* derivs, int stride) {
+    TapeView<T> view = tape.View();
+    Resize(view.NumSlots(), width);
+    for (int i = 0; i < index.size(); ++i) {
+        values_[i] = point[index[i]];
+        T* tangent = tangents_.data() + static_cast<size_t>(i) * width;
+        std::fill_n(tangent, width, T(0));
+        tangent[index[i]] = 1;
+    }
+    Propagate(view, width, value, derivs, stride);
+    return Status();
+}
+
+template <class T>
+void Workspace<T>::Propagate(const TapeView<T>& view, int width, T& value,
+                             T* derivs, int stride) {
+    int num_variables = view.NumVariables();
+    for (int j = 0; j < view.NumConstants(); ++j) {
+        values_[num_variables + j] = view.Constants()[j];
+        std::fill_n(tangents_.begin() +
+                    static_cast<size_t>(num_variables + j) * width, width,
+                    T(0));
+    }
+
+    for (int i = 0; i < view.NumInstructions(); ++i) {
+        const Instruction& ins = view.Instructions()[i];
+        T a = values_[ins.lhs];
+        T b = ins.rhs < 0 ? 0 : values_[ins.rhs];
+        T c = ins.third < 0 ? 0 : values_[ins.third];
+        T primal = PrimalOperation(ins.op, a, b, c);
+        T da, db;
+        const T* ta =
+            tangents_.data() + static_cast<size_t>(ins.lhs) * width;
+        // Unary ops read their own derivatives with a zero partial.
+        const T* tb = ins.rhs < 0 ? ta :
+            tangents_.data() + static_cast<size_t>(ins.rhs) * width;
+        if (!PartialOperation(ins.op, a, b, primal, da, db)) {
+            // Negative base, the exponent must be a constant.
+            for (int k = 0; k < width; ++k) {
+                if (tb[k] != 0) {
+                    throw std::logic_error(
+                        "Derivative not defined or complex.");
+                }
+            }
+            db = 0;
+        }
+        // Slot reuse may make dst an operand; each entry is read before it
+        // is written.
+        T* td = tangents_.data() + static_cast<size_t>(ins.dst) * width;
+        if (ins.third >= 0) {
+            const T* tc =
+                tangents_.data() + static_cast<size_t>(ins.third) * width;
+            for (int k = 0; k < width; ++k) {
+                td[k] = da * ta[k] + db * tb[k] + tc[k];
+            }
+        } else {
+            for (int k = 0; k < width; ++k) {
+                td[k] = da * ta[k] + db * tb[k];
+            }
+        }
+        values_[ins.dst] = primal;
+    }
+    const T* output =
+        tangents_.data() + static_cast<size_t>(view.Output()) * width;
+    value = values_[view.Output()];
+    for (int k = 0; k < width; ++k) {
+        derivs[static_cast<size_t>(k) * stride] = output[k];
+    }
+}
+
+#endif /* WORKSPACE_H */
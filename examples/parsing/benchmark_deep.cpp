@@ -0,0 +1,97 @@
+/**
+ * @file    benchmark_deep.cpp
+ * @brief   Stress test of deeply nested equations. Compiles and evaluates
+ *          equations nested depth levels deep, which needs the parsers and
+ *          the tape to avoid recursion.
+ *
+ * To run this example run `make` in this directory, followed by
+ * ./benchmark_deep depth
+ * Use `ulimit -s` to try it with a small stack, e.g.,
+ * (ulimit -s 256 && ./benchmark_deep 1000000)
+ *
+ */
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../../AutoDiffer/include/AutoDiffer.hpp"
+#include "../../AutoDiffer/include/InfixParser.hpp"
+
+
+// Helper to create long functions, "((((x)+x)+x)+x)". Valid in both syntaxes.
+std::string CreateStringEq(int n) {
+    std::string ret(n, '(');
+    ret += "x)";
+    for (int i = 0; i < n-1; ++i) {
+        ret += "+x)";
+    }
+    return ret;
+}
+
+// Helper to create nested function calls, "sin(cos(sin(x)))".
+std::string CreateNestedCalls(int n) {
+    std::string ret;
+    for (int i = 0; i < n; ++i) {
+        ret += i % 2 == 0 ? "sin(" : "cos(";
+    }
+    return ret + "x" + std::string(n, ')');
+}
+
+// Seconds since start.
+double Since(std::chrono::steady_clock::time_point start) {
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// Compiles and evaluates an infix equation, printing the time of each step.
+void TimeEquation(const std::string& name, const std::string& eq) {
+    std::cout << name << " (" << eq.size() << " characters)" << std::endl;
+    Tape<double> tape;
+    auto start = std::chrono::steady_clock::now();
+    Status status = InfixParser<double>(eq).Compile(tape);
+    std::cout << "  InfixParser::Compile (s): " << Since(start) << std::endl;
+    if (status.code != ReturnCode::success) {
+        std::cout << "  " << status.message << std::endl;
+        return;
+    }
+
+    start = std::chrono::steady_clock::now();
+    std::vector<double> slots = { 0.5 };
+    double value = tape.Primal(slots);
+    std::vector<double> adjoints;
+    tape.Adjoint(slots, 1.0, adjoints);
+    std::cout << "  Primal and Adjoint (s): " << Since(start) << std::endl;
+    std::cout << "  value " << value << ", derivative " << adjoints[0]
+              << std::endl;
+
+    PassManager<double> passes = PassManager<double>::Default();
+    passes.AddPass("liveness");
+    start = std::chrono::steady_clock::now();
+    passes.Run(tape);
+    std::cout << "  PassManager::Run (s): " << Since(start) << std::endl;
+    std::cout << "  instructions " << tape.Instructions().size()
+              << ", slots " << tape.NumSlots() << std::endl;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::cout << "Usage: ./benchmark_deep depth" << std::endl;
+        return 1;
+    }
+    int depth = std::stoi(argv[1]);
+
+    std::string sum = CreateStringEq(depth);
+    TimeEquation("Nested groups", sum);
+    TimeEquation("Nested calls", CreateNestedCalls(depth));
+    TimeEquation("Unary minus", std::string(depth, '-') + "x");
+
+    Tape<double> tape;
+    auto start = std::chrono::steady_clock::now();
+    tape.Compile(sum);
+    std::cout << "Tape::Compile of nested groups (s): " << Since(start)
+              << std::endl;
+    return 0;
+}
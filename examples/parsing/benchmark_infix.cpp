@@ -0,0 +1,96 @@
+/**
+ * @file    benchmark_infix.cpp
+ * @brief   Compares the time to read the same equation with the string
+ *          rewriting Parser, with Tape::Compile on the fully parenthesized
+ *          syntax, and with the InfixParser on the infix syntax.
+ *
+ * To run this example run `make` in this directory, followed by
+ * ./benchmark_infix num_terms num_repeats
+ *
+ */
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../../AutoDiffer/include/AutoDiffer.hpp"
+#include "../../AutoDiffer/include/InfixParser.hpp"
+
+
+// Helper to create a sum of num_terms terms of the form x^2*sin(y), in both
+// syntaxes.
+std::pair<std::string, std::string> CreateStringEqs(int num_terms) {
+    const char* functions[] = { "sin", "cos", "exp", "tanh" };
+    std::string parenthesized = "((x^2)*(sin(y)))";
+    std::string infix = "x^2*sin(y)";
+    for (int i = 1; i < num_terms; ++i) {
+        std::string function = functions[i % 4];
+        std::string power = std::to_string(i % 3 + 1);
+        parenthesized = "(" + parenthesized + "+((x^" + power + ")*(" +
+                        function + "(y))))";
+        infix += " + x^" + power + "*" + function + "(y)";
+    }
+    return std::pair<std::string, std::string>(parenthesized, infix);
+}
+
+// Runs fn num_repeats times and returns the mean time in microseconds.
+template <class F>
+double TimeMicroseconds(int num_repeats, F fn) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < num_repeats; ++i) {
+        fn();
+    }
+    auto stop = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        stop - start).count() / (double)num_repeats;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cout << "Usage: ./benchmark_infix num_terms num_repeats"
+                  << std::endl;
+        return 1;
+    }
+    int num_terms = std::stoi(argv[1]);
+    int num_repeats = std::stoi(argv[2]);
+    std::pair<std::string, std::string> eqs = CreateStringEqs(num_terms);
+
+    std::vector<std::pair<std::string, ADValue<double>>> seeds = {
+        { "x", ADValue<double>(0.5, std::vector<double>{ 1, 0 }) },
+        { "y", ADValue<double>(1.5, std::vector<double>{ 0, 1 }) },
+    };
+
+    // The Parser evaluates as it reads, so it is timed reading and evaluating.
+    double parser_us = TimeMicroseconds(num_repeats, [&]() {
+        Parser<double> parser(eqs.first);
+        parser.Init(seeds);
+        parser.Run();
+    });
+    double tape_us = TimeMicroseconds(num_repeats, [&]() {
+        Tape<double> tape;
+        tape.Compile(eqs.first);
+    });
+    double infix_us = TimeMicroseconds(num_repeats, [&]() {
+        Tape<double> tape;
+        InfixParser<double>(eqs.second).Compile(tape);
+    });
+
+    Tape<double> tape;
+    tape.Compile(eqs.first);
+    Tape<double> infix_tape;
+    InfixParser<double>(eqs.second).Compile(infix_tape);
+
+    std::cout << "Characters (parenthesized / infix): " << eqs.first.size()
+              << " / " << eqs.second.size() << std::endl;
+    std::cout << "Instructions (Tape::Compile / InfixParser): "
+              << tape.Instructions().size() << " / "
+              << infix_tape.Instructions().size() << std::endl;
+    std::cout << "Parser read and evaluate (microseconds): " << parser_us
+              << std::endl;
+    std::cout << "Tape::Compile (microseconds): " << tape_us << std::endl;
+    std::cout << "InfixParser::Compile (microseconds): " << infix_us
+              << std::endl;
+    return 0;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file    benchmark_stream.cpp
+ * @brief   Measures the throughput of the streaming InfixParser, in MB/s, on
+ *          a large equation file read through a std::ifstream and through a
+ *          memory mapping.
+ *
+ * To run this example run `make` in this directory, followed by
+ * ./benchmark_stream path levels
+ * which writes an equation to path and compiles it. The text doubles with
+ * every level (about 100 MB at 22 levels), while the expression DAG only
+ * grows by a few nodes, as in the repetitive output of symbolic regression.
+ *
+ */
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../../AutoDiffer/include/AutoDiffer.hpp"
+#include "../../AutoDiffer/include/InfixParser.hpp"
+
+
+// Writes e_n where e_0 = x and e_k = sin(e_{k-1}) * (e_{k-1} + y*1.5).
+void WriteEquation(std::ostream& out, int level) {
+    if (level == 0) {
+        out << "x";
+        return;
+    }
+    out << "sin(";
+    WriteEquation(out, level - 1);
+    out << ") * (";
+    WriteEquation(out, level - 1);
+    out << " + y*1.5)";
+}
+
+// Seconds since start.
+double Since(std::chrono::steady_clock::time_point start) {
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+void Report(const std::string& name, const Status& status, size_t bytes,
+            double seconds, const Tape<double>& tape) {
+    if (status.code != ReturnCode::success) {
+        std::cout << name << ": " << status.message << std::endl;
+        return;
+    }
+    std::cout << name << ": " << bytes / 1e6 / seconds << " MB/s ("
+              << seconds << " s, " << tape.Instructions().size()
+              << " instructions)" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cout << "Usage: ./benchmark_stream path levels" << std::endl;
+        return 1;
+    }
+    std::string path = argv[1];
+    int levels = std::stoi(argv[2]);
+    {
+        std::ofstream out(path.c_str());
+        WriteEquation(out, levels);
+    }
+
+    // Through a stream, read in chunks.
+    Tape<double> tape;
+    std::ifstream file(path.c_str());
+    InfixParser<double> parser(file);
+    parser.SetHashConsing(true);
+    auto start = std::chrono::steady_clock::now();
+    Status status = parser.Compile(tape);
+    Report("std::ifstream", status, parser.BytesRead(), Since(start), tape);
+
+    // Through a memory mapping.
+    size_t bytes = 0;
+    start = std::chrono::steady_clock::now();
+    status = CompileInfixFile(path, tape, &bytes);
+    Report("mmap", status, bytes, Since(start), tape);
+
+    std::vector<double> slots = { 0.5, 0.25 };
+    std::cout << "File size (MB): " << bytes / 1e6 << ", value at (0.5, 0.25): "
+              << tape.Primal(slots) << std::endl;
+    return 0;
+}